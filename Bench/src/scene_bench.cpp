@@ -0,0 +1,450 @@
+#include "Core/base_game.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <gtc/constants.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include "Rendering/GeometryArena.h"
+#include "Importer/ModelInstanceSet.h"
+#include "Rendering/GpuProfiler.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/RenderStats.h"
+#include "Rendering/renderer.h"
+
+using namespace std;
+using namespace gllib;
+
+// Plays a fixed camera path over the Tester scene and writes frame time percentiles and render counts as JSON.
+// Runs from the Tester folder (or pass --assets), offscreen unless --windowed is given.
+// Also runs a few correctness checks on the loaded scene, a failed one makes the exit code 2.
+
+struct BenchSettings
+{
+    int frames = 600;
+    int warmupFrames = 60;
+    int fillers = 400;
+    int modelCopies = 8;
+    int width = 1280;
+    int height = 720;
+    bool headless = true;
+    bool syncGpu = true;
+    string assets;
+    string output;
+};
+
+struct FrameSample
+{
+    double cpuMs;
+    FrameRenderStats stats;
+};
+
+class SceneBench : public BaseGame
+{
+private:
+    BenchSettings settings;
+    BSPSystem bspSystem;
+    vector<Model*> models;
+    vector<Cube*> fillers;
+    vector<Material*> materials;
+    AmbientLight* ambientLight = nullptr;
+    PointLight* pointLight = nullptr;
+
+    vector<FrameSample> samples;
+    vector<pair<string, double>> gpuRegions;
+    vector<pair<string, bool>> checks;
+    string rendererName;
+    chrono::steady_clock::time_point lastFrameStart;
+    int frame = 0;
+
+    Model* loadModel(const string& path);
+    void setCameraOnPath(int pathFrame);
+    bool checkAssetReload();
+    bool checkAsyncInstances();
+
+protected:
+    void init() override;
+    void update() override;
+    void uninit() override;
+
+public:
+    SceneBench(const BenchSettings& settings);
+
+    string toJson() const;
+    bool checksPassed() const;
+};
+
+SceneBench::SceneBench(const BenchSettings& settings) : BaseGame(settings.headless, settings.width, settings.height),
+                                                        settings(settings)
+{
+    window->setVsyncEnabled(false);
+}
+
+Model* SceneBench::loadModel(const string& path)
+{
+    Model* model = new Model(path, false);
+    models.push_back(model);
+    return model;
+}
+
+void SceneBench::setCameraOnPath(int pathFrame)
+{
+    // One full orbit over the measured frames, bobbing up and down, always looking at the scene center
+    const float t = static_cast<float>(pathFrame) / static_cast<float>(max(settings.frames, 1));
+    const float angle = t * glm::two_pi<float>();
+    const float radius = 70.0f + 30.0f * sin(angle * 3.0f);
+    const glm::vec3 position(cos(angle) * radius, 10.0f + 8.0f * sin(angle * 2.0f), sin(angle) * radius);
+
+    const glm::vec3 direction = glm::normalize(-position);
+    camera->setPosition(position);
+    camera->setRotation(glm::degrees(atan2(direction.z, direction.x)), glm::degrees(asin(direction.y)));
+}
+
+bool SceneBench::checkAssetReload()
+{
+    // Releasing a model must hand its arena spans and textures back, and loading it again must reuse them
+    const unsigned int startVertices = GeometryArena::getUsedVertices(VertexFormat_Mesh);
+    const unsigned int startIndices = GeometryArena::getUsedIndices(VertexFormat_Mesh);
+    const size_t startTextures = ModelLoader::textures_loaded.size();
+
+    Model* model = new Model("models/table.fbx", false);
+    const unsigned int loadedVertices = GeometryArena::getUsedVertices(VertexFormat_Mesh);
+    const unsigned int loadedIndices = GeometryArena::getUsedIndices(VertexFormat_Mesh);
+    const unsigned int loadedCapacity = GeometryArena::getVertexCapacity(VertexFormat_Mesh);
+    delete model;
+    ModelAsset::releaseUnused();
+
+    const bool released = GeometryArena::getUsedVertices(VertexFormat_Mesh) == startVertices &&
+        GeometryArena::getUsedIndices(VertexFormat_Mesh) == startIndices &&
+        ModelLoader::textures_loaded.size() == startTextures;
+
+    model = new Model("models/table.fbx", false);
+    const bool reloaded = GeometryArena::getUsedVertices(VertexFormat_Mesh) == loadedVertices &&
+        GeometryArena::getUsedIndices(VertexFormat_Mesh) == loadedIndices &&
+        GeometryArena::getVertexCapacity(VertexFormat_Mesh) == loadedCapacity;
+    delete model;
+    ModelAsset::releaseUnused();
+
+    const bool passed = loadedVertices > startVertices && released && reloaded &&
+        GeometryArena::getUsedVertices(VertexFormat_Mesh) == startVertices &&
+        GeometryArena::getUsedIndices(VertexFormat_Mesh) == startIndices;
+    cout << "Asset reload check " << (passed ? "passed" : "failed") << ": " << startVertices << " -> "
+        << loadedVertices << " -> " << GeometryArena::getUsedVertices(VertexFormat_Mesh) << " arena vertices" << endl;
+    return passed;
+}
+
+bool SceneBench::checkAsyncInstances()
+{
+    // An instance set built while its model loads in the background must pick the meshes up once it is ready
+    Model* model = new Model("models/table.fbx", false, true);
+    ModelInstanceSet instanceSet(model);
+    const bool startedEmpty = !model->isReady() && instanceSet.getMeshCount() == 0;
+    for (int i = 0; i < 4; i++)
+        instanceSet.addInstance(glm::translate(glm::mat4(1.0f), glm::vec3(i * 4.0f - 6.0f, 0.0f, 0.0f)));
+
+    // Pumped like BaseGame does every frame, given up after ten seconds
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while (AsyncModelLoader::getPendingCount() > 0 && chrono::steady_clock::now() - start < chrono::seconds(10))
+    {
+        AsyncModelLoader::pumpUploads(2.0f);
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    Frustum frustum;
+    frustum.extractFromMatrix(glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 500.0f) *
+        glm::lookAt(glm::vec3(0.0f, 20.0f, 60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    Shader::setShaderProgram(shaderProgramLighting);
+    const unsigned long long trianglesBefore = RenderStats::getCurrentFrame().triangles;
+    instanceSet.draw(frustum);
+    if (RenderQueue::isEnabled())
+        RenderQueue::flush();
+    const bool drawn = RenderStats::getCurrentFrame().triangles > trianglesBefore;
+
+    const bool passed = startedEmpty && model->isReady() && instanceSet.getMeshCount() == model->meshes.size() &&
+        instanceSet.getMeshCount() > 0 && instanceSet.getVisibleCount() == instanceSet.getInstanceCount() && drawn;
+    cout << "Async instance check " << (passed ? "passed" : "failed") << ": " << instanceSet.getMeshCount()
+        << " meshes, " << instanceSet.getVisibleCount() << " visible instances" << endl;
+
+    instanceSet.clear();
+    delete model;
+    ModelAsset::releaseUnused();
+    return passed;
+}
+
+void SceneBench::init()
+{
+    camera->setPerspective(45.0f, window->getWidth() / (float)window->getHeight(), 0.1f, 1000.0f);
+
+    checks.emplace_back("assetReload", checkAssetReload());
+    checks.emplace_back("asyncInstances", checkAsyncInstances());
+
+    Model* wall = loadModel("models/wall.fbx");
+    wall->transform.setScale(wall->transform.getScale() * .1f);
+    wall->transform.setRotation(glm::vec3(0.0f, 0.0f, 90.0f));
+    wall->makeBSPPlane(&bspSystem);
+    bspSystem.buildBSP();
+    // The scene is about what the wall hides
+    bspSystem.setCullOppositeSides(true);
+    bspSystem.addModel(wall);
+
+    Model* claire = loadModel("models/claire/source/LXG1NDL0BZ814059Q0RW9HZXE.obj");
+    claire->transform.setScale(claire->transform.getScale() * 10.0f);
+    claire->transform.setPosition({10.0f, 0.0f, 10.0f});
+    bspSystem.addModel(claire);
+
+    Model* backpack = loadModel("models/Backpack/backpack.mtl");
+    backpack->transform.setScale(backpack->transform.getScale() * 10.0f);
+    backpack->transform.setPosition({-10.0f, 0.0f, 10.0f});
+    bspSystem.addModel(backpack);
+
+    // Tank copies on a ring, half of them behind the wall
+    for (int i = 0; i < settings.modelCopies; i++)
+    {
+        const float angle = glm::two_pi<float>() * i / settings.modelCopies;
+        Model* tank = loadModel("models/tank_1.fbx");
+        tank->transform.setScale(tank->transform.getScale() * .5f);
+        tank->transform.setPosition({cos(angle) * 35.0f, 0.0f, sin(angle) * 35.0f});
+        tank->transform.setRotation(glm::vec3(270.0f, 0.0f, glm::degrees(angle)));
+        bspSystem.addModel(tank);
+    }
+
+    materials.push_back(new Material(Material::gold()));
+    materials.push_back(new Material(Material::bronze()));
+    materials.push_back(new Material(Material::emerald()));
+    materials.push_back(new Material(Material::ruby()));
+
+    // Filler cubes on a square grid around the scene
+    const int side = static_cast<int>(ceil(sqrt(static_cast<float>(settings.fillers))));
+    for (int i = 0; i < settings.fillers; i++)
+    {
+        Transform trs({(i % side - side * 0.5f) * 6.0f, -4.0f, (i / side - side * 0.5f) * 6.0f},
+                      {2.0f, 2.0f, 2.0f}, {1.0f, 0.0f, 0.0f, 0.0f});
+        fillers.push_back(new Cube(trs, materials[i % materials.size()]));
+    }
+
+    ambientLight = new AmbientLight({1.0f, 1.0f, 1.0f, 1.0f}, 0.2f);
+    pointLight = new PointLight({0.0f, 30.0f, 0.0f}, {1.0f, 1.0f, 1.0f, 1.0f}, 1.0f, 0.0f, 0.0f);
+
+    GpuProfiler::setEnabled(GpuProfiler::isAvailable());
+    samples.reserve(settings.frames);
+    lastFrameStart = chrono::steady_clock::now();
+}
+
+void SceneBench::update()
+{
+    // Waiting for the GPU makes the CPU frame time cover the frame that was just submitted
+    if (settings.syncGpu)
+        glFinish();
+
+    const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    const int measured = frame - settings.warmupFrames;
+    if (measured > 0)
+    {
+        // Frame time and counts of the frame that just finished
+        FrameSample sample;
+        sample.cpuMs = chrono::duration<double, milli>(now - lastFrameStart).count();
+        sample.stats = RenderStats::getLastFrame();
+        samples.push_back(sample);
+    }
+    lastFrameStart = now;
+
+    if (measured >= settings.frames)
+    {
+        // GL objects are released once the loop ends, keep what the report needs
+        rendererName = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        for (const string& region : GpuProfiler::getRegionNames())
+            gpuRegions.emplace_back(region, GpuProfiler::getRegionMs(region));
+        window->setShouldClose(true);
+        return;
+    }
+
+    setCameraOnPath(max(measured, 0));
+
+    Renderer::clear();
+    Shader::setShaderProgram(shaderProgramLighting);
+    bspSystem.render(*camera);
+    for (Cube* filler : fillers)
+        filler->draw();
+
+    frame++;
+}
+
+void SceneBench::uninit()
+{
+    for (Cube* filler : fillers)
+        delete filler;
+    for (Model* model : models)
+        delete model;
+    for (Material* material : materials)
+        delete material;
+    delete pointLight;
+    delete ambientLight;
+}
+
+string SceneBench::toJson() const
+{
+    vector<double> times;
+    for (const FrameSample& sample : samples)
+        times.push_back(sample.cpuMs);
+    sort(times.begin(), times.end());
+
+    auto percentile = [&times](double p)
+    {
+        if (times.empty())
+            return 0.0;
+        const size_t index = static_cast<size_t>(ceil(p * times.size())) - 1;
+        return times[min(index, times.size() - 1)];
+    };
+
+    double total = 0.0;
+    for (double time : times)
+        total += time;
+
+    // Mean of every counter over the measured frames
+    const double count = samples.empty() ? 1.0 : static_cast<double>(samples.size());
+    double draws = 0, triangles = 0, modelsTested = 0, modelsFrustumCulled = 0, modelsBSPCulled = 0;
+    double meshesTested = 0, meshesFrustumCulled = 0, nodesBSPCulled = 0, programBinds = 0, textureBinds = 0;
+    double vertexArrayBinds = 0, nodesFrustumCulled = 0;
+    unsigned int maxDraws = 0;
+    for (const FrameSample& sample : samples)
+    {
+        draws += sample.stats.drawCalls;
+        maxDraws = max(maxDraws, sample.stats.drawCalls);
+        triangles += static_cast<double>(sample.stats.triangles);
+        vertexArrayBinds += sample.stats.vertexArrayBinds;
+        programBinds += sample.stats.programBinds;
+        textureBinds += sample.stats.textureBinds;
+        modelsTested += sample.stats.modelsTested;
+        modelsFrustumCulled += sample.stats.modelsFrustumCulled;
+        modelsBSPCulled += sample.stats.modelsBSPCulled;
+        meshesTested += sample.stats.meshesTested;
+        meshesFrustumCulled += sample.stats.meshesFrustumCulled;
+        nodesBSPCulled += sample.stats.nodesBSPCulled;
+        nodesFrustumCulled += sample.stats.nodesFrustumCulled;
+    }
+
+    ostringstream json;
+    json << "{\n";
+    json << "  \"scene\": \"tester\",\n";
+    json << "  \"frames\": " << samples.size() << ",\n";
+    json << "  \"warmupFrames\": " << settings.warmupFrames << ",\n";
+    json << "  \"width\": " << settings.width << ",\n";
+    json << "  \"height\": " << settings.height << ",\n";
+    json << "  \"fillers\": " << settings.fillers << ",\n";
+    json << "  \"modelCopies\": " << settings.modelCopies << ",\n";
+    json << "  \"headless\": " << (settings.headless ? "true" : "false") << ",\n";
+    json << "  \"renderer\": \"" << rendererName << "\",\n";
+    json << "  \"cpuFrameMs\": {\"mean\": " << total / count << ", \"p50\": " << percentile(0.50)
+        << ", \"p95\": " << percentile(0.95) << ", \"p99\": " << percentile(0.99)
+        << ", \"min\": " << (times.empty() ? 0.0 : times.front()) << ", \"max\": " << (times.empty() ? 0.0 : times.back())
+        << "},\n";
+    json << "  \"drawCalls\": {\"mean\": " << draws / count << ", \"max\": " << maxDraws << "},\n";
+    json << "  \"triangles\": " << triangles / count << ",\n";
+    json << "  \"binds\": {\"vertexArray\": " << vertexArrayBinds / count << ", \"program\": " << programBinds / count
+        << ", \"texture\": " << textureBinds / count << "},\n";
+    json << "  \"culling\": {\"modelsTested\": " << modelsTested / count
+        << ", \"modelsFrustumCulled\": " << modelsFrustumCulled / count
+        << ", \"modelsBSPCulled\": " << modelsBSPCulled / count
+        << ", \"meshesTested\": " << meshesTested / count
+        << ", \"meshesFrustumCulled\": " << meshesFrustumCulled / count
+        << ", \"nodesBSPCulled\": " << nodesBSPCulled / count
+        << ", \"nodesFrustumCulled\": " << nodesFrustumCulled / count << "},\n";
+
+    json << "  \"gpuMs\": {";
+    for (size_t i = 0; i < gpuRegions.size(); i++)
+        json << (i == 0 ? "" : ", ") << "\"" << gpuRegions[i].first << "\": " << gpuRegions[i].second;
+    json << "},\n";
+
+    json << "  \"checks\": {";
+    for (size_t i = 0; i < checks.size(); i++)
+        json << (i == 0 ? "" : ", ") << "\"" << checks[i].first << "\": " << (checks[i].second ? "true" : "false");
+    json << "}\n";
+    json << "}\n";
+    return json.str();
+}
+
+bool SceneBench::checksPassed() const
+{
+    for (const pair<string, bool>& check : checks)
+    {
+        if (!check.second)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BenchSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--frames") == 0 && hasValue)
+            settings.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+            settings.warmupFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fillers") == 0 && hasValue)
+            settings.fillers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--copies") == 0 && hasValue)
+            settings.modelCopies = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width") == 0 && hasValue)
+            settings.width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && hasValue)
+            settings.height = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--assets") == 0 && hasValue)
+            settings.assets = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+            settings.output = argv[++i];
+        else if (strcmp(argv[i], "--windowed") == 0)
+            settings.headless = false;
+        else if (strcmp(argv[i], "--no-sync") == 0)
+            settings.syncGpu = false;
+        else
+        {
+            cout << "Usage: glLib_bench [--frames N] [--warmup N] [--fillers N] [--copies N] [--width W] [--height H]"
+                " [--assets dir] [--out file.json] [--windowed] [--no-sync]\n";
+            return 1;
+        }
+    }
+    settings.frames = max(settings.frames, 1);
+    settings.warmupFrames = max(settings.warmupFrames, 0);
+    settings.fillers = max(settings.fillers, 0);
+    settings.modelCopies = max(settings.modelCopies, 1);
+
+    // Models and shaders are loaded relative to the working directory, like the Tester does. A relative --out
+    // stays relative to where the bench was started.
+    if (!settings.output.empty())
+        settings.output = filesystem::absolute(settings.output).string();
+    if (!settings.assets.empty())
+        filesystem::current_path(settings.assets);
+
+    SceneBench bench(settings);
+    bench.start();
+
+    const string json = bench.toJson();
+    const int result = bench.checksPassed() ? 0 : 2;
+    if (settings.output.empty())
+    {
+        cout << json;
+        return result;
+    }
+
+    ofstream file(settings.output);
+    if (!file.is_open())
+    {
+        cout << "Failed to write benchmark results: " << settings.output << endl;
+        return 1;
+    }
+    file << json;
+    return result;
+}
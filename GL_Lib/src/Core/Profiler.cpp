@@ -0,0 +1,225 @@
+#include "Profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+using namespace gllib;
+using namespace std;
+
+atomic<bool> Profiler::enabled{false};
+vector<Profiler::FrameRecord> Profiler::frames;
+unsigned int Profiler::frameCapacity = 300;
+unsigned int Profiler::currentFrame = 0;
+unsigned long long Profiler::frameIndex = 0;
+bool Profiler::frameOpen = false;
+std::mutex Profiler::eventMutex;
+
+namespace
+{
+    const chrono::steady_clock::time_point profilerEpoch = chrono::steady_clock::now();
+    thread_local unsigned int scopeDepth = 0;
+}
+
+// Private
+
+unsigned int Profiler::getThreadIndex()
+{
+    // Small stable ids read better in the trace viewer than hashed thread ids
+    static unordered_map<thread::id, unsigned int> threadIds;
+    const auto it = threadIds.find(this_thread::get_id());
+    if (it != threadIds.end())
+        return it->second;
+
+    const unsigned int id = static_cast<unsigned int>(threadIds.size());
+    threadIds[this_thread::get_id()] = id;
+    return id;
+}
+
+void Profiler::writeEscaped(ostream& out, const char* text)
+{
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        switch (*c)
+        {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(*c) >= 0x20)
+                out << *c;
+            break;
+        }
+    }
+}
+
+// Public
+
+void Profiler::setEnabled(bool isEnabled)
+{
+    lock_guard<std::mutex> lock(eventMutex);
+    enabled = isEnabled;
+    if (!enabled)
+        frameOpen = false;
+}
+
+bool Profiler::isEnabled()
+{
+    return enabled;
+}
+
+void Profiler::setFrameCapacity(unsigned int capacity)
+{
+    lock_guard<std::mutex> lock(eventMutex);
+    frameCapacity = capacity > 0 ? capacity : 1;
+    frames.clear();
+    currentFrame = 0;
+    frameIndex = 0;
+    frameOpen = false;
+}
+
+void Profiler::beginFrame()
+{
+    if (!enabled)
+        return;
+
+    lock_guard<std::mutex> lock(eventMutex);
+    if (frames.size() != frameCapacity)
+        frames.resize(frameCapacity);
+
+    currentFrame = static_cast<unsigned int>(frameIndex % frameCapacity);
+    FrameRecord& frame = frames[currentFrame];
+    frame.frameIndex = frameIndex;
+    frame.startMicros = nowMicros();
+    frame.durationMicros = 0;
+    frame.events.clear(); // Keeps its capacity, steady state frames don't allocate
+    frameOpen = true;
+}
+
+void Profiler::endFrame()
+{
+    if (!enabled)
+        return;
+
+    lock_guard<std::mutex> lock(eventMutex);
+    if (!frameOpen)
+        return;
+
+    FrameRecord& frame = frames[currentFrame];
+    frame.durationMicros = nowMicros() - frame.startMicros;
+    frameOpen = false;
+    frameIndex++;
+}
+
+long long Profiler::nowMicros()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+unsigned int Profiler::enterScope()
+{
+    return scopeDepth++;
+}
+
+void Profiler::record(const char* name, long long startMicros, unsigned int depth)
+{
+    scopeDepth = depth;
+    const long long end = nowMicros();
+
+    lock_guard<std::mutex> lock(eventMutex);
+    // Markers outside beginFrame/endFrame (loading before the loop, for example) have nowhere to go
+    if (!frameOpen)
+        return;
+
+    ProfileEvent event;
+    event.name = name;
+    event.startMicros = startMicros;
+    event.durationMicros = end - startMicros;
+    event.depth = depth;
+    event.thread = getThreadIndex();
+    frames[currentFrame].events.push_back(event);
+}
+
+const vector<ProfileEvent>& Profiler::getLastFrameEvents()
+{
+    static const vector<ProfileEvent> empty;
+    if (frameIndex == 0 || frames.empty())
+        return empty;
+    return frames[(frameIndex - 1) % frameCapacity].events;
+}
+
+double Profiler::getLastFrameMs()
+{
+    if (frameIndex == 0 || frames.empty())
+        return 0.0;
+    return frames[(frameIndex - 1) % frameCapacity].durationMicros / 1000.0;
+}
+
+bool Profiler::exportChromeTrace(const string& path)
+{
+    lock_guard<std::mutex> lock(eventMutex);
+
+    ofstream file(path);
+    if (!file.is_open())
+    {
+        cout << "Failed to write profiler trace: " << path << endl;
+        return false;
+    }
+
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+
+    // Only frames written since the ring was last cleared, an empty ring has none
+    const unsigned long long writtenFrames = frames.empty() ? 0 : frameIndex;
+    const unsigned long long closedFrames = writtenFrames < frameCapacity ? writtenFrames : frameCapacity;
+    for (unsigned long long i = frameIndex - closedFrames; i < frameIndex; i++)
+    {
+        const FrameRecord& frame = frames[i % frameCapacity];
+
+        file << (first ? "" : ",\n");
+        file << "{\"name\":\"Frame " << frame.frameIndex << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+            << ",\"ts\":" << frame.startMicros << ",\"dur\":" << frame.durationMicros << "}";
+        first = false;
+
+        for (const ProfileEvent& event : frame.events)
+        {
+            file << ",\n{\"name\":\"";
+            writeEscaped(file, event.name);
+            file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+                << ",\"ts\":" << event.startMicros << ",\"dur\":" << event.durationMicros
+                << ",\"args\":{\"depth\":" << event.depth << "}}";
+        }
+    }
+
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return true;
+}
+
+void Profiler::clear()
+{
+    lock_guard<std::mutex> lock(eventMutex);
+    frames.clear();
+    currentFrame = 0;
+    frameIndex = 0;
+    frameOpen = false;
+}
+
+// ProfileScope
+
+ProfileScope::ProfileScope(const char* name) : name(name), start(0), depth(0), active(Profiler::isEnabled())
+{
+    if (!active)
+        return;
+
+    depth = Profiler::enterScope();
+    start = Profiler::nowMicros();
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (active)
+        Profiler::record(name, start, depth);
+}
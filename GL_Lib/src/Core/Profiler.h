@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "deps.h"
+
+// Scoped markers, define GLLIB_PROFILER_DISABLED to compile them out entirely.
+// While compiled in, a disabled profiler costs one branch per marker.
+#define GLLIB_PROFILE_CONCAT_INNER(a, b) a##b
+#define GLLIB_PROFILE_CONCAT(a, b) GLLIB_PROFILE_CONCAT_INNER(a, b)
+#ifndef GLLIB_PROFILER_DISABLED
+#define GLLIB_PROFILE_SCOPE(name) gllib::ProfileScope GLLIB_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define GLLIB_PROFILE_SCOPE(name)
+#endif
+#define GLLIB_PROFILE_FUNCTION() GLLIB_PROFILE_SCOPE(__FUNCTION__)
+
+namespace gllib
+{
+    /// <summary>
+    /// One closed marker. Name must be a string literal or outlive the profiler.
+    /// </summary>
+    struct DLLExport ProfileEvent
+    {
+        const char* name;
+        long long startMicros; // Since the profiler started
+        long long durationMicros;
+        unsigned int depth;
+        unsigned int thread;
+    };
+
+    /// <summary>
+    /// Fully static class. Collects nested CPU markers per frame into a ring of the last frames,
+    /// which can be written out as Chrome trace JSON (chrome://tracing, Perfetto).
+    /// </summary>
+    class DLLExport Profiler
+    {
+    private:
+        struct FrameRecord
+        {
+            unsigned long long frameIndex = 0;
+            long long startMicros = 0;
+            long long durationMicros = 0;
+            std::vector<ProfileEvent> events;
+        };
+
+        static std::atomic<bool> enabled; // Read by markers on any thread without the lock
+        static std::vector<FrameRecord> frames;
+        static unsigned int frameCapacity;
+        static unsigned int currentFrame;
+        static unsigned long long frameIndex;
+        static bool frameOpen;
+        static std::mutex eventMutex;
+
+        static unsigned int getThreadIndex();
+        static void writeEscaped(std::ostream& out, const char* text);
+
+    public:
+        static void setEnabled(bool isEnabled);
+        static bool isEnabled();
+        /// <summary>
+        /// Frames kept in the ring, older ones are overwritten. Clears what was recorded and restarts the frame count.
+        /// </summary>
+        static void setFrameCapacity(unsigned int capacity);
+
+        static void beginFrame();
+        static void endFrame();
+
+        static long long nowMicros();
+        static unsigned int enterScope();
+        static void record(const char* name, long long startMicros, unsigned int depth);
+
+        /// <summary>
+        /// Events of the last closed frame, in the order they ended
+        /// </summary>
+        static const std::vector<ProfileEvent>& getLastFrameEvents();
+        static double getLastFrameMs();
+        /// <summary>
+        /// Writes every closed frame in the ring as complete ("X") events, oldest first
+        /// </summary>
+        static bool exportChromeTrace(const std::string& path);
+        static void clear();
+    };
+
+    /// <summary>
+    /// Measures the scope it lives in, use it through GLLIB_PROFILE_SCOPE
+    /// </summary>
+    class DLLExport ProfileScope
+    {
+    private:
+        const char* name;
+        long long start;
+        unsigned int depth;
+        bool active;
+
+    public:
+        explicit ProfileScope(const char* name);
+        ~ProfileScope();
+    };
+}
@@ -3,7 +3,14 @@
 #include <iostream>
 
 #include "Input.h"
+#include "Profiler.h"
+#include "Rendering/DebugDraw.h"
+#include "Rendering/GeometryArena.h"
+#include "Rendering/GpuProfiler.h"
 #include "Rendering/renderer.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/SpriteBatch.h"
+#include "Rendering/UniformBuffers.h"
 #include "Rendering/Shader.h"
 
 using namespace gllib;
@@ -11,9 +18,13 @@ using namespace std;
 
 // Constr/Destr
 
-BaseGame::BaseGame()
+BaseGame::BaseGame() : BaseGame(false)
 {
-    window = new Window(640, 480, "Loading...");
+}
+
+BaseGame::BaseGame(bool headless, int width, int height) : libCore(headless)
+{
+    window = new Window(width, height, "Loading...", headless);
 
     // Confirm that the window has been properly initialized
     if (!window->getIsInitialized())
@@ -23,12 +34,16 @@ BaseGame::BaseGame()
         return;
     }
     glfwSetWindowUserPointer(window->getReference(), this);
-    glfwSetInputMode(window->getReference(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (!headless)
+        glfwSetInputMode(window->getReference(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     // Make the window's context current
     window->makeContextCurrent();
     // Initialize the GLAD library
     LibCore::initGlad();
+    // Headless frames go to an offscreen framebuffer, there is no default one to present
+    if (headless)
+        window->createOffscreenTarget();
 
     input = new Input(window->getReference());
 
@@ -60,6 +75,16 @@ BaseGame::~BaseGame()
 
 // Private
 
+void BaseGame::updateStatsTitle()
+{
+    const double now = LibTime::getElapsedTime();
+    if (now - statsTitleTime < 0.5)
+        return;
+    statsTitleTime = now;
+
+    window->setTitle("fps " + to_string(LibTime::getFPS()) + " | " + RenderStats::toString(RenderStats::getLastFrame()));
+}
+
 bool BaseGame::initInternal()
 {
     // Check if the PC has a working OpenGL driver
@@ -78,23 +103,24 @@ bool BaseGame::initInternal()
     shaderProgramSolidColor = Shader::createShader(vertexSource1, fragmentSource1);
     shaderProgramTexture = Shader::createShader(vertexSource2, fragmentSource2);
     shaderProgramLighting = Shader::createShader(vertexLightingSource, fragmentLightingSource);
-    Renderer::shader3DProgram = shaderProgramLighting;
+    Renderer::setShader3DProgram(shaderProgramLighting);
+    DebugDraw::setShaderProgram(shaderProgramSolidColor);
     // Set current shader program
     Shader::setShaderProgram(shaderProgramSolidColor);
 
-    // Add point light parameters
-    Shader::setVec3(shaderProgramLighting, "lightColor", 1.0f, 1.0f, 1.0f);
-    Shader::setVec3(shaderProgramLighting, "lightPos", 5.0f, 5.0f, 5.0f);
-
-    // Set attenuation values
-    Shader::setFloat(shaderProgramLighting, "light.constant", 1.0f);
-    Shader::setFloat(shaderProgramLighting, "light.linear", 0.09f);
-    Shader::setFloat(shaderProgramLighting, "light.quadratic", 0.032f);
+    // Light parameters come from the Light instances through the light uniform buffer
     importer = new ModelLoader();
     init();
     updateInternal();
+    AsyncModelLoader::stop();
+    ModelAsset::destroyAll();
     Shader::destroyShader(shaderProgramSolidColor);
     Shader::destroyShader(shaderProgramTexture);
+    UniformBuffers::destroy();
+    DebugDraw::destroy();
+    SpriteBatch::destroy();
+    GeometryArena::destroy();
+    GpuProfiler::destroy();
 
     return true;
 }
@@ -104,13 +130,45 @@ void BaseGame::updateInternal()
     // Loop until the user closes the window
     while (!window->getShouldClose())
     {
-        cameraController->processInput();
-        update();
-
-        // Swap front and back buffers
-        window->swapBuffers();
-        // Poll for and process events
-        LibCore::pollEvents();
+        Profiler::beginFrame();
+        GpuProfiler::beginFrame();
+        {
+            GLLIB_PROFILE_SCOPE("BaseGame::frame");
+            // Models loading in the background become drawable a few meshes at a time
+            AsyncModelLoader::pumpUploads(uploadBudgetMs);
+            {
+                GLLIB_PROFILE_SCOPE("BaseGame::update");
+                cameraController->processInput();
+                update();
+            }
+            {
+                GLLIB_PROFILE_SCOPE("BaseGame::flush");
+                // Draw everything queued this frame sorted by state
+                RenderQueue::flush();
+                {
+                    GLLIB_GPU_PROFILE_SCOPE("SpriteBatch::flush");
+                    // 2D shapes and sprites in layer order, runs sharing a texture merge
+                    SpriteBatch::flush();
+                }
+                {
+                    GLLIB_GPU_PROFILE_SCOPE("DebugDraw::flush");
+                    // Debug lines go on top of the frame in a single draw
+                    DebugDraw::flush(Renderer::getProjectionMatrix() * Renderer::getViewMatrix());
+                }
+            }
+            {
+                GLLIB_PROFILE_SCOPE("BaseGame::swapBuffers");
+                // Swap front and back buffers
+                window->swapBuffers();
+            }
+            // Poll for and process events
+            LibCore::pollEvents();
+        }
+        GpuProfiler::endFrame();
+        Profiler::endFrame();
+        RenderStats::endFrame();
+        if (statsInTitle)
+            updateStatsTitle();
     }
 }
 
@@ -9,6 +9,7 @@
 #include "Entities/sprite.h"
 #include "Entities/animation.h"
 #include "Entities/Cube.h"
+#include "Importer/AsyncModelLoader.h"
 #include "Importer/ModelLoader.h"
 #include "Importer/Model.h"
 #include "Importer/Mesh.h"
@@ -20,14 +21,22 @@
 #include "Math/collisionManager.h"
 #include "Rendering/Light/SpotLight.h"
 #include "Rendering/BSP/BSPSystem.h"
+#include "Rendering/DebugDraw.h"
+#include "Rendering/RenderStats.h"
+#include "Rendering/SpriteBatch.h"
+#include "Rendering/ShaderProgram.h"
 
 namespace gllib {
 
 	class DLLExport BaseGame {
 	private:
 		LibCore libCore;
+		bool statsInTitle = false;
+		double statsTitleTime = 0.0;
+		float uploadBudgetMs = 2.0f;
 		
 		bool initInternal();
+		void updateStatsTitle();
 		void updateInternal();
 		void uninitInternal();
 
@@ -38,9 +47,9 @@ namespace gllib {
 		CameraController* cameraController;
 		ModelLoader* importer;
 
-		unsigned int shaderProgramSolidColor;
-		unsigned int shaderProgramTexture;
-		unsigned int shaderProgramLighting;
+		ShaderProgram shaderProgramSolidColor;
+		ShaderProgram shaderProgramTexture;
+		ShaderProgram shaderProgramLighting;
 
 		virtual void init() {}
 		virtual void update() {}
@@ -48,10 +57,27 @@ namespace gllib {
 
 	public:
 		BaseGame();
+		/// <summary>
+		/// Headless games never open a visible window and render into a width x height offscreen framebuffer,
+		/// without a display they run on the GLFW null platform with OSMesa
+		/// </summary>
+		BaseGame(bool headless, int width = 640, int height = 480);
 		virtual ~BaseGame();
 
 		Camera getCamera() { return *camera; }
 		CameraController* getCameraController() { return cameraController; }
+		/// <summary>
+		/// Counts of the last finished frame
+		/// </summary>
+		const FrameRenderStats& getRenderStats() const { return RenderStats::getLastFrame(); }
+		/// <summary>
+		/// Shows fps, draws and culling counts in the window title, refreshed twice per second
+		/// </summary>
+		void setShowStatsInTitle(bool show) { statsInTitle = show; }
+		/// <summary>
+		/// Milliseconds per frame spent uploading models loaded with Model(path, gamma, true)
+		/// </summary>
+		void setUploadBudget(float milliseconds) { uploadBudgetMs = milliseconds; }
 		
 		void start();
 	};
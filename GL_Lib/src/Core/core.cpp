@@ -3,12 +3,23 @@
 #include "deps.h"
 #include "lib_time.h"
 
+#include <cstdlib>
 #include <iostream>
 
 using namespace gllib;
 using namespace std;
 
-LibCore::LibCore() {
+bool LibCore::headless = false;
+
+LibCore::LibCore(bool headless) {
+    LibCore::headless = headless;
+#ifndef _WIN32
+    // Build agents have no X11 or Wayland display, init would fail on the default platform
+    if (headless && !getenv("DISPLAY") && !getenv("WAYLAND_DISPLAY")) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif // _WIN32
+
     if (!glfwInit()) {
         cout << "Failed to initialize GLFW!\n";
     }
@@ -22,6 +33,10 @@ LibCore::~LibCore() {
     glfwTerminate();
 }
 
+bool LibCore::isHeadless() {
+    return headless;
+}
+
 bool LibCore::initGlad() {
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         cout << "Failed to initialize GLAD\n";
@@ -4,10 +4,19 @@
 namespace gllib {
 
 	class DLLExport LibCore {
+	private:
+		static bool headless;
+
 	public:
-		LibCore();
+		/// <summary>
+		/// Headless picks the GLFW null platform when there is no display to connect to,
+		/// windows then get an OSMesa context (Mesa llvmpipe)
+		/// </summary>
+		LibCore(bool headless = false);
 		~LibCore();
 
+		static bool isHeadless();
+
 		/// <summary>
 		/// Can only be called after initializing a window and setting up the glfw context
 		/// </summary>
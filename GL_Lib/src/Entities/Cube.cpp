@@ -1,18 +1,45 @@
 #include "Cube.h"
 
 #include "../Rendering/renderer.h"
+#include "../Rendering/GLStateCache.h"
 #include "../Rendering/shader.h"
+#include "../Importer/Mesh.h"
+#include <cstddef>
 #include <gtc/type_ptr.hpp>
+#include "Rendering/RenderStats.h"
 
 
 using namespace gllib;
 
+GeometryAllocation Cube::geometry;
+
 Cube::Cube(Transform transform, Material* material) : Entity(transform), material(material), ownsMaterial(false)
 {
     this->color = glm::vec3(color.r, color.g, color.b);
     this->material = material;
 
-    float vertices[] = {
+    createGeometry();
+}
+
+Cube::Cube(Transform transform, glm::vec4 color) : Entity(transform), material(nullptr), ownsMaterial(false)
+{
+    this->color = glm::vec3(color.r, color.g, color.b);
+
+    createGeometry();
+}
+
+Cube::~Cube()
+{
+    // The geometry is shared by every cube and stays alive with the arena
+}
+
+void Cube::createGeometry()
+{
+    if (geometry.VAO != 0)
+        return;
+
+    // Position, normal, texture coordinates
+    const float vertices[] = {
         // Front face
         -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
         0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
@@ -50,8 +77,7 @@ Cube::Cube(Transform transform, Material* material) : Entity(transform), materia
         -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f
     };
 
-
-    unsigned int indices[] = {
+    const unsigned int indices[] = {
         0, 1, 2, 2, 3, 0, // Front face
         4, 5, 6, 6, 7, 4, // Back face
         8, 9, 10, 10, 11, 8, // Left face
@@ -60,111 +86,50 @@ Cube::Cube(Transform transform, Material* material) : Entity(transform), materia
         20, 21, 22, 22, 23, 20 // Top face
     };
 
-    glGenVertexArrays(1, &VAO);
+    // Same layout as imported meshes so cubes share their VAO and batch with them
+    Vertex meshVertices[24] = {};
+    for (int i = 0; i < 24; i++)
+    {
+        const float* v = &vertices[i * 8];
+        meshVertices[i].Position = glm::vec3(v[0], v[1], v[2]);
+        meshVertices[i].Normal = glm::vec3(v[3], v[4], v[5]);
+        meshVertices[i].TexCoords = glm::vec2(v[6], v[7]);
+    }
+
+    geometry = GeometryArena::allocate(VertexFormat_Mesh, meshVertices, 24, indices, 36);
+    if (geometry.inArena)
+        return;
+
+    unsigned int VBO, EBO;
+    glGenVertexArrays(1, &geometry.VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
+    GLStateCache::bindVertexArray(geometry.VAO);
 
     // Bind and fill vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+    RenderStats::countBufferAllocation();
+    glBufferData(GL_ARRAY_BUFFER, sizeof(meshVertices), meshVertices, GL_STATIC_DRAW);
 
     // Bind and fill element buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    RenderStats::countBufferAllocation();
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
     glEnableVertexAttribArray(0);
 
     // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
     glEnableVertexAttribArray(1);
 
     // Texture coordinate attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
-
-Cube::Cube(Transform transform, glm::vec4 color) : Entity(transform)
-{
-    this->color = glm::vec3(color.r, color.g, color.b);
-
-    float vertices[] = {
-        -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
-        0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
-        -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-
-        -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
-        0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
-        0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f,
-        -0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
-
-        -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        -0.5f, 0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        -0.5f, -0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-
-        0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f, 0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-        0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-
-        -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-        0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-        0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
-        -0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
-
-        -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-        0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-        0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-        -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f
-    };
-
-    unsigned int indices[] = {
-        0, 1, 2, 2, 3, 0,
-        4, 5, 6, 6, 7, 4,
-        8, 9, 10, 10, 11, 8,
-        12, 13, 14, 14, 15, 12,
-        16, 17, 18, 18, 19, 16,
-        20, 21, 22, 22, 23, 20
-    };
-
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
     glEnableVertexAttribArray(2);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
-
-Cube::~Cube()
-{
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    geometry.indexCount = 36;
 }
 
 void Cube::setMaterial(Material* newMaterial, bool takeOwnership)
@@ -183,27 +148,25 @@ void Cube::draw()
     if (material)
     {
         // Use the proper renderer function that handles lighting
-        Renderer::drawEntity3D(VAO, 36, *material, getModelMatrix());
+        Renderer::drawEntity3D(geometry, *material, getModelMatrix());
     }
     else
     {
         // Fallback to basic rendering without material
         unsigned int shaderProgram = Shader::getCurrentShaderProgram();
-        Shader::setMat4(shaderProgram, "model", getModelMatrix());
-
-        glm::mat4 model = getModelMatrix();
-
-        int modelLoc = glGetUniformLocation(shaderProgram, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        GLStateCache::useProgram(shaderProgram);
 
-        int objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
-        if (objectColorLoc != -1)
+        // Reflected handles, inactive uniforms come back invalid and are skipped
+        const ShaderProgram* program = Shader::getProgram(shaderProgram);
+        if (program)
         {
-            glUniform3fv(objectColorLoc, 1, glm::value_ptr(color));
+            ShaderProgram::setMat4(program->getUniform("model"), getModelMatrix());
+            ShaderProgram::setVec3(program->getUniform("objectColor"), color);
         }
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        GLStateCache::bindVertexArray(geometry.VAO);
+        RenderStats::countDraw(geometry.indexCount);
+        glDrawElementsBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT,
+                                 (void*)(sizeof(unsigned int) * geometry.firstIndex), geometry.baseVertex);
     }
 }
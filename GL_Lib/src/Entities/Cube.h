@@ -1,11 +1,15 @@
 #pragma once
 #include "entity.h"
 #include "../Rendering/Light/Material.h"
+#include "../Rendering/GeometryArena.h"
 
 namespace gllib {
     class DLLExport Cube : public Entity {
     private:
-        unsigned int VAO, VBO, EBO;
+        // Every cube draws the same unit cube
+        static GeometryAllocation geometry;
+        static void createGeometry();
+
         glm::vec3 color;
         Material* material;
         bool ownsMaterial;
@@ -15,10 +15,7 @@ namespace gllib
         indices = new unsigned int();
         vertices = new float();
 
-        transform = Transform();
-        transform.position = glm::vec3(0.0f);
-        transform.scale = glm::vec3(1.0f);
-        transform.rotationQuat = Quaternion{1.0f, 0.0f, 0.0f, 0.0f};
+        transform = Transform(glm::vec3(0.0f), glm::vec3(1.0f), Quaternion{1.0f, 0.0f, 0.0f, 0.0f});
     }
 
     Entity2::~Entity2()
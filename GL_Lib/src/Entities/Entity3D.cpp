@@ -180,6 +180,8 @@ namespace gllib
     {
         if (!bspSystem) return;
         
+        // The bounds place the plane in the tree, they have to match where the wall is now
+        transform.updateTRSAndAABB();
         BSPPlane plane = createBSPPlane();
         bspSystem->addPlane(plane);
     }
@@ -190,12 +192,16 @@ namespace gllib
         
         // Transform the local +Z normal by the rotation
         glm::vec3 localNormal(0.0f, 0.0f, 1.0f);
-        glm::mat3 rotationMatrix = glm::toMat3(transform.rotationQuat);
+        const Quaternion& rotation = transform.getRotation();
+        glm::mat3 rotationMatrix = glm::toMat3(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
         plane.normal = glm::normalize(rotationMatrix * localNormal);
         
         // Distance from origin to plane along normal
-        glm::vec3 pointOnPlane = transform.position;
+        glm::vec3 pointOnPlane = transform.getPosition();
         plane.distance = -glm::dot(plane.normal, pointOnPlane);
+
+        plane.boundsMin = transform.getWorldAABBMin();
+        plane.boundsMax = transform.getWorldAABBMax();
         
         return plane;
     }
@@ -60,6 +60,14 @@ namespace gllib
         }
     }
 
+    void Animation::addFramesFromAtlas(const TextureAtlas& atlas, const std::string& prefix, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            addFrame(atlas, prefix + "_" + std::to_string(i));
+        }
+    }
+
     void Animation::setDurationInSecs(double durationInSecs)
     {
         this->durationInSecs = durationInSecs;
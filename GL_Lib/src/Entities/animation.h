@@ -20,6 +20,10 @@ namespace gllib
 
         void addFramesFromAtlas(unsigned int textureID, int startX, int startY, int frameWidth, int frameHeight, int columns, int rows);
         void addFrames(unsigned int textureID, int frameWidth, int frameHeight, int columns, int rows);
+        /// <summary>
+        /// Adds the frames "prefix_0" to "prefix_(count - 1)", as registered by TextureAtlas::addSheet
+        /// </summary>
+        void addFramesFromAtlas(const TextureAtlas& atlas, const std::string& prefix, int count);
         void setDurationInSecs(double durationInSecs);
         void setAnimationPaused(bool paused);
 
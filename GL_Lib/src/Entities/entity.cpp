@@ -7,9 +7,9 @@ namespace gllib
 {
     Entity::Entity(const glm::vec3& translation, const glm::vec3& rotationEuler, const glm::vec3& scale)
     {
-        transform.position = translation;
-        transform.rotationQuat = Maths::Euler(rotationEuler);
-        transform.scale = scale;
+        transform.setPosition(translation);
+        transform.setRotation(Maths::Euler(rotationEuler));
+        transform.setScale(scale);
     }
 
     Entity::Entity(const Transform& transform): transform(transform)
@@ -21,7 +21,7 @@ namespace gllib
 
     void Entity::move(const glm::vec3 direction)
     {
-        transform.position += direction;
+        transform.setPosition(transform.getPosition() + direction);
     }
 
     void Entity::rotate(const glm::vec3 eulerRotation)
@@ -30,14 +30,16 @@ namespace gllib
         rotationQuat.x = eulerRotation.x;
         rotationQuat.y = eulerRotation.y;
         rotationQuat.z = eulerRotation.z;
-        transform.rotationQuat += rotationQuat;
+        Quaternion rotation = transform.getRotation();
+        rotation += rotationQuat;
+        transform.setRotation(rotation);
     }
 
     void Entity::updateTransform()
     {
-        transform.forward = Maths::Quat2Vec3(transform.rotationQuat, glm::vec3(0, 0, 1));
-        transform.upward = Maths::Quat2Vec3(transform.rotationQuat, glm::vec3(0, 1, 0));
-        transform.right = Maths::Quat2Vec3(transform.rotationQuat, glm::vec3(1, 0, 0));
+        transform.forward = Maths::Quat2Vec3(transform.getRotation(), glm::vec3(0, 0, 1));
+        transform.upward = Maths::Quat2Vec3(transform.getRotation(), glm::vec3(0, 1, 0));
+        transform.right = Maths::Quat2Vec3(transform.getRotation(), glm::vec3(1, 0, 0));
     }
 
     glm::vec3 Entity::upward() const
@@ -62,68 +64,68 @@ namespace gllib
 
     glm::vec3 Entity::getPosition() const
     {
-        return transform.position;
+        return transform.getPosition();
     }
 
     glm::vec3 Entity::getScale() const
     {
-        return transform.scale;
+        return transform.getScale();
     }
 
     glm::vec3 Entity::getRotationEuler() const
     {
-        return Maths::Quat2Vec3(transform.rotationQuat, glm::vec3(1, 1, 1));
+        return Maths::Quat2Vec3(transform.getRotation(), glm::vec3(1, 1, 1));
     }
 
     Quaternion Entity::getRotationQuat() const
     {
-        return transform.rotationQuat;
+        return transform.getRotation();
     }
 
     void Entity::setTransform(const Transform& transform)
     {
         this->transform = transform;
+        this->transform.markDirty();
     }
 
     void Entity::setPosition(const glm::vec3& position)
     {
-        transform.position = position;
+        transform.setPosition(position);
     }
 
     void Entity::setScale(const glm::vec3& scale)
     {
-        transform.scale = scale;
+        transform.setScale(scale);
     }
 
     void Entity::setRotationQuat(const Quaternion& rotation)
     {
-        
-        transform.rotationQuat =  rotation;
+        transform.setRotation(rotation);
     }
 
     void Entity::setRotationEuler(const glm::vec3& rotation)
     {
-        transform.rotationQuat = Maths::Euler(rotation);
+        transform.setRotation(Maths::Euler(rotation));
     }
 
     bool Entity::isColliding(const Transform& _transform) const
     {
-        float xOffset = 0.5f * transform.scale.x;
-        float yOffset = 0.5f * transform.scale.y;
+        float xOffset = 0.5f * transform.getScale().x;
+        float yOffset = 0.5f * transform.getScale().y;
 
-        float thisAdjustedX = transform.position.x - xOffset;
-        float thisAdjustedY = transform.position.y - yOffset;
+        float thisAdjustedX = transform.getPosition().x - xOffset;
+        float thisAdjustedY = transform.getPosition().y - yOffset;
 
-        xOffset = 0.5f * _transform.scale.x;
-        yOffset = 0.5f * _transform.scale.y;
+        xOffset = 0.5f * _transform.getScale().x;
+        yOffset = 0.5f * _transform.getScale().y;
 
-        float otherAdjustedX = _transform.position.x - xOffset;
-        float otherAdjustedY = _transform.position.y - yOffset;
+        float otherAdjustedX = _transform.getPosition().x - xOffset;
+        float otherAdjustedY = _transform.getPosition().y - yOffset;
 
-        if (thisAdjustedX + transform.scale.x >= otherAdjustedX &&
-            thisAdjustedX <= otherAdjustedX + _transform.scale.x &&
-            thisAdjustedY + transform.scale.y >= otherAdjustedY &&
-            thisAdjustedY <= otherAdjustedY + _transform.scale.y)
+        if (thisAdjustedX + transform.getScale().x >= otherAdjustedX &&
+            thisAdjustedX <= otherAdjustedX + _transform.getScale().x &&
+            thisAdjustedY + transform.getScale().y >= otherAdjustedY &&
+            thisAdjustedY <= otherAdjustedY + _transform.getScale().y)
         {
             return true;
         }
@@ -133,10 +135,10 @@ namespace gllib
 
     bool Entity::isColliding(float x, float y, float width, float height) const
     {
-        if (transform.position.x + transform.scale.x >= x &&
-            transform.position.x <= x + width &&
-            transform.position.y + transform.scale.y >= y &&
-            transform.position.y <= y + height)
+        if (transform.getPosition().x + transform.getScale().x >= x &&
+            transform.getPosition().x <= x + width &&
+            transform.getPosition().y + transform.getScale().y >= y &&
+            transform.getPosition().y <= y + height)
         {
             return true;
         }
@@ -147,13 +149,14 @@ namespace gllib
     {
         glm::mat4 model = glm::mat4(1.0f);
 
-        model = glm::translate(model, glm::vec3(transform.position.x, transform.position.y, transform.position.z));
+        model = glm::translate(model, transform.getPosition());
 
-        glm::quat glmQuat(transform.rotationQuat.w, transform.rotationQuat.x, transform.rotationQuat.y, transform.rotationQuat.z);
+        const Quaternion& rotation = transform.getRotation();
+        glm::quat glmQuat(rotation.w, rotation.x, rotation.y, rotation.z);
         glm::mat4 rotationMatrix = glm::mat4_cast(glmQuat);
         model = model * rotationMatrix;
 
-        model = glm::scale(model, glm::vec3(transform.scale.x, transform.scale.y, transform.scale.z));
+        model = glm::scale(model, transform.getScale());
 
         return model;
     }
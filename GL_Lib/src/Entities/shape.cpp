@@ -1,7 +1,11 @@
 #include "shape.h"
 
+#include <algorithm>
 #include <iostream>
 
+#include "../Rendering/shader.h"
+#include "../Rendering/SpriteBatch.h"
+
 using namespace gllib;
 using namespace std;
 
@@ -11,6 +15,9 @@ Shape::Shape(glm::vec3 translation, glm::vec3 rotation, glm::vec3 scale) :
     renderData.VBO = 0;
     renderData.EBO = 0;
     indexSize = 0;
+    layer = 0;
+    geometryDirty = false;
+    vertexDirty = false;
     cout << "Created shape.\n";
 }
 
@@ -20,13 +27,18 @@ Shape::Shape(Transform transform) :
     renderData.VBO = 0;
     renderData.EBO = 0;
     indexSize = 0;
+    layer = 0;
+    geometryDirty = false;
+    vertexDirty = false;
     cout << "Created shape.\n";
 }
 
 Shape::~Shape() {
     cout << "Destroyed shape.\n";
     // Destroy the render data to free up vram
-    Renderer::destroyRenderData(renderData);
+    if (renderData.VAO > 0) {
+        Renderer::destroyRenderData(renderData);
+    }
 }
 
 // Protected
@@ -54,25 +66,79 @@ void Shape::alignVertex(float* vertexData, int vertexCount, int vertexStride) {
 }
 
 void Shape::setRenderData(const float vertexData[], int vertexDataSize, const int index[], int indexSize) {
-    if (renderData.VAO > 0) {
-        Renderer::destroyRenderData(renderData);
-    }
+    // Same layout as before means the existing buffers can take the new vertices as they are
+    const bool sameLayout = this->vertexData.size() == static_cast<size_t>(vertexDataSize) &&
+        indexData.size() == static_cast<size_t>(indexSize) && std::equal(index, index + indexSize, indexData.begin());
+
     // Update the size of the index (The size will depend on the shape drawn)
     this->indexSize = indexSize;
-
-    // Create the render data for the buffers
-    renderData = Renderer::createRenderData(vertexData, vertexDataSize, index, indexSize);
+    this->vertexData.assign(vertexData, vertexData + vertexDataSize);
+    if (!sameLayout) {
+        indexData.assign(index, index + indexSize);
+        geometryDirty = true;
+    }
+    else {
+        vertexDirty = true;
+    }
 }
 
 void Shape::internalDraw() {
+    internalDraw(0);
+}
+
+void Shape::internalDraw(unsigned int textureID) {
+    if (SpriteBatch::isEnabled()) {
+        SpriteBatch::submit(vertexData.data(), static_cast<unsigned int>(vertexData.size() / 9), indexData.data(),
+                            indexSize, getTRS(), textureID, Shader::getCurrentShaderProgram(), layer);
+        return;
+    }
+
+    uploadRenderData();
+    Renderer::setModelMatrix(getTRS());
+    if (textureID != 0) {
+        Renderer::drawTexture(renderData, indexSize, textureID);
+    }
+    else {
+        Renderer::drawElements(renderData, indexSize);
+    }
+}
+
+// Private
+
+glm::mat4 Shape::getTRS() const {
     glm::mat4 trs = glm::mat4(1.0f);
 
-    trs = glm::translate(glm::mat4(1.0f), glm::vec3(transform.position.x, transform.position.y, transform.position.z));
-    trs = glm::rotate(trs, glm::radians(transform.rotationQuat.x), glm::vec3(1.0, 0.0f, 0.0f));
-    trs = glm::rotate(trs, glm::radians(transform.rotationQuat.y), glm::vec3(0.0f, 1.0f, 0.0f));
-    trs = glm::rotate(trs, glm::radians(transform.rotationQuat.z), glm::vec3(0.0f, 0.0f, 1.0f));
-    trs = glm::scale(trs, glm::vec3(transform.scale.x, transform.scale.y, 1.0f));
+    trs = glm::translate(glm::mat4(1.0f), transform.getPosition());
+    trs = glm::rotate(trs, glm::radians(transform.getRotation().x), glm::vec3(1.0, 0.0f, 0.0f));
+    trs = glm::rotate(trs, glm::radians(transform.getRotation().y), glm::vec3(0.0f, 1.0f, 0.0f));
+    trs = glm::rotate(trs, glm::radians(transform.getRotation().z), glm::vec3(0.0f, 0.0f, 1.0f));
+    trs = glm::scale(trs, glm::vec3(transform.getScale().x, transform.getScale().y, 1.0f));
+    return trs;
+}
+
+void Shape::uploadRenderData() {
+    if (renderData.VAO == 0 || geometryDirty) {
+        if (renderData.VAO > 0) {
+            Renderer::destroyRenderData(renderData);
+        }
+        // Create the render data for the buffers
+        renderData = Renderer::createRenderData(vertexData.data(), static_cast<GLsizei>(vertexData.size()),
+                                                indexData.data(), indexSize);
+    }
+    else if (vertexDirty) {
+        Renderer::updateVertexBuffer(renderData, vertexData.data(), static_cast<GLsizei>(vertexData.size()));
+    }
+
+    geometryDirty = false;
+    vertexDirty = false;
+}
+
+// Public
+
+void Shape::setLayer(int layer) {
+    this->layer = layer;
+}
 
-    Renderer::setModelMatrix(trs);
-    Renderer::drawElements(renderData, indexSize);
+int Shape::getLayer() const {
+    return layer;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "entity.h"
 #include "../Rendering/renderer.h"
 namespace gllib {
@@ -8,17 +10,38 @@ namespace gllib {
     private:
         RenderData renderData;
         unsigned int indexSize;
+        // CPU copy of the buffers, the sprite batch transforms it every frame
+        std::vector<float> vertexData;
+        std::vector<int> indexData;
+        int layer;
+        // GL buffers are only made when the shape is drawn outside the batch, and then reused
+        bool geometryDirty;
+        bool vertexDirty;
+
+        glm::mat4 getTRS() const;
+        void uploadRenderData();
 
     protected:
         void alignVertex(float* vertexData, int vertexCount, int vertexStride);
+        /// <summary>
+        /// Replaces the shape vertices on the CPU. GL buffers are not touched here, on the next unbatched draw they
+        /// are updated in place, or rebuilt only if the vertex or index count changed.
+        /// </summary>
         void setRenderData(const float vertexData[], int vertexDataSize, const int index[], int indexSize);
         void internalDraw();
+        void internalDraw(unsigned int textureID);
 
     public:
         Shape(glm::vec3 translation, glm::vec3 rotation, glm::vec3 scale);
         Shape(Transform transform);
         virtual ~Shape();
 
+        /// <summary>
+        /// Draw order in the sprite batch, lower layers are drawn first
+        /// </summary>
+        void setLayer(int layer);
+        int getLayer() const;
+
         virtual void draw() = 0;
     };
 }
@@ -11,6 +11,7 @@ Sprite::Sprite(glm::vec3 translation, glm::vec3 rotation, glm::vec3 scale, Color
     mirrorY = false;
     currentFrame = 0;
     frameCount = 0;
+    quadDirty = false;
     updateRenderData();
     cout << "Created sprite.\n";
 }
@@ -22,6 +23,7 @@ Sprite::Sprite(Transform transform, Color color) :
     mirrorY = false;
     currentFrame = 0;
     frameCount = 0;
+    quadDirty = false;
     updateRenderData();
     cout << "Created sprite.\n";
 }
@@ -33,7 +35,8 @@ Sprite::Sprite(Sprite const& other) :
     currentFrame(other.currentFrame),
     frameCount(other.frameCount),
     mirrorX(other.mirrorX),
-    mirrorY(other.mirrorY)
+    mirrorY(other.mirrorY),
+    quadDirty(false)
 {
     updateRenderData();
     cout << "Created sprite.\n";
@@ -107,30 +110,30 @@ Color Sprite::getColor() {
 
 void Sprite::setColor(Color color) {
     this->color = color;
-    updateRenderData();
+    quadDirty = true;
 }
 
 void Sprite::setCurrentFrame(unsigned int index) {
     if (currentFrame == index) return;
     if (index > textures.size() - 1) return;
     currentFrame = index;
-    updateRenderData();
+    quadDirty = true;
 }
 
 void Sprite::setCurrentFrameNext() {
     currentFrame++;
     if (currentFrame == textures.size()) currentFrame = 0;
-    updateRenderData();
+    quadDirty = true;
 }
 
 void Sprite::setMirroredX(bool mirrored) {
     mirrorX = mirrored;
-    updateRenderData();
+    quadDirty = true;
 }
 
 void Sprite::setMirroredY(bool mirrored) {
     mirrorY = mirrored;
-    updateRenderData();
+    quadDirty = true;
 }
 
 void Sprite::addTexture(unsigned int textureID) {
@@ -144,7 +147,7 @@ void Sprite::addTexture(unsigned int textureID) {
     textures.push_back(tex);
     currentFrame = textures.size() - 1;
     frameCount = currentFrame;
-    updateRenderData();
+    quadDirty = true;
 }
 
 void Sprite::addTexture(string path, bool transparent) {
@@ -172,12 +175,45 @@ void Sprite::addFrame(unsigned int textureID, int offsetX, int offsetY, int widt
     textures.push_back(tex);
     currentFrame = textures.size() - 1;
     frameCount = currentFrame;
-    updateRenderData();
+    quadDirty = true;
+}
+
+void Sprite::addFrame(const AtlasFrame& frame) {
+    Frame tex;
+    tex.textureID = frame.textureID;
+    if (tex.textureID == 0) return;
+
+    tex.uvCoords[0] = { frame.uMax, frame.vMax };
+    tex.uvCoords[1] = { frame.uMax, frame.vMin };
+    tex.uvCoords[2] = { frame.uMin, frame.vMin };
+    tex.uvCoords[3] = { frame.uMin, frame.vMax };
+
+    textures.push_back(tex);
+    currentFrame = textures.size() - 1;
+    frameCount = currentFrame;
+    quadDirty = true;
+}
+
+void Sprite::addFrame(const TextureAtlas& atlas, const string& name) {
+    const AtlasFrame* frame = atlas.getFrame(name);
+    if (!frame) {
+        cout << "Atlas has no frame called " << name << "\n";
+        return;
+    }
+    addFrame(*frame);
 }
 
 void Sprite::draw() {
+    // Frame, mirroring and tint are applied here, once per draw at most, so changing them never touches GL
+    if (quadDirty) {
+        updateRenderData();
+        quadDirty = false;
+    }
+
     if (!textures.empty()) {
-        Renderer::bindTexture(textures[currentFrame].textureID);
+        internalDraw(textures[currentFrame].textureID);
+    }
+    else {
+        internalDraw();
     }
-    internalDraw();
 }
\ No newline at end of file
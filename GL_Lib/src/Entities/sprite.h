@@ -1,6 +1,7 @@
 #pragma once
 
 #include "shape.h"
+#include "Importer/TextureAtlas.h"
 
 #include <iostream>
 #include <vector>
@@ -23,6 +24,8 @@ namespace gllib {
 		int frameCount;
 		bool mirrorX;
 		bool mirrorY;
+		// Set by the frame, mirror and color setters, the quad is rebuilt on the next draw
+		bool quadDirty;
 
 		void updateRenderData();
 	protected:
@@ -47,6 +50,11 @@ namespace gllib {
 		void addTexture(std::string path, bool transparent);
 
 		void addFrame(unsigned int textureID, int offsetX, int offsetY, int width, int height);
+		/// <summary>
+		/// Uses the rect the atlas recorded on packing, the atlas must be built first
+		/// </summary>
+		void addFrame(const AtlasFrame& frame);
+		void addFrame(const TextureAtlas& atlas, const std::string& name);
 
 		virtual void draw() override;
 	};
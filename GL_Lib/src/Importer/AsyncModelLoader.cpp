@@ -0,0 +1,219 @@
+#include "AsyncModelLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <stb_image.h>
+
+#include "ModelAsset.h"
+#include "Core/Profiler.h"
+
+using namespace gllib;
+using namespace std;
+
+vector<thread> AsyncModelLoader::workers;
+mutex AsyncModelLoader::jobsMutex;
+condition_variable AsyncModelLoader::jobQueued;
+condition_variable AsyncModelLoader::jobParsed;
+deque<shared_ptr<AsyncModelLoader::Job>> AsyncModelLoader::queued;
+vector<shared_ptr<AsyncModelLoader::Job>> AsyncModelLoader::parsing;
+deque<shared_ptr<AsyncModelLoader::Job>> AsyncModelLoader::parsed;
+bool AsyncModelLoader::stopping = false;
+
+void AsyncModelLoader::workerLoop()
+{
+    while (true)
+    {
+        shared_ptr<Job> job;
+        {
+            unique_lock<std::mutex> lock(jobsMutex);
+            jobQueued.wait(lock, [] { return stopping || !queued.empty(); });
+            if (stopping)
+                return;
+            job = queued.front();
+            queued.pop_front();
+            parsing.push_back(job);
+        }
+
+        // Only this thread touches the job until it is handed to the main thread. The flip setting is per
+        // thread here, the main thread's stb_image state is left alone.
+        stbi_set_flip_vertically_on_load_thread(job->gamma);
+        job->imported = ModelLoader::importScene(job->path, job->model);
+        if (job->imported)
+            ModelLoader::decodeImages(job->model);
+
+        {
+            lock_guard<std::mutex> lock(jobsMutex);
+            parsing.erase(find(parsing.begin(), parsing.end(), job));
+            parsed.push_back(job);
+        }
+        jobParsed.notify_all();
+    }
+}
+
+bool AsyncModelLoader::uploadStep(Job& job)
+{
+    if (!job.imported)
+    {
+        job.asset->completeImport(nullptr, {});
+        return true;
+    }
+
+    // Textures first, the meshes reference them
+    if (job.nextImage < job.model.images.size())
+    {
+        ModelLoader::uploadImage(job.model, job.nextImage++);
+        return false;
+    }
+
+    if (job.nextMesh < job.model.meshes.size())
+    {
+        if (job.meshes.empty())
+            job.meshes.reserve(job.model.meshes.size());
+        job.meshes.push_back(ModelLoader::uploadMesh(job.model, job.nextMesh++));
+        if (job.nextMesh < job.model.meshes.size())
+            return false;
+    }
+
+    job.asset->completeImport(&job.model, std::move(job.meshes));
+    return true;
+}
+
+// Public
+
+void AsyncModelLoader::start(unsigned int threadCount)
+{
+    if (!workers.empty())
+        return;
+
+    if (threadCount == 0)
+    {
+        const unsigned int cores = thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    stopping = false;
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back(workerLoop);
+}
+
+void AsyncModelLoader::stop()
+{
+    {
+        lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobQueued.notify_all();
+    for (thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    // Decoded pixels nobody will upload, and the textures of the jobs cut short. Their meshes free themselves.
+    for (const shared_ptr<Job>& job : parsed)
+    {
+        for (ImportedImage& image : job->model.images)
+            stbi_image_free(image.pixels);
+        for (size_t i = 0; i < job->nextImage; i++)
+            ModelLoader::releaseTexture(job->model.textureIds[i]);
+    }
+    queued.clear();
+    parsing.clear();
+    parsed.clear();
+}
+
+void AsyncModelLoader::enqueue(const shared_ptr<ModelAsset>& asset, const string& path, bool gamma)
+{
+    shared_ptr<Job> job = make_shared<Job>();
+    job->asset = asset;
+    job->path = path;
+    job->gamma = gamma;
+
+    start();
+    {
+        lock_guard<std::mutex> lock(jobsMutex);
+        queued.push_back(job);
+    }
+    jobQueued.notify_one();
+}
+
+size_t AsyncModelLoader::pumpUploads(float budgetMs)
+{
+    GLLIB_PROFILE_SCOPE("AsyncModelLoader::pumpUploads");
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    size_t steps = 0;
+
+    while (true)
+    {
+        shared_ptr<Job> job;
+        {
+            lock_guard<std::mutex> lock(jobsMutex);
+            if (parsed.empty())
+                break;
+            job = parsed.front();
+        }
+
+        const bool complete = uploadStep(*job);
+        steps++;
+        if (complete)
+        {
+            lock_guard<std::mutex> lock(jobsMutex);
+            parsed.erase(find(parsed.begin(), parsed.end(), job));
+        }
+
+        const float elapsedMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+        if (elapsedMs >= budgetMs)
+            break;
+    }
+    return steps;
+}
+
+void AsyncModelLoader::finish(const ModelAsset* asset)
+{
+    const auto isAsset = [asset](const shared_ptr<Job>& job) { return job->asset.get() == asset; };
+
+    shared_ptr<Job> job;
+    bool needsParsing = false;
+    {
+        unique_lock<std::mutex> lock(jobsMutex);
+        deque<shared_ptr<Job>>::iterator queuedIt = find_if(queued.begin(), queued.end(), isAsset);
+        if (queuedIt != queued.end())
+        {
+            // Faster than waiting for a worker to get to it
+            job = *queuedIt;
+            queued.erase(queuedIt);
+            needsParsing = true;
+        }
+        else
+        {
+            jobParsed.wait(lock, [&] { return find_if(parsing.begin(), parsing.end(), isAsset) == parsing.end(); });
+            deque<shared_ptr<Job>>::iterator parsedIt = find_if(parsed.begin(), parsed.end(), isAsset);
+            if (parsedIt == parsed.end())
+            {
+                cout << "Model asset " << asset->getPath() << " is not queued for loading" << endl;
+                return;
+            }
+            job = *parsedIt;
+            parsed.erase(parsedIt);
+        }
+    }
+
+    if (needsParsing)
+    {
+        stbi_set_flip_vertically_on_load(job->gamma);
+        job->imported = ModelLoader::importScene(job->path, job->model);
+        if (job->imported)
+            ModelLoader::decodeImages(job->model);
+    }
+
+    // Continues where pumpUploads left it
+    while (!uploadStep(*job))
+    {
+    }
+}
+
+size_t AsyncModelLoader::getPendingCount()
+{
+    lock_guard<std::mutex> lock(jobsMutex);
+    return queued.size() + parsing.size() + parsed.size();
+}
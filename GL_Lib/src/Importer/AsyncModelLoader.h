@@ -0,0 +1,81 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Core/deps.h"
+#include "Mesh.h"
+#include "ModelLoader.h"
+
+namespace gllib
+{
+    class ModelAsset;
+
+    /// <summary>
+    /// Fully static class. Worker threads parse model files and decode their textures, the GL side is drip-fed
+    /// on the main thread by pumpUploads within a time budget per frame: one texture or one mesh per step,
+    /// the asset becomes Ready after its last mesh. Started on the first request.
+    /// </summary>
+    class DLLExport AsyncModelLoader
+    {
+    private:
+        struct Job
+        {
+            std::shared_ptr<ModelAsset> asset;
+            std::string path;
+            bool gamma;
+
+            ImportedModel model;
+            bool imported = false; // False once parsed means the file could not be read
+            size_t nextImage = 0;
+            size_t nextMesh = 0;
+            std::vector<Mesh> meshes;
+        };
+
+        static std::vector<std::thread> workers;
+        static std::mutex jobsMutex;
+        static std::condition_variable jobQueued;
+        static std::condition_variable jobParsed;
+        static std::deque<std::shared_ptr<Job>> queued; // Waiting for a worker
+        static std::vector<std::shared_ptr<Job>> parsing; // On a worker
+        static std::deque<std::shared_ptr<Job>> parsed; // Waiting for the main thread, in completion order
+        static bool stopping;
+
+        static void workerLoop();
+        /// <summary>
+        /// One GL step of the job, returns true when the asset is complete
+        /// </summary>
+        static bool uploadStep(Job& job);
+
+    public:
+        /// <summary>
+        /// 0 threads uses every core but the one running the game, at least one
+        /// </summary>
+        static void start(unsigned int threadCount = 0);
+        /// <summary>
+        /// Joins the workers, jobs not parsed yet are dropped and their assets stay Loading
+        /// </summary>
+        static void stop();
+
+        static void enqueue(const std::shared_ptr<ModelAsset>& asset, const std::string& path, bool gamma);
+        /// <summary>
+        /// GL uploads for at most budgetMs, at least one step when something is waiting. Main thread only,
+        /// returns the steps done.
+        /// </summary>
+        static size_t pumpUploads(float budgetMs);
+        /// <summary>
+        /// Uploads all of the asset now, for a synchronous load of an asset already queued. Parses it on the
+        /// calling thread if no worker has picked it up yet, waits for the worker otherwise.
+        /// </summary>
+        static void finish(const ModelAsset* asset);
+
+        /// <summary>
+        /// Assets queued, parsing or waiting for upload
+        /// </summary>
+        static size_t getPendingCount();
+    };
+}
@@ -1,29 +1,104 @@
 #include "Mesh.h"
 
 #include "Model.h"
+#include "Rendering/GLStateCache.h"
+#include "Rendering/RenderStats.h"
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, std::vector<Texture> textures): textures(),
-    VAO()
+    VAO(), VBO(), EBO()
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->textures = std::move(textures);
 
     setupMesh();
 }
 
+Mesh::Mesh(Mesh&& other) noexcept : vertices(std::move(other.vertices)), indices(std::move(other.indices)),
+                                    textures(std::move(other.textures)), VAO(other.VAO), VBO(other.VBO),
+                                    EBO(other.EBO), geometry(other.geometry), minAABB(other.minAABB),
+                                    maxAABB(other.maxAABB), nodeIndex(other.nodeIndex)
+{
+    other.VAO = 0;
+    other.VBO = 0;
+    other.EBO = 0;
+    other.geometry = gllib::GeometryAllocation();
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    releaseGeometry();
+    vertices = std::move(other.vertices);
+    indices = std::move(other.indices);
+    textures = std::move(other.textures);
+    VAO = other.VAO;
+    VBO = other.VBO;
+    EBO = other.EBO;
+    geometry = other.geometry;
+    minAABB = other.minAABB;
+    maxAABB = other.maxAABB;
+    nodeIndex = other.nodeIndex;
+
+    other.VAO = 0;
+    other.VBO = 0;
+    other.EBO = 0;
+    other.geometry = gllib::GeometryAllocation();
+    return *this;
+}
+
+Mesh::~Mesh()
+{
+    releaseGeometry();
+}
+
+void Mesh::releaseGeometry()
+{
+    if (geometry.inArena)
+    {
+        gllib::GeometryArena::free(geometry);
+    }
+    else if (VAO != 0)
+    {
+        gllib::GLStateCache::forgetBuffer(VBO);
+        gllib::GLStateCache::forgetBuffer(EBO);
+        gllib::GLStateCache::forgetVertexArray(VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteVertexArrays(1, &VAO);
+    }
+
+    VAO = 0;
+    VBO = 0;
+    EBO = 0;
+    geometry = gllib::GeometryAllocation();
+}
+
 void Mesh::setupMesh()
 {
+    // Static meshes share the arena buffers and VAO, so drawing them doesn't switch vertex arrays
+    geometry = gllib::GeometryArena::allocate(gllib::VertexFormat_Mesh, vertices.data(), vertices.size(),
+                                              indices.data(), indices.size());
+    if (geometry.inArena)
+    {
+        VAO = geometry.VAO;
+        return;
+    }
+
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    gllib::GLStateCache::bindVertexArray(VAO);
+    gllib::GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
   
+    gllib::RenderStats::countBufferAllocation();
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    gllib::GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    gllib::RenderStats::countBufferAllocation();
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
     
     // vertex Positions
@@ -41,6 +116,7 @@ void Mesh::setupMesh()
     // vertex bitangent
     glEnableVertexAttribArray(4);
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-    
-    glBindVertexArray(0);
+
+    geometry.VAO = VAO;
+    geometry.indexCount = indices.size();
 }
@@ -4,6 +4,7 @@
 
 #include "Shader.h"
 #include "Math/transform.h"
+#include "Rendering/GeometryArena.h"
 
 struct DLLExport Vertex
 {
@@ -14,11 +15,21 @@ struct DLLExport Vertex
     glm::vec3 Bitangent;
 };
 
+enum TextureType
+{
+    TextureType_Diffuse,
+    TextureType_Specular,
+    TextureType_Normal,
+    TextureType_Height,
+    TextureType_Count
+};
+
 struct DLLExport Texture
 {
     unsigned int id;
     std::string type;
     std::string path;
+    TextureType kind = TextureType_Diffuse; // Same as type, resolved at import so draws don't compare strings
 };
 
 class DLLExport Mesh
@@ -28,14 +39,25 @@ public:
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
     unsigned int VAO;
-    unsigned int VBO, EBO;
+    unsigned int VBO, EBO; // 0 when the mesh lives in the geometry arena
+    gllib::GeometryAllocation geometry;
     glm::vec3 minAABB;
     glm::vec3 maxAABB;
-    gllib::Transform* associatedTransform = nullptr;
+    int nodeIndex = -1; // Imported node the mesh hangs from, 0 is the model root, see Model::getNodeTransform
     
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    // Owns its arena span or its buffers, so it moves but never copies
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
+    /// <summary>
+    /// Returns the arena span or deletes the mesh's own buffers. The textures belong to the model asset.
+    /// </summary>
+    ~Mesh();
     
 private:
 
     void setupMesh();
+    void releaseGeometry();
 };
@@ -3,8 +3,12 @@
 #include <iostream>
 
 #include "Camera.h"
+#include "Core/Profiler.h"
+#include "DebugDraw.h"
 #include "Frustum.h"
+#include "FrustumCulling.h"
 #include "Renderer.h"
+#include "RenderStats.h"
 #include <unordered_map>
 
 #include "BSP/BSPNode.h"
@@ -13,70 +17,77 @@ namespace gllib
 {
     std::unordered_map<Transform*, Model*> Model::transformToModelMap;
 
-    Model::Model(std::string const& path, bool gamma)
+    Model::Model(std::string const& path, bool gamma, bool async) :
+        asset(async ? ModelAsset::loadAsync(path, gamma) : ModelAsset::load(path, gamma)), meshes(asset->meshes)
     {
         isPlaneModel_ = isPlaneModel(path);
 
-        // Initialize transform first
-        transform.position = glm::vec3(0.0f);
-        transform.scale = glm::vec3(1.0f);
-        transform.rotationQuat = {1.0f, 0.0f, 0.0f, 0.0f};
+        // Placeholder root until the asset is ready, the game can already place it
+        transform.setPosition(glm::vec3(0.0f));
+        transform.setScale(glm::vec3(1.0f));
+        transform.setRotation(Quaternion{1.0f, 0.0f, 0.0f, 0.0f});
+        if (asset->isLoaded())
+            instantiateNodes(false);
 
-        ModelLoader::loadModel(path, meshes, gamma, &transform);
-
-        // Initialize with invalid AABB first
-        transform.localAABBMin = glm::vec3(FLT_MAX);
-        transform.localAABBMax = glm::vec3(-FLT_MAX);
+        registerModel(&transform, this);
+        hierarchy.build(&transform);
 
-        bool hasValidGeometry = false;
+        if (nodesInstantiated)
+            std::cout << "Model loaded with " << transform.children.size() << " child transforms" << std::endl;
+        else
+            std::cout << "Model " << path << " loading in the background" << std::endl;
+    }
 
-        for (const Mesh& mesh : meshes)
+    void Model::instantiateNodes(bool keepRootPlacement)
+    {
+        nodesInstantiated = true;
+        nodeVersion++;
+        const glm::vec3 placedPosition = transform.getPosition();
+        const glm::vec3 placedScale = transform.getScale();
+        const Quaternion placedQuat = transform.getRotation();
+        const glm::quat placedRotation(placedQuat.w, placedQuat.x, placedQuat.y, placedQuat.z);
+
+        // Sized once, the children point into it
+        const std::vector<ImportedNode>& nodes = asset->nodes;
+        nodePool.clear();
+        nodePool.resize(nodes.size() > 0 ? nodes.size() - 1 : 0);
+
+        for (size_t i = 0; i < nodes.size(); i++)
         {
-            // Check if mesh has valid vertices (no zero AABB)
-            if (mesh.minAABB != mesh.maxAABB)
-            {
-                if (!hasValidGeometry)
-                {
-                    transform.localAABBMin = mesh.minAABB;
-                    transform.localAABBMax = mesh.maxAABB;
-                    hasValidGeometry = true;
-                }
-                else
-                {
-                    transform.localAABBMin = glm::min(transform.localAABBMin, mesh.minAABB);
-                    transform.localAABBMax = glm::max(transform.localAABBMax, mesh.maxAABB);
-                }
-            }
+            const ImportedNode& node = nodes[i];
+            Transform* t = getNodeTransform(static_cast<int>(i));
+            t->setPosition(node.position);
+            t->setScale(node.scale);
+            t->setRotation(node.rotation);
+            t->setLocalAABB(node.localAABBMin, node.localAABBMax);
+
+            if (node.parentIndex >= 0)
+                getNodeTransform(node.parentIndex)->addChild(t);
         }
 
-        // If no valid geometry, set a small default AABB
-        if (!hasValidGeometry)
+        if (keepRootPlacement)
         {
-            transform.localAABBMin = glm::vec3(-0.5f);
-            transform.localAABBMax = glm::vec3(0.5f);
+            // Placed while loading: the imported root goes under where the game put the model
+            const Quaternion importedQuat = transform.getRotation();
+            const glm::quat importedRotation(importedQuat.w, importedQuat.x, importedQuat.y, importedQuat.z);
+            const glm::quat rotation = placedRotation * importedRotation;
+            transform.setPosition(placedPosition + placedRotation * (placedScale * transform.getPosition()));
+            transform.setScale(placedScale * transform.getScale());
+            transform.setRotation(Quaternion{rotation.w, rotation.x, rotation.y, rotation.z});
         }
-
-        registerModel(&transform, this);
-
-        std::cout << "Model loaded with " << transform.children.size() << " child transforms" << std::endl;
     }
 
     Model::~Model()
     {
         unregisterModel(&transform);
 
-        if (aabbInitialized)
-        {
-            glDeleteBuffers(1, &aabbVBO);
-            glDeleteVertexArrays(1, &aabbVAO);
-        }
-
+        // Imported nodes belong to the pool, only transforms attached later were allocated one by one
         std::function<void(Transform*)> cleanupChildren = [&](Transform* t)
         {
             for (Transform* child : t->children)
             {
                 cleanupChildren(child);
-                delete child;
+                if (getNodeIndex(child) < 0) delete child;
             }
             t->children.clear();
         };
@@ -99,7 +110,7 @@ namespace gllib
     void Model::drawWithFrustum(const Frustum& frustum)
     {
         // Update transforms and calculate AABBs
-        transform.updateTRSAndAABB();
+        updateHierarchy();
 
         // Detailed frustum culling and hierarchical rendering
         drawHierarchical(frustum);
@@ -107,56 +118,91 @@ namespace gllib
 
     void Model::drawHierarchical(const Frustum& frustum)
     {
-        // Check if this transform's AABB is in frustum
+        GLLIB_PROFILE_SCOPE("Model::drawHierarchical");
+        // Check if this transform's AABB is in frustum, planes it is fully inside of are not tested again below it
         glm::vec3 aabbMin = transform.getWorldAABBMin();
         glm::vec3 aabbMax = transform.getWorldAABBMax();
-        if (!frustum.isAABBInside(aabbMin, aabbMax))
+        unsigned int planeMask = Frustum::AllPlanesMask;
+        if (frustum.classifyAABB(aabbMin, aabbMax, planeMask) == Frustum::Containment::Outside)
         {
             return;
         }
 
         // Draw meshes associated with this transform
-        for (Mesh& mesh : meshes)
+        const MeshRange range = getMeshRange(&transform);
+        for (unsigned int i = range.first; i < range.first + range.count; i++)
         {
-            if (mesh.associatedTransform == &transform)
-            {
-                Renderer::drawModel3D(mesh.VAO, mesh.indices.size(),transform.getTransformMatrix(), mesh.textures);
-            }
+            Renderer::drawGeometry3D(meshes[i].geometry, transform.getTransformMatrix(), meshes[i].textures);
         }
 
         // Recursively draw children
         for (Transform* child : transform.children)
         {
-            drawChildTransform(child, frustum);
+            drawChildTransform(child, frustum, planeMask);
         }
     }
 
-    void Model::drawChildTransform(Transform* childTransform, const Frustum& frustum)
+    void Model::drawChildTransform(Transform* childTransform, const Frustum& frustum, unsigned int planeMask)
     {
-        // Check if this child transform's AABB is in frustum
-        glm::vec3 aabbMin = childTransform->getWorldAABBMin();
-        glm::vec3 aabbMax = childTransform->getWorldAABBMax();
-        if (!frustum.isAABBInside(aabbMin, aabbMax))
+        // The hierarchical AABB holds every child, so a subtree fully inside the parent's planes skips the test
+        if (planeMask != 0)
         {
-            return;
+            glm::vec3 aabbMin = childTransform->getWorldAABBMin();
+            glm::vec3 aabbMax = childTransform->getWorldAABBMax();
+            if (frustum.classifyAABB(aabbMin, aabbMax, planeMask) == Frustum::Containment::Outside)
+            {
+                return;
+            }
         }
 
         // Draw meshes associated with this child transform
-        for (Mesh& mesh : meshes)
+        const MeshRange range = getMeshRange(childTransform);
+        for (unsigned int i = range.first; i < range.first + range.count; i++)
         {
-            if (mesh.associatedTransform == childTransform)
-            {
-                Renderer::drawModel3D(mesh.VAO, mesh.indices.size(),
-                                      childTransform->getTransformMatrix(), mesh.textures, material);
-            }
+            Renderer::drawGeometry3D(meshes[i].geometry, childTransform->getTransformMatrix(), meshes[i].textures,
+                                     material);
         }
 
         for (Transform* grandchild : childTransform->children)
         {
-            drawChildTransform(grandchild, frustum);
+            drawChildTransform(grandchild, frustum, planeMask);
         }
     }
 
+    void Model::updateHierarchy()
+    {
+        if (!nodesInstantiated && asset->isLoaded())
+            instantiateNodes(true);
+        hierarchy.update();
+    }
+
+    Transform* Model::getNodeTransform(int nodeIndex)
+    {
+        if (nodeIndex == 0)
+            return &transform;
+        if (nodeIndex < 0 || static_cast<size_t>(nodeIndex) > nodePool.size())
+            return nullptr;
+        return &nodePool[nodeIndex - 1];
+    }
+
+    int Model::getNodeIndex(const Transform* node) const
+    {
+        if (node == &transform)
+            return 0;
+        // The pool never moves after loading, so a pointer into it gives the index directly
+        if (nodePool.empty() || node < nodePool.data() || node >= nodePool.data() + nodePool.size())
+            return -1;
+        return static_cast<int>(node - nodePool.data()) + 1;
+    }
+
+    MeshRange Model::getMeshRange(const Transform* node) const
+    {
+        const int nodeIndex = getNodeIndex(node);
+        if (nodeIndex < 0 || static_cast<size_t>(nodeIndex) >= asset->nodeMeshRanges.size())
+            return MeshRange();
+        return asset->nodeMeshRanges[nodeIndex];
+    }
+
     void Model::setMaterialForTransform(Transform* transform, Material* material)
     {
         transformMaterials[transform] = material;
@@ -194,139 +240,86 @@ namespace gllib
 
     void Model::drawFrustumAndBSP(const Frustum& frustum, const BSPPlane* bspPlane, const glm::vec3& cameraPos)
     {
-        if (!bspPlane)
+        // Without a plane nothing is BSP culled, models in BSP leaves still share the batched mesh culling.
+        // Gather the meshes the wall doesn't hide, then frustum test all of them in one batch.
+        meshCandidates.clear();
+        meshBoxes.clear();
+        collectNodeWithBSP(&transform, frustum, Frustum::AllPlanesMask, bspPlane, cameraPos);
+        FrustumCulling::cullAABBs(frustum, meshBoxes, meshVisibility);
+
+        for (const MeshCandidate& candidate : meshCandidates)
         {
-            drawHierarchical(frustum);
-            return;
-        }
+            RenderStats::countMeshTested();
+            if (candidate.boxIndex >= 0 && !FrustumCulling::isVisible(meshVisibility, candidate.boxIndex))
+            {
+                RenderStats::countMeshFrustumCulled();
+                continue;
+            }
 
-        const bool cameraInFront = bspPlane->isPointInFront(cameraPos);
-        
-        drawNodeWithBSP(&transform, frustum, bspPlane, cameraInFront);
+            Renderer::drawGeometry3D(candidate.mesh->geometry, candidate.world, candidate.mesh->textures,
+                                     candidate.material);
+        }
     }
 
-    void Model::drawNodeWithBSP(Transform* t, const Frustum& frustum, const BSPPlane* bspPlane, bool cameraInFront)
+    void Model::collectNodeWithBSP(Transform* t, const Frustum& frustum, unsigned int planeMask,
+                                   const BSPPlane* bspPlane, const glm::vec3& cameraPos)
     {
-        if (!subtreeHasAnyOnCameraSide(t, bspPlane, cameraInFront))
+        // Same plane mask walk as drawChildTransform, meshes under a fully inside node skip the batched test
+        if (planeMask != 0 &&
+            frustum.classifyAABB(t->getWorldAABBMin(), t->getWorldAABBMax(), planeMask) == Frustum::Containment::Outside)
+        {
+            RenderStats::countNodeFrustumCulled();
             return;
+        }
 
-        Material* transformMaterial = getMaterialForTransform(t);
-        for (Mesh& mesh : meshes)
+        // World bounds hold the whole subtree
+        if (bspPlane && BSPNode::isHiddenByWall(*bspPlane, cameraPos, t->getWorldAABBMin(), t->getWorldAABBMax()))
         {
-            if (mesh.associatedTransform != t) continue;
+            RenderStats::countNodeBSPCulled();
+            return;
+        }
 
-            const glm::mat4 worldM = t->getTransformMatrix();
-            
-            const glm::vec3 min = mesh.minAABB, max = mesh.maxAABB;
-            
-            const glm::vec3 corners[8] = {
-                {min.x, min.y, min.z}, {max.x, min.y, min.z},
-                {min.x, max.y, min.z}, {max.x, max.y, min.z},
-                {min.x, min.y, max.z}, {max.x, min.y, max.z},
-                {min.x, max.y, max.z}, {max.x, max.y, max.z}
-            };
-
-            glm::vec3 wMin(std::numeric_limits<float>::max());
-            glm::vec3 wMax(-std::numeric_limits<float>::max());
-            
-            for (int i = 0; i < 8; ++i)
+        Material* transformMaterial = getMaterialForTransform(t);
+        const MeshRange range = getMeshRange(t);
+        const glm::mat4 worldM = t->getTransformMatrix();
+        for (unsigned int i = range.first; i < range.first + range.count; i++)
+        {
+            Mesh& mesh = meshes[i];
+            if (planeMask == 0)
             {
-                const glm::vec3 wc = glm::vec3(worldM * glm::vec4(corners[i], 1.0f));
-                wMin = glm::min(wMin, wc);
-                wMax = glm::max(wMax, wc);
+                meshCandidates.push_back({&mesh, worldM, transformMaterial, -1});
+                continue;
             }
+            
+            glm::vec3 wMin, wMax;
+            Transform::transformAABB(worldM, mesh.minAABB, mesh.maxAABB, wMin, wMax);
 
-            if (!frustum.isAABBInside(wMin, wMax)) continue;
-
-            Renderer::drawModel3D(mesh.VAO, mesh.indices.size(), worldM, mesh.textures, transformMaterial);
+            meshCandidates.push_back({&mesh, worldM, transformMaterial, static_cast<int>(meshBoxes.size())});
+            meshBoxes.addMinMax(wMin, wMax);
         }
 
         for (Transform* c : t->children)
         {
-            drawNodeWithBSP(c, frustum, bspPlane, cameraInFront);
+            collectNodeWithBSP(c, frustum, planeMask, bspPlane, cameraPos);
         }
     }
 
-    void Model::initializeAABBVisualization()
+    void Model::drawAABBDebug()
     {
-        if (aabbInitialized)
-            return;
-
-        glGenVertexArrays(1, &aabbVAO);
-        glGenBuffers(1, &aabbVBO);
-        aabbInitialized = true;
+        DebugDraw::addBox(transform.getWorldAABBMin(), transform.getWorldAABBMax(), glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
     }
 
-    void Model::drawAABBDebug(const glm::mat4& view, const glm::mat4& projection)
+    void Model::drawAllAABBsDebug()
     {
-        if (!aabbInitialized)
-            initializeAABBVisualization();
-
-        glm::vec3 min = transform.getWorldAABBMin();
-        glm::vec3 max = transform.getWorldAABBMax();
-
-        std::vector<float> vertices = {
-            // Bottom face edges
-            min.x, min.y, min.z, max.x, min.y, min.z,
-            max.x, min.y, min.z, max.x, min.y, max.z,
-            max.x, min.y, max.z, min.x, min.y, max.z,
-            min.x, min.y, max.z, min.x, min.y, min.z,
-
-            // Top face edges
-            min.x, max.y, min.z, max.x, max.y, min.z,
-            max.x, max.y, min.z, max.x, max.y, max.z,
-            max.x, max.y, max.z, min.x, max.y, max.z,
-            min.x, max.y, max.z, min.x, max.y, min.z,
-
-            // Vertical edges
-            min.x, min.y, min.z, min.x, max.y, min.z,
-            max.x, min.y, min.z, max.x, max.y, min.z,
-            max.x, min.y, max.z, max.x, max.y, max.z,
-            min.x, min.y, max.z, min.x, max.y, max.z
-        };
-
-        glBindVertexArray(aabbVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, aabbVBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        GLint currentProgram;
-        glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-
-        glm::mat4 mvp = projection * view;
-        GLint mvpLoc = glGetUniformLocation(currentProgram, "u_MVP");
-        if (mvpLoc != -1)
-        {
-            glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(mvp));
-        }
-
-        GLint colorLoc = glGetUniformLocation(currentProgram, "u_Color");
-        if (colorLoc != -1)
-        {
-            glm::vec4 color(0.0f, 1.0f, 0.0f, 1.0f); // Green color
-            glUniform4fv(colorLoc, 1, glm::value_ptr(color));
-        }
-
-        glDrawArrays(GL_LINES, 0, 24);
-        glBindVertexArray(0);
-    }
-
-    void Model::drawAllAABBsDebug(const glm::mat4& view, const glm::mat4& projection)
-    {
-        if (!aabbInitialized)
-            initializeAABBVisualization();
-
         // Draw root transform AABB
-        drawTransformAABB(&transform, view, projection);
+        drawTransformAABB(&transform);
 
         // Recursively draw all children AABBs
         std::function<void(Transform*)> drawChildrenAABBs = [&](Transform* t)
         {
             for (Transform* child : t->children)
             {
-                drawTransformAABB(child, view, projection);
+                drawTransformAABB(child);
                 drawChildrenAABBs(child);
             }
         };
@@ -334,7 +327,7 @@ namespace gllib
         drawChildrenAABBs(&transform);
     }
 
-    void Model::drawTransformAABB(Transform* t, const glm::mat4& view, const glm::mat4& projection)
+    void Model::drawTransformAABB(Transform* t)
     {
         glm::vec3 min = t->getWorldAABBMin();
         glm::vec3 max = t->getWorldAABBMax();
@@ -343,92 +336,10 @@ namespace gllib
         if (min.x > max.x || min.y > max.y || min.z > max.z)
             return;
 
-        std::vector<float> vertices = {
-            // Bottom face edges
-            min.x, min.y, min.z, max.x, min.y, min.z,
-            max.x, min.y, min.z, max.x, min.y, max.z,
-            max.x, min.y, max.z, min.x, min.y, max.z,
-            min.x, min.y, max.z, min.x, min.y, min.z,
-
-            // Top face edges
-            min.x, max.y, min.z, max.x, max.y, min.z,
-            max.x, max.y, min.z, max.x, max.y, max.z,
-            max.x, max.y, max.z, min.x, max.y, max.z,
-            min.x, max.y, max.z, min.x, max.y, min.z,
-
-            // Vertical edges
-            min.x, min.y, min.z, min.x, max.y, min.z,
-            max.x, min.y, min.z, max.x, max.y, min.z,
-            max.x, min.y, max.z, max.x, max.y, max.z,
-            min.x, min.y, max.z, min.x, max.y, max.z
-        };
-
-        glBindVertexArray(aabbVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, aabbVBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        GLint currentProgram;
-        glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-
-        glm::mat4 mvp = projection * view;
-        GLint mvpLoc = glGetUniformLocation(currentProgram, "u_MVP");
-        if (mvpLoc != -1)
-        {
-            glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(mvp));
-        }
-
-        GLint colorLoc = glGetUniformLocation(currentProgram, "u_Color");
-        if (colorLoc != -1)
-        {
-            // Use cyan color for individual mesh AABBs
-            glm::vec4 color(0.0f, 1.0f, 1.0f, 1.0f);
-            glUniform4fv(colorLoc, 1, glm::value_ptr(color));
-        }
-
-        glDrawArrays(GL_LINES, 0, 24);
-        glBindVertexArray(0);
+        // Use cyan color for individual mesh AABBs
+        DebugDraw::addBox(min, max, glm::vec4(0.0f, 1.0f, 1.0f, 1.0f));
     }
     
-    bool aabbCompletelyOnOppositeSide(const glm::vec3& wMin, const glm::vec3& wMax,const BSPPlane* plane, bool cameraInFront)
-    {
-        if (!plane) return false;
-
-        const glm::vec3 corners[8] = {
-            {wMin.x, wMin.y, wMin.z}, {wMax.x, wMin.y, wMin.z},
-            {wMin.x, wMax.y, wMin.z}, {wMax.x, wMax.y, wMin.z},
-            {wMin.x, wMin.y, wMax.z}, {wMax.x, wMin.y, wMax.z},
-            {wMin.x, wMax.y, wMax.z}, {wMax.x, wMax.y, wMax.z}
-        };
-
-        for (int i = 0; i < 8; ++i)
-        {
-            if (plane->isPointInFront(corners[i]) == cameraInFront)
-                return false;
-        }
-        return true;
-    }
-
-    bool Model::subtreeHasAnyOnCameraSide(const Transform* t, const BSPPlane* plane, bool cameraInFront)
-    {
-        if (!plane) return true;
-
-        const glm::vec3 ownMin = t->getWorldAABBMin();
-        const glm::vec3 ownMax = t->getWorldAABBMax();
-
-        if (!aabbCompletelyOnOppositeSide(ownMin, ownMax, plane, cameraInFront))
-            return true;
-
-        for (const Transform* c : t->children)
-        {
-            if (subtreeHasAnyOnCameraSide(c, plane, cameraInFront))
-                return true;
-        }
-        return false;
-    }
-
     bool Model::isPlaneModel(const std::string& path)
     {
         // Check if path contains "/planes/" or "\planes\"
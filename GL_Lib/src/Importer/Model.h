@@ -3,9 +3,12 @@
 
 #include "Rendering/Camera/Camera.h"
 #include "Rendering/Frustum.h"
+#include "Rendering/FrustumCulling.h"
 #include "Mesh.h"
+#include "ModelAsset.h"
 #include "ModelLoader.h"
 #include "Entities/Entity3D.h"
+#include "Math/TransformHierarchy.h"
 
 namespace gllib
 {
@@ -14,36 +17,87 @@ namespace gllib
     class DLLExport Model : public Entity3D
     {
     private:
+        // Meshes, GPU buffers and imported tree shared with every Model of the same file
+        std::shared_ptr<ModelAsset> asset;
+        bool nodesInstantiated = false;
+        unsigned int nodeVersion = 0; // Bumped when the nodes are built, so users of them can tell
+
+        void instantiateNodes(bool keepRootPlacement);
         void drawHierarchical(const Frustum& frustum);
-        void drawChildTransform(Transform* childTransform, const Frustum& frustum);
-        void drawTransformAABB(Transform* t, const glm::mat4& view, const glm::mat4& projection);
-        bool subtreeHasAnyOnCameraSide(const Transform* t, const BSPPlane* plane, bool cameraInFront);
-        void drawNodeWithBSP(Transform* t, const Frustum& frustum, const BSPPlane* bspPlane, bool cameraInFront);
+        void drawChildTransform(Transform* childTransform, const Frustum& frustum, unsigned int planeMask);
+        void drawTransformAABB(Transform* t);
+        void collectNodeWithBSP(Transform* t, const Frustum& frustum, unsigned int planeMask, const BSPPlane* bspPlane,
+                                const glm::vec3& cameraPos);
+
+        struct MeshCandidate
+        {
+            Mesh* mesh;
+            glm::mat4 world;
+            Material* material;
+            int boxIndex; // Index in meshBoxes, -1 when the node is fully inside the frustum and needs no test
+        };
+        // Meshes kept by the BSP plane this draw, with their world bounds for the batched frustum test
+        std::vector<MeshCandidate> meshCandidates;
+        CullingBoxes meshBoxes;
+        std::vector<uint64_t> meshVisibility;
         
         std::vector<Transform*> allTransforms;
+        // This copy's child nodes, parents first, and the flattened view of the whole tree used to update it
+        std::vector<Transform> nodePool;
+        TransformHierarchy hierarchy;
         static std::unordered_map<Transform*, Model*> transformToModelMap;
 
         bool isPlaneModel_ = false;
-        unsigned int aabbVAO = 0;
-        unsigned int aabbVBO = 0;
-        bool aabbInitialized = false;
-        void initializeAABBVisualization();
 
         std::unordered_map<Transform*, Material*> transformMaterials;
         
     public:
         void setMaterialForTransform(Transform* transform, Material* material);
         Material* getMaterialForTransform(Transform* transform);
-        std::vector<Mesh> meshes;
-        Model(std::string const& path, bool gamma);
+        std::vector<Mesh>& meshes; // The asset's, shared by every Model of the file
+        /// <summary>
+        /// Imports the file only the first time, later Models of the same path reuse its ModelAsset and only
+        /// build their own transforms and materials. An async Model returns before the file is read and draws
+        /// nothing until its asset is uploaded, see AsyncModelLoader.
+        /// </summary>
+        Model(std::string const& path, bool gamma, bool async = false);
         ~Model();
         
+        /// <summary>
+        /// World matrices and bounds of every node in two linear passes, call it instead of
+        /// transform.updateTRSAndAABB(). Builds the nodes of an async Model once its asset is ready.
+        /// </summary>
+        void updateHierarchy();
+        const TransformHierarchy& getHierarchy() const { return hierarchy; }
+        const ModelAsset& getAsset() const { return *asset; }
+        /// <summary>
+        /// False while an async Model's asset is loading
+        /// </summary>
+        bool isReady() const { return nodesInstantiated; }
+        unsigned int getNodeVersion() const { return nodeVersion; }
+
+        /// <summary>
+        /// Transform of an imported node, nullptr for -1 or an index out of range
+        /// </summary>
+        Transform* getNodeTransform(int nodeIndex);
+        /// <summary>
+        /// Imported node index of a transform of this model, -1 for transforms attached after loading
+        /// </summary>
+        int getNodeIndex(const Transform* node) const;
+        /// <summary>
+        /// Meshes drawn with the transform, an empty range when it has none
+        /// </summary>
+        MeshRange getMeshRange(const Transform* node) const;
+
         static bool isPlaneModel(const std::string& path);
         bool isFromPlanesFolder() const { return isPlaneModel_; }
         void draw(const Camera& camera);
         void draw() override;
-        void drawAABBDebug(const glm::mat4& view, const glm::mat4& projection);
-        void drawAllAABBsDebug(const glm::mat4& view, const glm::mat4& projection);
+        /// <summary>
+        /// Queue the bounds in DebugDraw, they are drawn with every other debug line at the end of the frame
+        /// </summary>
+        void drawAABBDebug();
+        void drawAllAABBsDebug();
         void drawWithFrustum(const Frustum& frustum);
         void drawFrustumAndBSP(const Frustum& frustum, const BSPPlane* bspPlane, const glm::vec3& cameraPos);
         static void registerModel(Transform* transform, Model* model);
@@ -0,0 +1,164 @@
+#include "ModelAsset.h"
+
+#include <cfloat>
+#include <filesystem>
+#include <iostream>
+
+#include <stb_image.h>
+
+#include "AsyncModelLoader.h"
+#include "Core/Profiler.h"
+
+using namespace gllib;
+using namespace std;
+
+unordered_map<string, shared_ptr<ModelAsset>> ModelAsset::assets;
+
+shared_ptr<ModelAsset> ModelAsset::find(const string& key)
+{
+    unordered_map<string, shared_ptr<ModelAsset>>::iterator it = assets.find(key);
+    return it != assets.end() ? it->second : nullptr;
+}
+
+shared_ptr<ModelAsset> ModelAsset::load(const string& path, bool gamma)
+{
+    GLLIB_PROFILE_SCOPE("ModelAsset::load");
+    // Gamma corrected textures are different data, they get their own asset
+    const string key = canonicalPath(path) + (gamma ? "|gamma" : "");
+    shared_ptr<ModelAsset> asset = find(key);
+    if (asset)
+    {
+        if (!asset->isLoaded())
+            AsyncModelLoader::finish(asset.get());
+        return asset;
+    }
+
+    asset = make_shared<ModelAsset>();
+    asset->path = path;
+    assets[key] = asset;
+
+    ImportedModel model;
+    if (!ModelLoader::importScene(path, model))
+    {
+        asset->completeImport(nullptr, {});
+        return asset;
+    }
+
+    stbi_set_flip_vertically_on_load(gamma);
+    ModelLoader::decodeImages(model);
+    for (size_t i = 0; i < model.images.size(); i++)
+        ModelLoader::uploadImage(model, i);
+
+    vector<Mesh> uploadedMeshes;
+    uploadedMeshes.reserve(model.meshes.size());
+    for (size_t i = 0; i < model.meshes.size(); i++)
+        uploadedMeshes.push_back(ModelLoader::uploadMesh(model, i));
+
+    asset->completeImport(&model, std::move(uploadedMeshes));
+    return asset;
+}
+
+shared_ptr<ModelAsset> ModelAsset::loadAsync(const string& path, bool gamma)
+{
+    const string key = canonicalPath(path) + (gamma ? "|gamma" : "");
+    shared_ptr<ModelAsset> asset = find(key);
+    if (asset)
+        return asset;
+
+    asset = make_shared<ModelAsset>();
+    asset->path = path;
+    assets[key] = asset;
+    AsyncModelLoader::enqueue(asset, path, gamma);
+    return asset;
+}
+
+size_t ModelAsset::releaseUnused()
+{
+    size_t released = 0;
+    for (unordered_map<string, shared_ptr<ModelAsset>>::iterator it = assets.begin(); it != assets.end();)
+    {
+        // Assets still loading are also held by the loader
+        if (it->second.use_count() == 1)
+        {
+            it = assets.erase(it);
+            released++;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return released;
+}
+
+void ModelAsset::destroyAll()
+{
+    for (const pair<const string, shared_ptr<ModelAsset>>& asset : assets)
+        asset.second->releaseGPU();
+    assets.clear();
+}
+
+ModelAsset::~ModelAsset()
+{
+    releaseGPU();
+}
+
+void ModelAsset::releaseGPU()
+{
+    // Mesh destructors hand back the arena spans
+    meshes.clear();
+    for (MeshRange& range : nodeMeshRanges)
+        range = MeshRange();
+
+    for (unsigned int id : textureIds)
+        ModelLoader::releaseTexture(id);
+    textureIds.clear();
+}
+
+string ModelAsset::canonicalPath(const string& path)
+{
+    error_code error;
+    const filesystem::path canonical = filesystem::weakly_canonical(filesystem::path(path), error);
+    return error ? filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+}
+
+void ModelAsset::completeImport(ImportedModel* model, vector<Mesh>&& uploadedMeshes)
+{
+    meshes = std::move(uploadedMeshes);
+    if (model)
+    {
+        nodes = std::move(model->nodes);
+        nodeMeshRanges = std::move(model->nodeMeshRanges);
+        textureIds = std::move(model->textureIds);
+    }
+
+    // A file that imported nothing still gets a root, so its Models behave like empty ones
+    if (nodes.empty())
+    {
+        nodes.push_back({glm::vec3(0.0f), glm::vec3(1.0f), {1.0f, 0.0f, 0.0f, 0.0f}, glm::vec3(0.0f), glm::vec3(0.0f),
+                         -1});
+        nodeMeshRanges.assign(1, MeshRange());
+    }
+
+    // The root box holds every mesh of the model, invalid until the first mesh with geometry
+    bool hasValidGeometry = false;
+    for (const Mesh& mesh : meshes)
+    {
+        if (mesh.minAABB == mesh.maxAABB)
+            continue;
+        nodes[0].localAABBMin = hasValidGeometry ? glm::min(nodes[0].localAABBMin, mesh.minAABB) : mesh.minAABB;
+        nodes[0].localAABBMax = hasValidGeometry ? glm::max(nodes[0].localAABBMax, mesh.maxAABB) : mesh.maxAABB;
+        hasValidGeometry = true;
+    }
+
+    // If no valid geometry, set a small default AABB
+    if (!hasValidGeometry)
+    {
+        nodes[0].localAABBMin = glm::vec3(-0.5f);
+        nodes[0].localAABBMax = glm::vec3(0.5f);
+    }
+
+    state = model ? State::Ready : State::Failed;
+    cout << "Model asset " << path << " imported with " << meshes.size() << " meshes and " << nodes.size()
+        << " nodes" << endl;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Core/deps.h"
+#include "Mesh.h"
+#include "ModelLoader.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// What every Model of one file shares: the meshes with their GPU buffers, the mesh range of each node and
+    /// the node tree as imported. Loaded once per canonical path, each Model only builds its own transforms
+    /// from it, so spawning copies imports nothing and allocates no VRAM.
+    /// </summary>
+    class DLLExport ModelAsset
+    {
+    public:
+        enum class State
+        {
+            Loading,
+            Ready,
+            Failed // Ready with no meshes and a default root, like a file that imported nothing
+        };
+
+    private:
+        static std::unordered_map<std::string, std::shared_ptr<ModelAsset>> assets;
+
+        std::string path;
+        State state = State::Loading;
+        std::vector<unsigned int> textureIds; // Held through ModelLoader::releaseTexture
+
+        static std::shared_ptr<ModelAsset> find(const std::string& key);
+        /// <summary>
+        /// Returns the meshes' arena spans and buffers and lets go of the textures, the asset keeps its nodes
+        /// </summary>
+        void releaseGPU();
+
+    public:
+        std::vector<Mesh> meshes;
+        std::vector<MeshRange> nodeMeshRanges; // Indexed like nodes and Mesh::nodeIndex
+        std::vector<ImportedNode> nodes; // Preorder, nodes[0] is the root
+
+        /// <summary>
+        /// Cached asset of the file, imported on the first request. Different spellings of the same path share it.
+        /// An asset still loading in the background is finished right away.
+        /// </summary>
+        static std::shared_ptr<ModelAsset> load(const std::string& path, bool gamma);
+        /// <summary>
+        /// Returns at once with the asset in State::Loading, the file is read on AsyncModelLoader's threads and
+        /// uploaded by its per-frame pump
+        /// </summary>
+        static std::shared_ptr<ModelAsset> loadAsync(const std::string& path, bool gamma);
+        /// <summary>
+        /// Drops the assets no Model uses anymore along with their GPU data, returns how many were freed
+        /// </summary>
+        static size_t releaseUnused();
+        /// <summary>
+        /// Frees the GPU data of every asset while the context is still alive, Models left over draw nothing
+        /// </summary>
+        static void destroyAll();
+        static size_t getLoadedCount() { return assets.size(); }
+        static std::string canonicalPath(const std::string& path);
+
+        /// <summary>
+        /// Takes the uploaded meshes and the tree of an import, the asset becomes Ready.
+        /// A null model marks it Failed.
+        /// </summary>
+        void completeImport(ImportedModel* model, std::vector<Mesh>&& uploadedMeshes);
+
+        ModelAsset() = default;
+        ModelAsset(const ModelAsset&) = delete;
+        ModelAsset& operator=(const ModelAsset&) = delete;
+        ~ModelAsset();
+
+        const std::string& getPath() const { return path; }
+        State getState() const { return state; }
+        bool isLoaded() const { return state != State::Loading; }
+        bool hasFailed() const { return state == State::Failed; }
+    };
+}
@@ -0,0 +1,189 @@
+#include "ModelInstanceSet.h"
+
+#include <iostream>
+
+#include "Renderer.h"
+#include "Rendering/GLStateCache.h"
+#include "Rendering/RenderStats.h"
+
+namespace gllib
+{
+    ModelInstanceSet::ModelInstanceSet(Model* model) : model(model), partsNodeVersion(0), boundsMin(0.0f),
+                                                       boundsMax(0.0f), instanceBuffer(0), instanceBufferCapacity(0),
+                                                       visibleCount(0)
+    {
+        glGenBuffers(1, &instanceBuffer);
+        refreshMeshes();
+
+        std::cout << "Created instance set with " << parts.size() << " meshes" << std::endl;
+    }
+
+    ModelInstanceSet::~ModelInstanceSet()
+    {
+        GLStateCache::forgetBuffer(instanceBuffer);
+        glDeleteBuffers(1, &instanceBuffer);
+    }
+
+    // Private
+
+    void ModelInstanceSet::uploadVisible()
+    {
+        const size_t size = visible.size() * sizeof(glm::mat4);
+
+        // Grow with some slack so adding a few instances doesn't change the size every frame
+        if (size > instanceBufferCapacity)
+        {
+            instanceBufferCapacity = size + size / 2;
+            RenderStats::countBufferAllocation();
+        }
+
+        // Orphaning the old storage means we never wait for the previous frame draws, it is not counted as an
+        // allocation since the driver recycles the same size
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instanceBufferCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, visible.data());
+    }
+
+    // Public
+
+    void ModelInstanceSet::refreshMeshes()
+    {
+        parts.clear();
+        partsNodeVersion = model->getNodeVersion();
+        boundsMin = glm::vec3(FLT_MAX);
+        boundsMax = glm::vec3(-FLT_MAX);
+
+        // No node matrices before an async model is ready, draw picks the parts up once it is
+        if (model->isReady())
+        {
+            for (Mesh& mesh : model->meshes)
+            {
+                MeshPart part;
+                part.mesh = &mesh;
+                part.modelSpace = glm::mat4(1.0f);
+                part.material = nullptr;
+
+                Transform* node = model->getNodeTransform(mesh.nodeIndex);
+                if (node)
+                {
+                    // Instances replace the model root, keep only what is below it
+                    Transform* root = node;
+                    while (root->parent)
+                        root = root->parent;
+                    part.modelSpace = glm::inverse(root->getTransformMatrix()) * node->getTransformMatrix();
+                    part.material = model->getMaterialForTransform(node);
+                }
+                parts.push_back(part);
+
+                if (mesh.minAABB == mesh.maxAABB)
+                    continue;
+
+                glm::vec3 partMin, partMax;
+                Transform::transformAABB(part.modelSpace, mesh.minAABB, mesh.maxAABB, partMin, partMax);
+                boundsMin = glm::min(boundsMin, partMin);
+                boundsMax = glm::max(boundsMax, partMax);
+            }
+        }
+
+        // Same fallback Model uses when nothing has geometry, or while an async model is loading
+        if (boundsMin.x > boundsMax.x)
+        {
+            boundsMin = glm::vec3(-0.5f);
+            boundsMax = glm::vec3(0.5f);
+        }
+    }
+
+    unsigned int ModelInstanceSet::addInstance(const glm::mat4& world)
+    {
+        instances.push_back(world);
+        return static_cast<unsigned int>(instances.size() - 1);
+    }
+
+    void ModelInstanceSet::setInstance(unsigned int index, const glm::mat4& world)
+    {
+        if (index < instances.size())
+            instances[index] = world;
+    }
+
+    void ModelInstanceSet::removeInstance(unsigned int index)
+    {
+        if (index >= instances.size())
+            return;
+
+        instances[index] = instances.back();
+        instances.pop_back();
+    }
+
+    void ModelInstanceSet::clear()
+    {
+        instances.clear();
+        visible.clear();
+        visibleCount = 0;
+    }
+
+    unsigned int ModelInstanceSet::getInstanceCount() const
+    {
+        return static_cast<unsigned int>(instances.size());
+    }
+
+    unsigned int ModelInstanceSet::getMeshCount() const
+    {
+        return static_cast<unsigned int>(parts.size());
+    }
+
+    unsigned int ModelInstanceSet::getVisibleCount() const
+    {
+        return visibleCount;
+    }
+
+    void ModelInstanceSet::draw(const Frustum& frustum)
+    {
+        // Builds the nodes of an async model whose asset finished uploading, nobody else may draw the model
+        if (!model->isReady())
+            model->updateHierarchy();
+        if (partsNodeVersion != model->getNodeVersion())
+            refreshMeshes();
+
+        const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        const glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+
+        instanceBoxes.clear();
+        instanceBoxes.reserve(instances.size());
+        for (const glm::mat4& world : instances)
+        {
+            // World AABB of the transformed bounds: center moves with the matrix, extents use its absolute value
+            const glm::vec3 worldCenter = glm::vec3(world * glm::vec4(center, 1.0f));
+            const glm::vec3 worldExtents = glm::abs(glm::vec3(world[0])) * extents.x +
+                glm::abs(glm::vec3(world[1])) * extents.y +
+                glm::abs(glm::vec3(world[2])) * extents.z;
+            instanceBoxes.add(worldCenter, worldExtents);
+        }
+        FrustumCulling::cullAABBs(frustum, instanceBoxes, instanceVisibility);
+
+        visible.clear();
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            if (FrustumCulling::isVisible(instanceVisibility, i))
+                visible.push_back(instances[i]);
+        }
+
+        visibleCount = static_cast<unsigned int>(visible.size());
+        if (visibleCount == 0)
+            return;
+
+        uploadVisible();
+
+        for (MeshPart& part : parts)
+        {
+            Renderer::drawGeometry3D(part.mesh->geometry, part.modelSpace, part.mesh->textures, part.material,
+                                     instanceBuffer, visibleCount);
+        }
+    }
+
+    void ModelInstanceSet::draw(const Camera& camera)
+    {
+        Frustum frustum;
+        frustum.extractFromMatrix(camera.getProjectionMatrix() * camera.getViewMatrix());
+        draw(frustum);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+
+#include "Core/deps.h"
+#include "Model.h"
+#include "Rendering/Frustum.h"
+#include "Rendering/FrustumCulling.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// Draws many copies of one Model. The meshes are shared and drawn once each with glDrawElementsInstanced,
+    /// so draw calls grow with the unique meshes of the model instead of with the number of copies.
+    /// </summary>
+    class DLLExport ModelInstanceSet
+    {
+    private:
+        struct MeshPart
+        {
+            Mesh* mesh;
+            glm::mat4 modelSpace; // Node matrix relative to the root of the model
+            Material* material;
+        };
+
+        Model* model;
+        std::vector<MeshPart> parts;
+        unsigned int partsNodeVersion; // Model node version the parts were built from
+        // Bounds of the whole model in its own space, used to cull every instance
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+
+        std::vector<glm::mat4> instances;
+        std::vector<glm::mat4> visible;
+        CullingBoxes instanceBoxes;
+        std::vector<uint64_t> instanceVisibility;
+
+        unsigned int instanceBuffer;
+        size_t instanceBufferCapacity;
+        unsigned int visibleCount;
+
+        void uploadVisible();
+
+    public:
+        explicit ModelInstanceSet(Model* model);
+        ~ModelInstanceSet();
+
+        /// <summary>
+        /// Rebuilds the mesh list and bounds from the model hierarchy, call it after moving nodes of the model.
+        /// Done by draw once an async model is ready.
+        /// </summary>
+        void refreshMeshes();
+
+        unsigned int addInstance(const glm::mat4& world);
+        void setInstance(unsigned int index, const glm::mat4& world);
+        /// <summary>
+        /// Swaps the last instance into the removed slot, so indices past it are not stable
+        /// </summary>
+        void removeInstance(unsigned int index);
+        void clear();
+
+        unsigned int getInstanceCount() const;
+        unsigned int getMeshCount() const;
+        /// <summary>
+        /// Instances that passed the frustum test in the last draw
+        /// </summary>
+        unsigned int getVisibleCount() const;
+
+        /// <summary>
+        /// Culls every instance and draws the visible ones. With the render queue enabled the instance buffer
+        /// is read on flush, so a set should be drawn once per frame.
+        /// </summary>
+        void draw(const Frustum& frustum);
+        void draw(const Camera& camera);
+    };
+}
@@ -2,15 +2,80 @@
 
 #include <stb_image.h>
 #include "Assimp/matrix4x4.h"
+#include "Core/Profiler.h"
+#include "Rendering/GLStateCache.h"
+#include "loader.h"
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/matrix_decompose.hpp>
 namespace gllib
 {
     std::vector<Texture> ModelLoader::textures_loaded;
+    std::unordered_map<unsigned int, unsigned int> ModelLoader::textureUsers;
     std::string ModelLoader::directory = "";
 
-    void ModelLoader::loadModel(std::string const& path, std::vector<Mesh>& meshes, bool gamma, Transform* rootTransform)
+    void ModelLoader::loadModel(std::string const& path, std::vector<Mesh>& meshes, bool gamma, Transform* rootTransform,
+                                std::vector<Transform>* nodePool, std::vector<MeshRange>* nodeMeshRanges)
     {
+        GLLIB_PROFILE_SCOPE("ModelLoader::loadModel");
+        ImportedModel model;
+        if (!importScene(path, model))
+            return;
+        directory = model.directory;
+
+        stbi_set_flip_vertically_on_load(gamma);
+        decodeImages(model);
+        for (size_t i = 0; i < model.images.size(); i++)
+            uploadImage(model, i);
+
+        const unsigned int firstMesh = static_cast<unsigned int>(meshes.size());
+        meshes.reserve(meshes.size() + model.meshes.size());
+        for (size_t i = 0; i < model.meshes.size(); i++)
+            meshes.push_back(uploadMesh(model, i));
+
+        if (nodePool)
+        {
+            // Every node but the root, reserved up front so the transforms never move once children point at them
+            nodePool->clear();
+            nodePool->reserve(model.nodes.size() - 1);
+        }
+
+        std::vector<Transform*> transforms(model.nodes.size());
+        for (size_t i = 0; i < model.nodes.size(); i++)
+        {
+            const ImportedNode& node = model.nodes[i];
+            Transform* currentTransform = rootTransform;
+            if (i > 0)
+            {
+                if (nodePool)
+                {
+                    nodePool->emplace_back();
+                    currentTransform = &nodePool->back();
+                }
+                else
+                {
+                    currentTransform = new Transform();
+                }
+                transforms[node.parentIndex]->addChild(currentTransform);
+            }
+            transforms[i] = currentTransform;
+
+            currentTransform->setPosition(node.position);
+            currentTransform->setScale(node.scale);
+            currentTransform->setRotation(node.rotation);
+            currentTransform->setLocalAABB(node.localAABBMin, node.localAABBMax);
+        }
+
+        if (nodeMeshRanges)
+        {
+            *nodeMeshRanges = model.nodeMeshRanges;
+            for (MeshRange& range : *nodeMeshRanges)
+                range.first += firstMesh;
+        }
+    }
+
+    bool ModelLoader::importScene(const std::string& path, ImportedModel& model)
+    {
+        GLLIB_PROFILE_SCOPE("ModelLoader::importScene");
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(
             path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -18,41 +83,37 @@ namespace gllib
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
         {
             std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-            return;
+            return false;
         }
-        directory = path.substr(0, path.find_last_of('/'));
-    
-        glm::vec3 minAABB(FLT_MAX);
-        glm::vec3 maxAABB(-FLT_MAX);
+        model.directory = path.substr(0, path.find_last_of('/'));
     
         // Process the root node - if it has only one child and no meshes, use the child as the actual root
-        aiNode* actualRoot = scene->mRootNode;
+        const aiNode* actualRoot = scene->mRootNode;
         if (scene->mRootNode->mNumMeshes == 0 && scene->mRootNode->mNumChildren == 1)
         {
             actualRoot = scene->mRootNode->mChildren[0];
         }
-    
-        processNode(actualRoot, scene, meshes, gamma, minAABB, maxAABB, rootTransform, nullptr);
+
+        const size_t nodeCount = countNodes(actualRoot);
+        model.nodes.reserve(nodeCount);
+        model.nodeMeshRanges.reserve(nodeCount);
+
+        std::unordered_map<std::string, unsigned int> imageLookup;
+        importNode(actualRoot, scene, -1, model, imageLookup);
+        return true;
     }
-    
-    void ModelLoader::processNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& meshes, bool gamma,
-                                 glm::vec3& minAABB, glm::vec3& maxAABB,
-                                 Transform* rootTransform, Transform* parentTransform)
+
+    size_t ModelLoader::countNodes(const aiNode* node)
     {
-        Transform* currentTransform;
-        
-        // If this is the root node call and parentTransform is null, use the provided rootTransform
-        if (parentTransform == nullptr)
-        {
-            currentTransform = rootTransform;
-        }
-        else
-        {
-            // Create a new child transform
-            currentTransform = new Transform();
-            parentTransform->addChild(currentTransform);
-        }
+        size_t count = 1;
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            count += countNodes(node->mChildren[i]);
+        return count;
+    }
     
+    void ModelLoader::importNode(const aiNode* node, const aiScene* scene, int parentIndex, ImportedModel& model,
+                                 std::unordered_map<std::string, unsigned int>& imageLookup)
+    {
         // Convert Assimp matrix to glm and extract transform components
         aiMatrix4x4 aiMat = node->mTransformation;
         glm::mat4 mat(
@@ -67,84 +128,64 @@ namespace gllib
         glm::vec4 perspective;
         glm::quat rotation;
         glm::decompose(mat, scale, rotation, translation, skew, perspective);
-    
-        // Set transform properties
-        currentTransform->setPosition(translation);
-        currentTransform->setScale(scale);
-    
-        Quaternion customQuat;
-        customQuat.w = rotation.w;
-        customQuat.x = rotation.x;
-        customQuat.y = rotation.y;
-        customQuat.z = rotation.z;
-        currentTransform->setRotation(customQuat);
+
+        // Nodes are numbered in preorder like the pool, the meshes of each node end up next to each other
+        const int nodeIndex = static_cast<int>(model.nodes.size());
+        model.nodes.push_back({translation, scale, {rotation.w, rotation.x, rotation.y, rotation.z},
+                               glm::vec3(0.0f), glm::vec3(0.0f), parentIndex});
+        model.nodeMeshRanges.push_back({static_cast<unsigned int>(model.meshes.size()), node->mNumMeshes});
     
         // Initialize AABB for this node
         glm::vec3 nodeMinAABB(FLT_MAX);
         glm::vec3 nodeMaxAABB(-FLT_MAX);
         bool hasGeometry = false;
     
-        // Process meshes for this node and associate them with the current transform
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
         {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            Mesh processedMesh = processMesh(mesh, scene, meshes, gamma);
-            
-            // Associate this mesh with the current transform
-            processedMesh.associatedTransform = currentTransform;
+            const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            ImportedMesh imported;
+            imported.data = convertMesh(mesh);
+            imported.nodeIndex = nodeIndex;
+
+            const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+            importMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", TextureType_Diffuse,
+                                   model, imported, imageLookup);
+            importMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", TextureType_Specular,
+                                   model, imported, imageLookup);
+            importMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", TextureType_Normal,
+                                   model, imported, imageLookup);
+            importMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", TextureType_Height,
+                                   model, imported, imageLookup);
     
             // Update node AABB
-            if (processedMesh.minAABB != processedMesh.maxAABB)
+            if (imported.data.minAABB != imported.data.maxAABB)
             {
-                if (!hasGeometry)
-                {
-                    nodeMinAABB = processedMesh.minAABB;
-                    nodeMaxAABB = processedMesh.maxAABB;
-                    hasGeometry = true;
-                }
-                else
-                {
-                    nodeMinAABB = glm::min(nodeMinAABB, processedMesh.minAABB);
-                    nodeMaxAABB = glm::max(nodeMaxAABB, processedMesh.maxAABB);
-                }
+                nodeMinAABB = hasGeometry ? glm::min(nodeMinAABB, imported.data.minAABB) : imported.data.minAABB;
+                nodeMaxAABB = hasGeometry ? glm::max(nodeMaxAABB, imported.data.maxAABB) : imported.data.maxAABB;
+                hasGeometry = true;
             }
     
-            // Update global AABB
-            minAABB = glm::min(minAABB, processedMesh.minAABB);
-            maxAABB = glm::max(maxAABB, processedMesh.maxAABB);
-    
-            meshes.push_back(processedMesh);
+            model.meshes.push_back(std::move(imported));
         }
     
-        // Set local AABB for this transform
-        if (hasGeometry)
-        {
-            currentTransform->localAABBMin = nodeMinAABB;
-            currentTransform->localAABBMax = nodeMaxAABB;
-        }
-        else
-        {
-            // No geometry in this node, set minimal AABB
-            currentTransform->localAABBMin = glm::vec3(-0.1f);
-            currentTransform->localAABBMax = glm::vec3(0.1f);
-        }
+        // No geometry in this node, set minimal AABB
+        model.nodes[nodeIndex].localAABBMin = hasGeometry ? nodeMinAABB : glm::vec3(-0.1f);
+        model.nodes[nodeIndex].localAABBMax = hasGeometry ? nodeMaxAABB : glm::vec3(0.1f);
     
         // Recursively process children
         for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene, meshes, gamma, minAABB, maxAABB,
-                       rootTransform, currentTransform);
+            importNode(node->mChildren[i], scene, nodeIndex, model, imageLookup);
         }
     }
 
-    Mesh ModelLoader::processMesh(aiMesh* mesh, const aiScene* scene, std::vector<Mesh>& meshes, bool gamma)
+    MeshData ModelLoader::convertMesh(const aiMesh* mesh)
     {
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
-        std::vector<Texture> textures;
-
-        glm::vec3 minAABB(FLT_MAX);
-        glm::vec3 maxAABB(-FLT_MAX);
+        MeshData data;
+        data.minAABB = glm::vec3(FLT_MAX);
+        data.maxAABB = glm::vec3(-FLT_MAX);
+        data.vertices.reserve(mesh->mNumVertices);
+        data.indices.reserve(mesh->mNumFaces * 3);
 
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
@@ -157,8 +198,8 @@ namespace gllib
             vertex.Position = vector;
 
             // Update AABB
-            minAABB = glm::min(minAABB, vector);
-            maxAABB = glm::max(maxAABB, vector);
+            data.minAABB = glm::min(data.minAABB, vector);
+            data.maxAABB = glm::max(data.maxAABB, vector);
 
             if (mesh->HasNormals())
             {
@@ -186,66 +227,141 @@ namespace gllib
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
 
-            vertices.push_back(vertex);
+            data.vertices.push_back(vertex);
         }
 
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace& face = mesh->mFaces[i];
             for (unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+                data.indices.push_back(face.mIndices[j]);
         }
 
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-        std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse",
-                                                                gamma);
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular",
-                                                                 gamma);
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", gamma);
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        std::vector<Texture> heightMaps =
-            loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", gamma);
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-        Mesh result = Mesh(vertices, indices, textures);
-        result.minAABB = minAABB;
-        result.maxAABB = maxAABB;
-        return result;
+        return data;
     }
 
-
-    std::vector<Texture> ModelLoader::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName,
-                                                           bool gamma)
+    void ModelLoader::importMaterialTextures(const aiMaterial* mat, aiTextureType type, const std::string& typeName,
+                                             TextureType kind, ImportedModel& model, ImportedMesh& mesh,
+                                             std::unordered_map<std::string, unsigned int>& imageLookup)
     {
-        std::vector<Texture> textures;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
+
+            // The same file can be referenced by several meshes and under a different slot, it is decoded once
+            std::unordered_map<std::string, unsigned int>::iterator it = imageLookup.find(str.C_Str());
+            if (it == imageLookup.end())
             {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true;
-                    break;
-                }
+                ImportedImage image;
+                image.path = str.C_Str();
+                it = imageLookup.emplace(image.path, static_cast<unsigned int>(model.images.size())).first;
+                model.images.push_back(std::move(image));
             }
-            if (!skip)
+            mesh.textures.push_back({it->second, typeName, kind});
+        }
+    }
+
+    void ModelLoader::decodeImages(ImportedModel& model)
+    {
+        GLLIB_PROFILE_SCOPE("ModelLoader::decodeImages");
+        for (ImportedImage& image : model.images)
+        {
+            const std::string filename = model.directory + '/' + image.path;
+            image.pixels = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+            if (!image.pixels)
+                std::cout << "Texture failed to load at path: " << image.path << std::endl;
+        }
+    }
+
+    void ModelLoader::uploadImage(ImportedModel& model, size_t index)
+    {
+        ImportedImage& image = model.images[index];
+        model.textureIds.resize(model.images.size(), 0);
+
+        for (const Texture& loaded : textures_loaded)
+        {
+            if (loaded.path == image.path)
             {
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), directory, gamma);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);
+                model.textureIds[index] = loaded.id;
+                textureUsers[loaded.id]++;
+                stbi_image_free(image.pixels);
+                image.pixels = nullptr;
+                return;
             }
         }
-        return textures;
+
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        if (image.pixels)
+        {
+            GLenum format = GL_RGBA;
+            if (image.components == 1)
+                format = GL_RED;
+            else if (image.components == 3)
+                format = GL_RGB;
+
+            GLStateCache::bindTexture(textureID);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE,
+                         image.pixels);
+            glGenerateMipmap(GL_TEXTURE_2D);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            stbi_image_free(image.pixels);
+            image.pixels = nullptr;
+        }
+        model.textureIds[index] = textureID;
+        textureUsers[textureID] = 1;
+
+        Texture texture;
+        texture.id = textureID;
+        texture.path = image.path;
+        textures_loaded.push_back(texture);
+    }
+
+    void ModelLoader::releaseTexture(unsigned int id)
+    {
+        std::unordered_map<unsigned int, unsigned int>::iterator users = textureUsers.find(id);
+        if (users == textureUsers.end() || --users->second > 0)
+            return;
+
+        textureUsers.erase(users);
+        for (std::vector<Texture>::iterator it = textures_loaded.begin(); it != textures_loaded.end(); ++it)
+        {
+            if (it->id == id)
+            {
+                textures_loaded.erase(it);
+                break;
+            }
+        }
+        Loader::unloadTexture(id);
+    }
+
+    Mesh ModelLoader::uploadMesh(ImportedModel& model, size_t index)
+    {
+        ImportedMesh& imported = model.meshes[index];
+
+        std::vector<Texture> textures;
+        textures.reserve(imported.textures.size());
+        for (const ImportedTexture& importedTexture : imported.textures)
+        {
+            Texture texture;
+            texture.id = model.textureIds[importedTexture.imageIndex];
+            texture.type = importedTexture.type;
+            texture.kind = importedTexture.kind;
+            texture.path = model.images[importedTexture.imageIndex].path;
+            textures.push_back(texture);
+        }
+
+        Mesh result = Mesh(std::move(imported.data.vertices), std::move(imported.data.indices), std::move(textures));
+        result.minAABB = imported.data.minAABB;
+        result.maxAABB = imported.data.maxAABB;
+        result.nodeIndex = imported.nodeIndex;
+        return result;
     }
 
     unsigned TextureFromFile(const char* path, const std::string& directory, bool gamma)
@@ -269,7 +385,7 @@ namespace gllib
             else if (nrComponents == 4)
                 format = GL_RGBA;
 
-            glBindTexture(GL_TEXTURE_2D, textureID);
+            GLStateCache::bindTexture(textureID);
             glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
             glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Mesh.h"
@@ -10,22 +11,131 @@
 
 namespace gllib
 {
+    /// <summary>
+    /// Geometry of an imported mesh before it reaches the GPU
+    /// </summary>
+    struct DLLExport MeshData
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        glm::vec3 minAABB;
+        glm::vec3 maxAABB;
+    };
+
+    /// <summary>
+    /// Meshes of one imported node, contiguous in the model's mesh list
+    /// </summary>
+    struct DLLExport MeshRange
+    {
+        unsigned int first = 0;
+        unsigned int count = 0;
+    };
+
+    /// <summary>
+    /// Imported node as loaded, local TRS and bounds of its own meshes
+    /// </summary>
+    struct DLLExport ImportedNode
+    {
+        glm::vec3 position;
+        glm::vec3 scale;
+        Quaternion rotation;
+        glm::vec3 localAABBMin;
+        glm::vec3 localAABBMax;
+        int parentIndex; // -1 for the root, parents always come before their children
+    };
+
+    struct DLLExport ImportedTexture
+    {
+        unsigned int imageIndex; // In ImportedModel::images
+        std::string type;
+        TextureType kind;
+    };
+
+    struct DLLExport ImportedMesh
+    {
+        MeshData data;
+        std::vector<ImportedTexture> textures;
+        int nodeIndex;
+    };
+
+    /// <summary>
+    /// A texture file used by the model, decoded pixels until it is uploaded
+    /// </summary>
+    struct DLLExport ImportedImage
+    {
+        std::string path; // As written in the material, the key of ModelLoader::textures_loaded
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        unsigned char* pixels = nullptr; // Owned by stb_image, freed by the upload
+    };
+
+    /// <summary>
+    /// Everything read from a model file before any GL call. Meshes and nodes are in preorder, node i + 1 is the
+    /// i-th child transform created from it.
+    /// </summary>
+    struct DLLExport ImportedModel
+    {
+        std::string directory;
+        std::vector<ImportedNode> nodes;
+        std::vector<MeshRange> nodeMeshRanges;
+        std::vector<ImportedMesh> meshes;
+        std::vector<ImportedImage> images;
+        std::vector<unsigned int> textureIds; // Filled by uploadImage, parallel to images
+    };
+
     static class DLLExport ModelLoader
     {
     public:
         static std::vector<Texture> textures_loaded;
+        static std::unordered_map<unsigned int, unsigned int> textureUsers; // Uploads sharing each loaded texture
         static std::string directory;
         static bool gammaCorrection;
 
-        static void loadModel(std::string const& path, std::vector<Mesh>& meshes, bool gamma, Transform* rootTransform);
+        /// <summary>
+        /// With a node pool the child transforms are stored in it, contiguous and parents first, instead of one
+        /// allocation each. The pool is sized once, its elements must not move while the model is alive.
+        /// Nodes are numbered in the same order, 0 for the root and i + 1 for nodePool[i]: every mesh gets the
+        /// index of its node and nodeMeshRanges[index] lists the meshes of each node.
+        /// </summary>
+        static void loadModel(std::string const& path, std::vector<Mesh>& meshes, bool gamma, Transform* rootTransform,
+                              std::vector<Transform>* nodePool = nullptr,
+                              std::vector<MeshRange>* nodeMeshRanges = nullptr);
+        /// <summary>
+        /// CPU half of the mesh import: vertices, indices and local bounds, without textures or GL calls
+        /// </summary>
+        static MeshData convertMesh(const aiMesh* mesh);
+
+        /// <summary>
+        /// Assimp parse and vertex conversion, no GL and no shared state, safe on any thread.
+        /// Returns false when the file can't be read.
+        /// </summary>
+        static bool importScene(const std::string& path, ImportedModel& model);
+        /// <summary>
+        /// Decodes the texture files with stb_image, safe on any thread. Flipping follows the calling thread's
+        /// stb_image setting.
+        /// </summary>
+        static void decodeImages(ImportedModel& model);
+        /// <summary>
+        /// GL upload of one decoded image, reusing a texture already loaded from the same path. Every upload
+        /// holds the texture until it calls releaseTexture.
+        /// </summary>
+        static void uploadImage(ImportedModel& model, size_t index);
+        /// <summary>
+        /// Drops one user of a texture from uploadImage, the last one deletes it
+        /// </summary>
+        static void releaseTexture(unsigned int id);
+        /// <summary>
+        /// GL upload of one mesh, its images must be uploaded first
+        /// </summary>
+        static Mesh uploadMesh(ImportedModel& model, size_t index);
     private:
-        static void processNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& meshes, bool gamma,
-                                 glm::vec3& minAABB, glm::vec3& maxAABB,
-                                 Transform* rootTransform, Transform* parentTransform);
-        static Mesh processMesh(aiMesh* mesh, const aiScene* scene, std::vector<Mesh>& meshes, bool gamma = false);
-        
-        static std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName,
-                                                         bool gamma = false);
+        static void importNode(const aiNode* node, const aiScene* scene, int parentIndex, ImportedModel& model,
+                               std::unordered_map<std::string, unsigned int>& imageLookup);
+        static size_t countNodes(const aiNode* node);
+        static void importMaterialTextures(const aiMaterial* mat, aiTextureType type, const std::string& typeName,
+                                           TextureType kind, ImportedModel& model, ImportedMesh& mesh,
+                                           std::unordered_map<std::string, unsigned int>& imageLookup);
     };
 
     static unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma);
@@ -0,0 +1,473 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "loader.h"
+#include "stb_image.h"
+#include "Rendering/GLStateCache.h"
+#include "Rendering/renderer.h"
+
+using namespace gllib;
+using namespace std;
+
+TextureAtlas::TextureAtlas(int pageWidth, int pageHeight, int padding) : pageWidth(pageWidth), pageHeight(pageHeight),
+                                                                          padding(padding)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    destroy();
+}
+
+TextureAtlas::TextureAtlas(TextureAtlas&& other) noexcept : pageWidth(other.pageWidth), pageHeight(other.pageHeight),
+                                                             padding(other.padding), pages(std::move(other.pages)),
+                                                             frames(std::move(other.frames))
+{
+    other.pages.clear();
+    other.frames.clear();
+}
+
+TextureAtlas& TextureAtlas::operator=(TextureAtlas&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    destroy();
+    pageWidth = other.pageWidth;
+    pageHeight = other.pageHeight;
+    padding = other.padding;
+    pages = std::move(other.pages);
+    frames = std::move(other.frames);
+    other.pages.clear();
+    other.frames.clear();
+    return *this;
+}
+
+// Private
+
+TextureAtlas::Page& TextureAtlas::addPage()
+{
+    pages.emplace_back();
+    Page& page = pages.back();
+    page.pixels.assign(static_cast<size_t>(pageWidth) * pageHeight * 4, 0);
+    page.skyline.push_back({0, 0, pageWidth});
+    return page;
+}
+
+int TextureAtlas::fitSkyline(const Page& page, size_t node, int width, int height) const
+{
+    const int x = page.skyline[node].x;
+    if (x + width > pageWidth)
+        return -1;
+
+    // The rectangle rests on the highest segment it spans
+    int y = page.skyline[node].y;
+    int widthLeft = width;
+    for (size_t i = node; widthLeft > 0; i++)
+    {
+        if (i >= page.skyline.size())
+            return -1;
+        y = max(y, page.skyline[i].y);
+        if (y + height > pageHeight)
+            return -1;
+        widthLeft -= page.skyline[i].width;
+    }
+    return y;
+}
+
+bool TextureAtlas::findPosition(const Page& page, int width, int height, int& x, int& y, size_t& node) const
+{
+    // Bottom-left: lowest resting point, ties go to the narrowest segment to waste less space under it
+    int bestY = pageHeight;
+    int bestWidth = pageWidth + 1;
+    bool found = false;
+    for (size_t i = 0; i < page.skyline.size(); i++)
+    {
+        const int fitY = fitSkyline(page, i, width, height);
+        if (fitY < 0)
+            continue;
+        if (fitY < bestY || (fitY == bestY && page.skyline[i].width < bestWidth))
+        {
+            bestY = fitY;
+            bestWidth = page.skyline[i].width;
+            x = page.skyline[i].x;
+            y = fitY;
+            node = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void TextureAtlas::placeSkyline(Page& page, size_t node, int x, int y, int width, int height)
+{
+    vector<SkylineNode>& skyline = page.skyline;
+    skyline.insert(skyline.begin() + node, {x, y + height, width});
+
+    // Segments now under the new one shrink or go away
+    for (size_t i = node + 1; i < skyline.size(); i++)
+    {
+        const SkylineNode& previous = skyline[i - 1];
+        const int previousEnd = previous.x + previous.width;
+        if (skyline[i].x >= previousEnd)
+            break;
+
+        const int shrink = previousEnd - skyline[i].x;
+        skyline[i].x += shrink;
+        skyline[i].width -= shrink;
+        if (skyline[i].width > 0)
+            break;
+
+        skyline.erase(skyline.begin() + i);
+        i--;
+    }
+
+    // Merge neighbours at the same height
+    for (size_t i = 0; i + 1 < skyline.size(); i++)
+    {
+        if (skyline[i].y != skyline[i + 1].y)
+            continue;
+        skyline[i].width += skyline[i + 1].width;
+        skyline.erase(skyline.begin() + i + 1);
+        i--;
+    }
+}
+
+void TextureAtlas::setFrameRect(AtlasFrame& frame, unsigned int page, int x, int y, int width, int height) const
+{
+    frame.page = page;
+    frame.textureID = page < pages.size() ? pages[page].textureID : 0;
+    frame.x = x;
+    frame.y = y;
+    frame.width = width;
+    frame.height = height;
+    frame.uMin = static_cast<float>(x) / pageWidth;
+    frame.vMin = static_cast<float>(y) / pageHeight;
+    frame.uMax = static_cast<float>(x + width) / pageWidth;
+    frame.vMax = static_cast<float>(y + height) / pageHeight;
+}
+
+bool TextureAtlas::writeTGA(const string& path, const Page& page) const
+{
+    ofstream file(path, ios::binary);
+    if (!file.is_open())
+    {
+        cout << "Couldn't write atlas page " << path << endl;
+        return false;
+    }
+
+    // Uncompressed 32 bit true color, origin at the top left so rows go out as they are stored
+    unsigned char header[18] = {};
+    header[2] = 2;
+    header[12] = static_cast<unsigned char>(pageWidth & 0xFF);
+    header[13] = static_cast<unsigned char>(pageWidth >> 8);
+    header[14] = static_cast<unsigned char>(pageHeight & 0xFF);
+    header[15] = static_cast<unsigned char>(pageHeight >> 8);
+    header[16] = 32;
+    header[17] = 0x28;
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    vector<unsigned char> row(static_cast<size_t>(pageWidth) * 4);
+    for (int y = 0; y < pageHeight; y++)
+    {
+        const unsigned char* source = &page.pixels[static_cast<size_t>(y) * pageWidth * 4];
+        for (int x = 0; x < pageWidth; x++)
+        {
+            // TGA stores BGRA
+            row[x * 4 + 0] = source[x * 4 + 2];
+            row[x * 4 + 1] = source[x * 4 + 1];
+            row[x * 4 + 2] = source[x * 4 + 0];
+            row[x * 4 + 3] = source[x * 4 + 3];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return file.good();
+}
+
+// Public
+
+bool TextureAtlas::addImage(const string& name, const unsigned char* rgba, int width, int height)
+{
+    if (!rgba || width <= 0 || height <= 0)
+        return false;
+
+    const int paddedWidth = width + padding;
+    const int paddedHeight = height + padding;
+    if (paddedWidth > pageWidth || paddedHeight > pageHeight)
+    {
+        cout << "Image " << name << " (" << width << "x" << height << ") doesn't fit an atlas page" << endl;
+        return false;
+    }
+
+    // Try the pages in order, a new page only when none has room
+    int x = 0, y = 0;
+    size_t node = 0;
+    unsigned int pageIndex = 0;
+    for (; pageIndex < pages.size(); pageIndex++)
+    {
+        if (findPosition(pages[pageIndex], paddedWidth, paddedHeight, x, y, node))
+            break;
+    }
+    if (pageIndex == pages.size())
+    {
+        addPage();
+        if (!findPosition(pages[pageIndex], paddedWidth, paddedHeight, x, y, node))
+            return false;
+    }
+
+    Page& page = pages[pageIndex];
+    placeSkyline(page, node, x, y, paddedWidth, paddedHeight);
+
+    for (int row = 0; row < height; row++)
+    {
+        memcpy(&page.pixels[(static_cast<size_t>(y + row) * pageWidth + x) * 4],
+               &rgba[static_cast<size_t>(row) * width * 4], static_cast<size_t>(width) * 4);
+    }
+
+    setFrameRect(frames[name], pageIndex, x, y, width, height);
+    return true;
+}
+
+bool TextureAtlas::addImage(const string& name, const string& path)
+{
+    if (!Loader::fileExists(path))
+    {
+        cout << "No image was found at " << path << endl;
+        return false;
+    }
+
+    // Rows from the top, the same way Loader uploads sprite textures
+    int width, height;
+    unsigned char* data = Loader::loadPixels(path, width, height, 4, false);
+    if (!data)
+    {
+        cout << "Failed to load " << path << ": " << stbi_failure_reason() << endl;
+        return false;
+    }
+
+    const bool added = addImage(name, data, width, height);
+    stbi_image_free(data);
+    return added;
+}
+
+bool TextureAtlas::addSheet(const string& prefix, const string& path, int frameWidth, int frameHeight,
+                            int columns, int rows, int startX, int startY)
+{
+    if (!addImage(prefix, path))
+        return false;
+
+    int index = 0;
+    for (int y = 0; y < rows; y++)
+    {
+        for (int x = 0; x < columns; x++)
+        {
+            addSubFrame(prefix + "_" + to_string(index++), prefix, startX + x * frameWidth, startY + y * frameHeight,
+                        frameWidth, frameHeight);
+        }
+    }
+    return true;
+}
+
+bool TextureAtlas::addSubFrame(const string& name, const string& parent, int x, int y, int width, int height)
+{
+    unordered_map<string, AtlasFrame>::const_iterator it = frames.find(parent);
+    if (it == frames.end())
+    {
+        cout << "Atlas has no image called " << parent << endl;
+        return false;
+    }
+
+    const AtlasFrame parentFrame = it->second;
+    if (x < 0 || y < 0 || x + width > parentFrame.width || y + height > parentFrame.height)
+    {
+        cout << "Frame " << name << " is outside of " << parent << endl;
+        return false;
+    }
+
+    setFrameRect(frames[name], parentFrame.page, parentFrame.x + x, parentFrame.y + y, width, height);
+    return true;
+}
+
+void TextureAtlas::build(GLint filtering)
+{
+    for (Page& page : pages)
+    {
+        if (page.textureID == 0)
+            glGenTextures(1, &page.textureID);
+
+        GLStateCache::bindTexture(page.textureID);
+        // Clamped and without mipmaps so neighbour frames don't bleed in
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filtering);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filtering);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pageWidth, pageHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, page.pixels.data());
+        Renderer::setTextureSize(page.textureID, pageWidth, pageHeight);
+    }
+
+    for (pair<const string, AtlasFrame>& frame : frames)
+        frame.second.textureID = getPageTexture(frame.second.page);
+
+    cout << "Built texture atlas with " << frames.size() << " frames in " << pages.size() << " pages" << endl;
+}
+
+bool TextureAtlas::save(const string& path) const
+{
+    ofstream manifest(path + ".atlas");
+    if (!manifest.is_open())
+    {
+        cout << "Couldn't write atlas manifest " << path << ".atlas" << endl;
+        return false;
+    }
+
+    // Page files are stored by name only, they sit next to the manifest
+    const size_t slash = path.find_last_of("/\\");
+    const string baseName = slash == string::npos ? path : path.substr(slash + 1);
+
+    manifest << "atlas " << pageWidth << " " << pageHeight << " " << pages.size() << "\n";
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        const string pageFile = baseName + "_" + to_string(i) + ".tga";
+        if (!writeTGA(path + "_" + to_string(i) + ".tga", pages[i]))
+            return false;
+        manifest << "page " << i << " " << pageFile << "\n";
+    }
+
+    // The name goes last so it can hold spaces
+    for (const pair<const string, AtlasFrame>& frame : frames)
+    {
+        const AtlasFrame& f = frame.second;
+        manifest << "frame " << f.page << " " << f.x << " " << f.y << " " << f.width << " " << f.height << " "
+            << frame.first << "\n";
+    }
+
+    cout << "Saved texture atlas " << path << ".atlas" << endl;
+    return manifest.good();
+}
+
+bool TextureAtlas::load(const string& path, GLint filtering)
+{
+    const string manifestPath = path + ".atlas";
+    ifstream manifest(manifestPath);
+    if (!manifest.is_open())
+    {
+        cout << "No atlas manifest was found at " << manifestPath << endl;
+        return false;
+    }
+
+    destroy();
+
+    const size_t slash = path.find_last_of("/\\");
+    const string directory = slash == string::npos ? "" : path.substr(0, slash + 1);
+
+    string line;
+    while (getline(manifest, line))
+    {
+        istringstream stream(line);
+        string kind;
+        stream >> kind;
+
+        if (kind == "atlas")
+        {
+            int width = 0, height = 0;
+            size_t pageCount = 0;
+            stream >> width >> height >> pageCount;
+            if (!stream || width <= 0 || height <= 0)
+            {
+                cout << "Atlas manifest " << manifestPath << " has an invalid page size" << endl;
+                return false;
+            }
+            pageWidth = width;
+            pageHeight = height;
+            pages.reserve(pageCount);
+        }
+        else if (kind == "page")
+        {
+            size_t index;
+            string file;
+            stream >> index >> file;
+
+            if (!stream || index != pages.size())
+            {
+                cout << "Atlas manifest " << manifestPath << " lists its pages out of order" << endl;
+                destroy();
+                return false;
+            }
+
+            int width, height;
+            unsigned char* data = Loader::loadPixels(directory + file, width, height, 4, false);
+            if (!data || width != pageWidth || height != pageHeight)
+            {
+                cout << "Atlas page " << directory + file << " is missing or has the wrong size" << endl;
+                stbi_image_free(data);
+                destroy();
+                return false;
+            }
+
+            Page& page = addPage();
+            memcpy(page.pixels.data(), data, page.pixels.size());
+            // Loaded pages are full as far as the packer knows, new images start a new page
+            page.skyline.assign(1, {0, pageHeight, pageWidth});
+            stbi_image_free(data);
+        }
+        else if (kind == "frame")
+        {
+            unsigned int page;
+            int x, y, width, height;
+            string name;
+            stream >> page >> x >> y >> width >> height;
+            stream.ignore(1);
+            getline(stream, name);
+
+            // Pages come first in the manifest, a frame past them or off its page means a broken or stale file
+            if (!stream || page >= pages.size() || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+                x + width > pageWidth || y + height > pageHeight)
+            {
+                cout << "Atlas manifest " << manifestPath << " has an invalid frame: " << line << endl;
+                destroy();
+                return false;
+            }
+            setFrameRect(frames[name], page, x, y, width, height);
+        }
+    }
+
+    build(filtering);
+    return true;
+}
+
+void TextureAtlas::destroy()
+{
+    for (Page& page : pages)
+    {
+        if (page.textureID != 0)
+            Loader::unloadTexture(page.textureID);
+    }
+    pages.clear();
+    frames.clear();
+}
+
+const AtlasFrame* TextureAtlas::getFrame(const string& name) const
+{
+    unordered_map<string, AtlasFrame>::const_iterator it = frames.find(name);
+    return it != frames.end() ? &it->second : nullptr;
+}
+
+bool TextureAtlas::hasFrame(const string& name) const
+{
+    return frames.find(name) != frames.end();
+}
+
+unsigned int TextureAtlas::getPageCount() const
+{
+    return static_cast<unsigned int>(pages.size());
+}
+
+unsigned int TextureAtlas::getPageTexture(unsigned int page) const
+{
+    return page < pages.size() ? pages[page].textureID : 0;
+}
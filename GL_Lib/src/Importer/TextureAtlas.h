@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Core/deps.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// Where an image ended up inside the atlas. Pixels count from the top left of the page,
+    /// uvs follow the same convention as Sprite::addFrame.
+    /// </summary>
+    struct DLLExport AtlasFrame
+    {
+        unsigned int page = 0;
+        unsigned int textureID = 0; // 0 until the atlas is built
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+        float uMin = 0.0f;
+        float vMin = 0.0f;
+        float uMax = 0.0f;
+        float vMax = 0.0f;
+    };
+
+    /// <summary>
+    /// Packs loose images into shared RGBA pages with a skyline bottom-left packer. Frames are kept on the CPU,
+    /// so setting up sprites never queries GL, and every sprite of an atlas page shares a texture.
+    /// Pages can be uploaded right away (build) or written to disk with a manifest and loaded later (save/load).
+    /// </summary>
+    class DLLExport TextureAtlas
+    {
+    private:
+        struct SkylineNode
+        {
+            int x;
+            int y;
+            int width;
+        };
+
+        struct Page
+        {
+            std::vector<unsigned char> pixels;
+            std::vector<SkylineNode> skyline;
+            unsigned int textureID = 0;
+        };
+
+        int pageWidth;
+        int pageHeight;
+        int padding;
+        std::vector<Page> pages;
+        std::unordered_map<std::string, AtlasFrame> frames;
+
+        Page& addPage();
+        int fitSkyline(const Page& page, size_t node, int width, int height) const;
+        bool findPosition(const Page& page, int width, int height, int& x, int& y, size_t& node) const;
+        void placeSkyline(Page& page, size_t node, int x, int y, int width, int height);
+        void setFrameRect(AtlasFrame& frame, unsigned int page, int x, int y, int width, int height) const;
+        bool writeTGA(const std::string& path, const Page& page) const;
+
+    public:
+        TextureAtlas(int pageWidth = 2048, int pageHeight = 2048, int padding = 1);
+        ~TextureAtlas();
+
+        // The page textures are owned, a copy would unload them twice
+        TextureAtlas(const TextureAtlas&) = delete;
+        TextureAtlas& operator=(const TextureAtlas&) = delete;
+        TextureAtlas(TextureAtlas&& other) noexcept;
+        TextureAtlas& operator=(TextureAtlas&& other) noexcept;
+
+        /// <summary>
+        /// Packs RGBA pixels, rows from the top. Returns false if the image can't fit an empty page.
+        /// </summary>
+        bool addImage(const std::string& name, const unsigned char* rgba, int width, int height);
+        bool addImage(const std::string& name, const std::string& path);
+        /// <summary>
+        /// Packs a whole sprite sheet and registers each cell as "prefix_i", row by row from the top left
+        /// </summary>
+        bool addSheet(const std::string& prefix, const std::string& path, int frameWidth, int frameHeight,
+                      int columns, int rows, int startX = 0, int startY = 0);
+        /// <summary>
+        /// Registers a frame inside an image that was already packed, in pixels relative to it
+        /// </summary>
+        bool addSubFrame(const std::string& name, const std::string& parent, int x, int y, int width, int height);
+
+        /// <summary>
+        /// Uploads every page as a texture, frames get their textureID here
+        /// </summary>
+        void build(GLint filtering = GL_NEAREST);
+        /// <summary>
+        /// Writes the pages as path_page.tga and the frame rects in path.atlas
+        /// </summary>
+        bool save(const std::string& path) const;
+        /// <summary>
+        /// Loads an atlas written with save and builds it, replacing anything packed before
+        /// </summary>
+        bool load(const std::string& path, GLint filtering = GL_NEAREST);
+        void destroy();
+
+        const AtlasFrame* getFrame(const std::string& name) const;
+        bool hasFrame(const std::string& name) const;
+        unsigned int getPageCount() const;
+        unsigned int getPageTexture(unsigned int page) const;
+    };
+}
@@ -4,6 +4,9 @@
 #include <fstream>
 #include <vector>
 
+#include "Rendering/GLStateCache.h"
+#include "Rendering/renderer.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -25,7 +28,7 @@ unsigned int Loader::loadTextureAdvanced(string filePath, GLint wrapping, GLint
     unsigned int texture = 0;
 
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLStateCache::bindTexture(texture);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapping);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapping);
@@ -43,12 +46,14 @@ unsigned int Loader::loadTextureAdvanced(string filePath, GLint wrapping, GLint
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
         }
         glGenerateMipmap(GL_TEXTURE_2D);
+        Renderer::setTextureSize(texture, width, height);
 
         cout << "The texture (" << texture << ") " << filePath << " was loaded!\n";
     }
     else {
         cerr << "Failed to load texture!!\n";
         cerr << "Reason: " << stbi_failure_reason() << "\n";
+        GLStateCache::forgetTexture(texture);
         glDeleteTextures(1, &texture);
         return 0;
     }
@@ -61,6 +66,16 @@ unsigned int Loader::loadTexture(string filePath, bool transparent) {
     return loadTextureAdvanced(filePath, GL_REPEAT, GL_NEAREST, transparent);
 }
 
+unsigned char* Loader::loadPixels(string filePath, int& width, int& height, int channels, bool flip) {
+    // stb_image's flip is global, the setting the other loads rely on is put back afterwards
+    const int previousFlip = stbi__vertically_flip_on_load_global;
+    stbi_set_flip_vertically_on_load(flip);
+    int fileChannels;
+    unsigned char* data = stbi_load(filePath.c_str(), &width, &height, &fileChannels, channels);
+    stbi_set_flip_vertically_on_load(previousFlip);
+    return data;
+}
+
 const char* Loader::loadTextFile(string filePath) {
     ifstream file(filePath, ios::binary | ios::ate);
     if (!file.is_open()) {
@@ -115,6 +130,8 @@ const char* Loader::loadTextFile(string filePath) {
 }
 
 void Loader::unloadTexture(unsigned int id) {
+    GLStateCache::forgetTexture(id);
+    Renderer::forgetTextureSize(id);
     glDeleteTextures(1, &id);
     cout << "Texture (" << id << ") was unloaded!\n";
 }
\ No newline at end of file
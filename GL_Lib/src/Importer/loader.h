@@ -9,6 +9,7 @@ namespace gllib {
 		static bool fileExists(std::string filePath);
 		static unsigned int loadTextureAdvanced(std::string filePath, GLint wrapping, GLint filtering, bool transparent);
 		static unsigned int loadTexture(std::string filePath, bool transparent);
+		static unsigned char* loadPixels(std::string filePath, int& width, int& height, int channels, bool flip);
 		static const char* loadTextFile(std::string filePath);
 		static void unloadTexture(unsigned int id);
 	};
@@ -0,0 +1,107 @@
+#include "TransformHierarchy.h"
+
+using namespace gllib;
+using namespace std;
+
+void TransformHierarchy::build(Transform* newRoot)
+{
+    clear();
+    root = newRoot;
+    if (!root)
+        return;
+    builtVersion = root->structureVersion;
+
+    // Iterative preorder, children pushed in reverse so they come out in their original order
+    vector<pair<Transform*, int>> stack;
+    stack.push_back({root, -1});
+    while (!stack.empty())
+    {
+        const pair<Transform*, int> entry = stack.back();
+        stack.pop_back();
+
+        const int index = static_cast<int>(nodes.size());
+        nodes.push_back(entry.first);
+        parentIndices.push_back(entry.second);
+
+        const vector<Transform*>& children = entry.first->children;
+        for (size_t i = children.size(); i > 0; i--)
+            stack.push_back({children[i - 1], index});
+    }
+
+    // Walking backwards every child's size is known before its parent adds it
+    subtreeSizes.assign(nodes.size(), 1);
+    for (size_t i = nodes.size(); i > 1; i--)
+        subtreeSizes[parentIndices[i - 1]] += subtreeSizes[i - 1];
+
+    // The arrays hold nothing yet, the next update recomputes everything
+    worldMatrices.resize(nodes.size(), glm::mat4(1.0f));
+    for (Transform* node : nodes)
+    {
+        node->worldMatrixDirty = true;
+        node->boundsDirty = true;
+    }
+}
+
+void TransformHierarchy::clear()
+{
+    root = nullptr;
+    nodes.clear();
+    parentIndices.clear();
+    subtreeSizes.clear();
+    worldMatrices.clear();
+    dirtyIndices.clear();
+}
+
+void TransformHierarchy::update()
+{
+    GLLIB_PROFILE_SCOPE("TransformHierarchy::update");
+    if (root && builtVersion != root->structureVersion)
+        build(root);
+
+    // Dirty bits bubble up to the root, a clean root means nothing moved
+    if (nodes.empty() || !root->boundsDirty)
+        return;
+
+    updateWorldMatrices();
+    updateBounds();
+}
+
+void TransformHierarchy::updateWorldMatrices()
+{
+    dirtyIndices.clear();
+    size_t i = 0;
+    while (i < nodes.size())
+    {
+        Transform* node = nodes[i];
+        if (!node->boundsDirty)
+        {
+            // Nothing changed in this subtree, its matrices in the array are still this frame's
+            i += subtreeSizes[i];
+            continue;
+        }
+
+        // markDirty flags the whole moved subtree. A node whose matrix was already refreshed through
+        // getTransformMatrix keeps its cached one.
+        if (node->worldMatrixDirty)
+        {
+            const int parent = parentIndices[i];
+            // Parents come first, so their world matrix of this pass is already in the array
+            const glm::mat4 local = node->getLocalTransformMatrix();
+            node->cachedWorldMatrix = parent < 0 ? local : worldMatrices[parent] * local;
+            node->worldMatrixDirty = false;
+        }
+        worldMatrices[i] = node->cachedWorldMatrix;
+        dirtyIndices.push_back(static_cast<int>(i));
+        i++;
+    }
+}
+
+void TransformHierarchy::updateBounds()
+{
+    // Children come after their parent, walking the dirty nodes backwards every child is finished before its
+    // parent reads it. Clean children still hold their boxes from an earlier update.
+    for (size_t i = dirtyIndices.size(); i > 0; i--)
+    {
+        nodes[dirtyIndices[i - 1]]->mergeHierarchicalAABB();
+    }
+}
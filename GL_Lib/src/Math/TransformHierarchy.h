@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+
+#include "Core/deps.h"
+#include "Math/transform.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// A Transform tree flattened in preorder, parents before their children, updated in flat loops instead of
+    /// recursion. Only dirty nodes are recomputed and clean subtrees are skipped whole.
+    /// </summary>
+    class DLLExport TransformHierarchy
+    {
+    private:
+        Transform* root = nullptr;
+        unsigned int builtVersion = 0;
+
+        std::vector<Transform*> nodes; // Preorder, nodes[0] is the root and every subtree is contiguous
+        std::vector<int> parentIndices; // -1 for the root
+        std::vector<int> subtreeSizes; // Nodes in the subtree including itself, nodes[i + subtreeSizes[i]] is past it
+        std::vector<glm::mat4> worldMatrices;
+        std::vector<int> dirtyIndices; // Visited by the last world matrix pass, in preorder
+
+    public:
+        void build(Transform* root);
+        void clear();
+
+        /// <summary>
+        /// World matrices then bounds of the dirty nodes, same results as Transform::updateTRSAndAABB on the root.
+        /// Rebuilds first if children were added or removed under the root since the last build.
+        /// </summary>
+        void update();
+        void updateWorldMatrices();
+        void updateBounds();
+
+        size_t size() const { return nodes.size(); }
+        Transform* getRoot() const { return root; }
+        const std::vector<Transform*>& getNodes() const { return nodes; }
+        const std::vector<int>& getParentIndices() const { return parentIndices; }
+    };
+}
@@ -2,6 +2,7 @@
 #include <ext/matrix_transform.hpp>
 
 #include "Core/deps.h"
+#include "Core/Profiler.h"
 #define GLM_ENABLE_EXPERIMENTAL
 #include "gtx/quaternion.hpp"
 #ifdef _WIN32
@@ -79,9 +80,19 @@ namespace gllib
 
     struct DLLExport Transform
     {
-        glm::vec3 position;
-        glm::vec3 scale;
-        Quaternion rotationQuat;
+    private:
+        // Only written through the setters, a change the cached matrices don't know about is never drawn
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 scale = glm::vec3(1.0f);
+        Quaternion rotationQuat = {1.0f, 0.0f, 0.0f, 0.0f};
+
+    public:
+        Transform() = default;
+
+        Transform(const glm::vec3& position, const glm::vec3& scale, const Quaternion& rotation) :
+            position(position), scale(scale), rotationQuat(rotation)
+        {
+        }
 
         glm::vec3 forward;
         glm::vec3 upward;
@@ -102,6 +113,28 @@ namespace gllib
         // Cached transform matrix
         mutable glm::mat4 cachedWorldMatrix = glm::mat4(1.0f);
         mutable bool worldMatrixDirty = true;
+        // Hierarchical AABB needs recomputing. Set on every changed node and bubbled up to the root, so a clean
+        // node has a clean subtree.
+        bool boundsDirty = true;
+
+        // Bumped on the node and its ancestors by addChild and removeChild, a flattened hierarchy rebuilds when
+        // its root's changes. Edits in other trees leave it alone.
+        unsigned int structureVersion = 0;
+
+        const glm::vec3& getPosition() const
+        {
+            return position;
+        }
+
+        const glm::vec3& getScale() const
+        {
+            return scale;
+        }
+
+        const Quaternion& getRotation() const
+        {
+            return rotationQuat;
+        }
 
         void setPosition(const glm::vec3& newPosition)
         {
@@ -140,11 +173,62 @@ namespace gllib
         }
 
         void markDirty()
+        {
+            markSubtreeDirty();
+            markBoundsDirty();
+        }
+
+        /// <summary>
+        /// For changes that move no node, like a new localAABB
+        /// </summary>
+        void markBoundsDirty()
+        {
+            boundsDirty = true;
+            for (Transform* ancestor = parent; ancestor && !ancestor->boundsDirty; ancestor = ancestor->parent)
+            {
+                ancestor->boundsDirty = true;
+            }
+        }
+
+        void markSubtreeDirty()
         {
             worldMatrixDirty = true;
+            boundsDirty = true;
             for (Transform* child : children)
             {
-                child->markDirty();
+                child->markSubtreeDirty();
+            }
+        }
+
+        void setLocalAABB(const glm::vec3& newMin, const glm::vec3& newMax)
+        {
+            localAABBMin = newMin;
+            localAABBMax = newMax;
+            markBoundsDirty();
+        }
+
+        /// <summary>
+        /// World box of a local box (Arvo): the center moves with the matrix, the extents with its absolute
+        /// 3x3 part. Same box as transforming the 8 corners, without building them.
+        /// </summary>
+        static void transformAABB(const glm::mat4& matrix, const glm::vec3& localMin, const glm::vec3& localMax,
+                                  glm::vec3& worldMin, glm::vec3& worldMax)
+        {
+            const glm::vec3 center = (localMin + localMax) * 0.5f;
+            const glm::vec3 extents = (localMax - localMin) * 0.5f;
+            const glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+            const glm::vec3 worldExtents = glm::abs(glm::vec3(matrix[0])) * extents.x +
+                glm::abs(glm::vec3(matrix[1])) * extents.y +
+                glm::abs(glm::vec3(matrix[2])) * extents.z;
+            worldMin = worldCenter - worldExtents;
+            worldMax = worldCenter + worldExtents;
+        }
+
+        void bumpStructureVersion()
+        {
+            for (Transform* node = this; node; node = node->parent)
+            {
+                node->structureVersion++;
             }
         }
 
@@ -157,6 +241,7 @@ namespace gllib
                 child->parent = this;
                 children.push_back(child);
                 child->markDirty();
+                bumpStructureVersion();
             }
         }
 
@@ -166,33 +251,31 @@ namespace gllib
             if (it != children.end())
             {
                 (*it)->parent = nullptr;
-                children.erase(it);
                 (*it)->markDirty();
+                children.erase(it);
+                markBoundsDirty();
+                bumpStructureVersion();
             }
         }
 
         Transform operator/(float i)
         {
-            return {
-                position / i,
-                scale / i,
-                {rotationQuat.w / i, rotationQuat.x / i, rotationQuat.y / i, rotationQuat.z / i},
-                forward / i,
-                upward / i,
-                right / i
-            };
+            Transform result(position / i, scale / i,
+                             {rotationQuat.w / i, rotationQuat.x / i, rotationQuat.y / i, rotationQuat.z / i});
+            result.forward = forward / i;
+            result.upward = upward / i;
+            result.right = right / i;
+            return result;
         }
 
         Transform operator*(float i)
         {
-            return {
-                position * i,
-                scale * i,
-                {rotationQuat.w * i, rotationQuat.x * i, rotationQuat.y * i, rotationQuat.z * i},
-                forward * i,
-                upward * i,
-                right * i
-            };
+            Transform result(position * i, scale * i,
+                             {rotationQuat.w * i, rotationQuat.x * i, rotationQuat.y * i, rotationQuat.z * i});
+            result.forward = forward * i;
+            result.upward = upward * i;
+            result.right = right * i;
+            return result;
         }
 
         glm::mat4 getTransformMatrix() const
@@ -229,82 +312,24 @@ namespace gllib
             return translation * rotationMatrix * scaling;
         }
 
-        // Add this method to the Transform struct
+        /// <summary>
+        /// World matrices and hierarchical AABBs of the subtree. Only dirty nodes are recomputed, a clean node
+        /// returns right away since nothing under it changed.
+        /// </summary>
         void updateTRSAndAABB()
         {
-            // Update world matrix first
-            updateWorldMatrix();
-            
-            // Reset hierarchical AABB
-            hierarchicalAABBMin = glm::vec3(FLT_MAX);
-            hierarchicalAABBMax = glm::vec3(-FLT_MAX);
-            
-            bool hasValidAABB = false;
-        
-            // Only process local AABB if it's valid (not zero-sized)
-            if (localAABBMin != localAABBMax)
-            {
-                // Transform all 8 corners of the local AABB
-                std::vector<glm::vec3> corners = {
-                    glm::vec3(localAABBMin.x, localAABBMin.y, localAABBMin.z),
-                    glm::vec3(localAABBMax.x, localAABBMin.y, localAABBMin.z),
-                    glm::vec3(localAABBMin.x, localAABBMax.y, localAABBMin.z),
-                    glm::vec3(localAABBMax.x, localAABBMax.y, localAABBMin.z),
-                    glm::vec3(localAABBMin.x, localAABBMin.y, localAABBMax.z),
-                    glm::vec3(localAABBMax.x, localAABBMin.y, localAABBMax.z),
-                    glm::vec3(localAABBMin.x, localAABBMax.y, localAABBMax.z),
-                    glm::vec3(localAABBMax.x, localAABBMax.y, localAABBMax.z)
-                };
-        
-                for (const glm::vec3& corner : corners)
-                {
-                    glm::vec3 worldPos = glm::vec3(cachedWorldMatrix * glm::vec4(corner, 1.0f));
-                    
-                    if (!hasValidAABB)
-                    {
-                        hierarchicalAABBMin = worldPos;
-                        hierarchicalAABBMax = worldPos;
-                        hasValidAABB = true;
-                    }
-                    else
-                    {
-                        hierarchicalAABBMin = glm::min(hierarchicalAABBMin, worldPos);
-                        hierarchicalAABBMax = glm::max(hierarchicalAABBMax, worldPos);
-                    }
-                }
-            }
-        
-            // Recursively update children and include their AABBs
+            GLLIB_PROFILE_SCOPE("Transform::updateTRSAndAABB");
+            if (!boundsDirty && !worldMatrixDirty)
+                return;
+
+            if (worldMatrixDirty)
+                updateWorldMatrix();
+
             for (Transform* child : children)
             {
                 child->updateTRSAndAABB();
-                
-                // Include child AABB if it's valid
-                if (child->hierarchicalAABBMin.x <= child->hierarchicalAABBMax.x &&
-                    child->hierarchicalAABBMin.y <= child->hierarchicalAABBMax.y &&
-                    child->hierarchicalAABBMin.z <= child->hierarchicalAABBMax.z)
-                {
-                    if (!hasValidAABB)
-                    {
-                        hierarchicalAABBMin = child->hierarchicalAABBMin;
-                        hierarchicalAABBMax = child->hierarchicalAABBMax;
-                        hasValidAABB = true;
-                    }
-                    else
-                    {
-                        hierarchicalAABBMin = glm::min(hierarchicalAABBMin, child->hierarchicalAABBMin);
-                        hierarchicalAABBMax = glm::max(hierarchicalAABBMax, child->hierarchicalAABBMax);
-                    }
-                }
-            }
-        
-            // If no valid AABB was found, set a minimal one at world position
-            if (!hasValidAABB)
-            {
-                glm::vec3 worldPos = glm::vec3(cachedWorldMatrix[3]);
-                hierarchicalAABBMin = worldPos - glm::vec3(0.1f);
-                hierarchicalAABBMax = worldPos + glm::vec3(0.1f);
             }
+            mergeHierarchicalAABB();
         }
         
         // Top-down: Update world matrices recursively
@@ -320,79 +345,48 @@ namespace gllib
         // Bottom-up: Calculate hierarchical AABB including all children
         void calculateHierarchicalAABB()
         {
-            glm::mat4 worldMatrix = getTransformMatrix();
-            
-            // Reset hierarchical AABB
+            getTransformMatrix();
+            for (Transform* child : children)
+            {
+                child->calculateHierarchicalAABB();
+            }
+            mergeHierarchicalAABB();
+        }
+
+        /// <summary>
+        /// Own world box merged with the children's current hierarchical AABBs, which must be up to date
+        /// </summary>
+        void mergeHierarchicalAABB()
+        {
             hierarchicalAABBMin = glm::vec3(FLT_MAX);
             hierarchicalAABBMax = glm::vec3(-FLT_MAX);
-            
-            bool hasValidAABB = false;
-        
+
             // Only process local AABB if it's valid (not zero-sized)
             if (localAABBMin != localAABBMax)
             {
-                // Transform all 8 corners of the local AABB
-                std::vector<glm::vec3> corners = {
-                    glm::vec3(localAABBMin.x, localAABBMin.y, localAABBMin.z),
-                    glm::vec3(localAABBMax.x, localAABBMin.y, localAABBMin.z),
-                    glm::vec3(localAABBMin.x, localAABBMax.y, localAABBMin.z),
-                    glm::vec3(localAABBMax.x, localAABBMax.y, localAABBMin.z),
-                    glm::vec3(localAABBMin.x, localAABBMin.y, localAABBMax.z),
-                    glm::vec3(localAABBMax.x, localAABBMin.y, localAABBMax.z),
-                    glm::vec3(localAABBMin.x, localAABBMax.y, localAABBMax.z),
-                    glm::vec3(localAABBMax.x, localAABBMax.y, localAABBMax.z)
-                };
-        
-                for (const glm::vec3& corner : corners)
-                {
-                    glm::vec4 worldCorner = worldMatrix * glm::vec4(corner, 1.0f);
-                    glm::vec3 worldPos = glm::vec3(worldCorner);
-                    
-                    if (!hasValidAABB)
-                    {
-                        hierarchicalAABBMin = worldPos;
-                        hierarchicalAABBMax = worldPos;
-                        hasValidAABB = true;
-                    }
-                    else
-                    {
-                        hierarchicalAABBMin = glm::min(hierarchicalAABBMin, worldPos);
-                        hierarchicalAABBMax = glm::max(hierarchicalAABBMax, worldPos);
-                    }
-                }
+                transformAABB(cachedWorldMatrix, localAABBMin, localAABBMax, hierarchicalAABBMin, hierarchicalAABBMax);
             }
-        
-            // Recursively calculate children AABBs and include them
-            for (Transform* child : children)
+
+            for (const Transform* child : children)
             {
-                child->calculateHierarchicalAABB();
-                
                 // Include child AABB if it's valid
                 if (child->hierarchicalAABBMin.x <= child->hierarchicalAABBMax.x &&
                     child->hierarchicalAABBMin.y <= child->hierarchicalAABBMax.y &&
                     child->hierarchicalAABBMin.z <= child->hierarchicalAABBMax.z)
                 {
-                    if (!hasValidAABB)
-                    {
-                        hierarchicalAABBMin = child->hierarchicalAABBMin;
-                        hierarchicalAABBMax = child->hierarchicalAABBMax;
-                        hasValidAABB = true;
-                    }
-                    else
-                    {
-                        hierarchicalAABBMin = glm::min(hierarchicalAABBMin, child->hierarchicalAABBMin);
-                        hierarchicalAABBMax = glm::max(hierarchicalAABBMax, child->hierarchicalAABBMax);
-                    }
+                    hierarchicalAABBMin = glm::min(hierarchicalAABBMin, child->hierarchicalAABBMin);
+                    hierarchicalAABBMax = glm::max(hierarchicalAABBMax, child->hierarchicalAABBMax);
                 }
             }
-        
+
             // If no valid AABB was found, set a minimal one at world position
-            if (!hasValidAABB)
+            if (hierarchicalAABBMin.x > hierarchicalAABBMax.x)
             {
-                glm::vec3 worldPos = glm::vec3(worldMatrix[3]);
+                glm::vec3 worldPos = glm::vec3(cachedWorldMatrix[3]);
                 hierarchicalAABBMin = worldPos - glm::vec3(0.1f);
                 hierarchicalAABBMax = worldPos + glm::vec3(0.1f);
             }
+            boundsDirty = false;
         }
 
         glm::vec3 getWorldAABBMin() const
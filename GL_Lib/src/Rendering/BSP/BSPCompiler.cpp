@@ -0,0 +1,291 @@
+#include "BSPCompiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include "Importer/Model.h"
+
+namespace gllib
+{
+    namespace
+    {
+        const char FileMagic[4] = {'G', 'B', 'S', 'P'};
+        const unsigned int FileVersion = 1;
+
+        struct Polygon
+        {
+            std::vector<glm::vec3> points;
+            BSPPlane plane; // Plane of the source triangle, kept by the pieces when it is split
+        };
+
+        enum class PolygonSide
+        {
+            Front,
+            Back,
+            Coplanar,
+            Spanning
+        };
+
+        PolygonSide classifyPolygon(const Polygon& polygon, const BSPPlane& plane, float epsilon)
+        {
+            bool hasFront = false;
+            bool hasBack = false;
+            for (const glm::vec3& point : polygon.points)
+            {
+                const float distance = plane.distanceToPoint(point);
+                if (distance > epsilon) hasFront = true;
+                else if (distance < -epsilon) hasBack = true;
+            }
+
+            if (hasFront && hasBack) return PolygonSide::Spanning;
+            if (hasFront) return PolygonSide::Front;
+            if (hasBack) return PolygonSide::Back;
+            return PolygonSide::Coplanar;
+        }
+
+        // Clips a convex polygon on both sides of the plane, points on the plane go to both pieces
+        void splitPolygon(const Polygon& polygon, const BSPPlane& plane, float epsilon, Polygon& front, Polygon& back)
+        {
+            front.plane = polygon.plane;
+            back.plane = polygon.plane;
+
+            const size_t count = polygon.points.size();
+            for (size_t i = 0; i < count; i++)
+            {
+                const glm::vec3& a = polygon.points[i];
+                const glm::vec3& b = polygon.points[(i + 1) % count];
+                const float distanceA = plane.distanceToPoint(a);
+                const float distanceB = plane.distanceToPoint(b);
+
+                if (distanceA >= -epsilon) front.points.push_back(a);
+                if (distanceA <= epsilon) back.points.push_back(a);
+
+                if ((distanceA > epsilon && distanceB < -epsilon) || (distanceA < -epsilon && distanceB > epsilon))
+                {
+                    const glm::vec3 crossing = a + (b - a) * (distanceA / (distanceA - distanceB));
+                    front.points.push_back(crossing);
+                    back.points.push_back(crossing);
+                }
+            }
+        }
+
+        bool samePlane(const BSPPlane& a, const BSPPlane& b, float epsilon)
+        {
+            return glm::dot(a.normal, b.normal) > 0.9999f && std::fabs(a.distance - b.distance) <= epsilon;
+        }
+
+        /// <summary>
+        /// Plane with the lowest split and balance cost among an even sample of the polygons' planes
+        /// </summary>
+        size_t chooseSplitter(const std::vector<Polygon>& polygons, const BSPCompilerSettings& settings)
+        {
+            const size_t step = std::max<size_t>(1, polygons.size() / std::max<size_t>(1, settings.maxCandidates));
+
+            std::vector<BSPPlane> tried;
+            size_t best = 0;
+            float bestCost = std::numeric_limits<float>::max();
+            for (size_t candidate = 0; candidate < polygons.size(); candidate += step)
+            {
+                const BSPPlane& plane = polygons[candidate].plane;
+                bool alreadyTried = false;
+                for (const BSPPlane& other : tried)
+                    alreadyTried = alreadyTried || samePlane(plane, other, settings.planeEpsilon);
+                if (alreadyTried) continue;
+                tried.push_back(plane);
+
+                int front = 0, back = 0, splits = 0;
+                for (const Polygon& polygon : polygons)
+                {
+                    switch (classifyPolygon(polygon, plane, settings.planeEpsilon))
+                    {
+                    case PolygonSide::Front: front++; break;
+                    case PolygonSide::Back: back++; break;
+                    case PolygonSide::Spanning: front++; back++; splits++; break;
+                    default: break;
+                    }
+                }
+
+                const float cost = settings.splitWeight * splits + settings.balanceWeight * std::abs(front - back);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    best = candidate;
+                }
+            }
+            return best;
+        }
+
+        std::unique_ptr<BSPNode> compileNode(const std::vector<Polygon>& polygons, const BSPCompilerSettings& settings,
+                                             int depth)
+        {
+            if (polygons.empty() || depth >= BSPNode::MaxDepth)
+                return std::make_unique<BSPNode>();
+
+            // Left unbounded: the box around the coplanar polygons covers the doorways between them, so as a wall
+            // it would hide what is seen through them
+            const BSPPlane splitter = polygons[chooseSplitter(polygons, settings)].plane;
+
+            std::vector<Polygon> frontPolygons;
+            std::vector<Polygon> backPolygons;
+            for (const Polygon& polygon : polygons)
+            {
+                switch (classifyPolygon(polygon, splitter, settings.planeEpsilon))
+                {
+                case PolygonSide::Front:
+                    frontPolygons.push_back(polygon);
+                    break;
+                case PolygonSide::Back:
+                    backPolygons.push_back(polygon);
+                    break;
+                case PolygonSide::Spanning:
+                {
+                    Polygon front, back;
+                    splitPolygon(polygon, splitter, settings.planeEpsilon, front, back);
+                    if (front.points.size() >= 3) frontPolygons.push_back(std::move(front));
+                    if (back.points.size() >= 3) backPolygons.push_back(std::move(back));
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            std::unique_ptr<BSPNode> node = std::make_unique<BSPNode>(splitter);
+            node->frontChild = compileNode(frontPolygons, settings, depth + 1);
+            node->backChild = compileNode(backPolygons, settings, depth + 1);
+            return node;
+        }
+
+        void collectPolygons(Model* model, std::vector<Polygon>& polygons)
+        {
+            model->updateHierarchy();
+            for (const Mesh& mesh : model->meshes)
+            {
+                const Transform* node = model->getNodeTransform(mesh.nodeIndex);
+                const Transform* transform = node ? node : &model->transform;
+                const glm::mat4 world = transform->getTransformMatrix();
+
+                for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+                {
+                    Polygon polygon;
+                    for (size_t corner = 0; corner < 3; corner++)
+                    {
+                        const glm::vec3& local = mesh.vertices[mesh.indices[i + corner]].Position;
+                        polygon.points.push_back(glm::vec3(world * glm::vec4(local, 1.0f)));
+                    }
+
+                    const glm::vec3 normal = glm::cross(polygon.points[1] - polygon.points[0],
+                                                        polygon.points[2] - polygon.points[0]);
+                    const float length = glm::length(normal);
+                    if (length <= std::numeric_limits<float>::epsilon()) continue; // Degenerate triangle
+
+                    polygon.plane.normal = normal / length;
+                    polygon.plane.distance = -glm::dot(polygon.plane.normal, polygon.points[0]);
+                    polygons.push_back(std::move(polygon));
+                }
+            }
+        }
+
+        template <typename T>
+        void writeValue(std::ofstream& file, const T& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        bool readValue(std::ifstream& file, T& value)
+        {
+            return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+        }
+
+        // Preorder, one flag byte per node and the plane of split nodes, whose two children always follow
+        void writeNode(std::ofstream& file, const BSPNode& node)
+        {
+            const unsigned char hasPlane = node.hasPlane && node.frontChild && node.backChild ? 1 : 0;
+            writeValue(file, hasPlane);
+            if (!hasPlane) return;
+
+            writeValue(file, node.plane.normal);
+            writeValue(file, node.plane.distance);
+            writeValue(file, node.plane.boundsMin);
+            writeValue(file, node.plane.boundsMax);
+            writeNode(file, *node.frontChild);
+            writeNode(file, *node.backChild);
+        }
+
+        std::unique_ptr<BSPNode> readNode(std::ifstream& file, int depth)
+        {
+            unsigned char hasPlane = 0;
+            if (!readValue(file, hasPlane) || depth > BSPNode::MaxDepth) return nullptr;
+            if (!hasPlane) return std::make_unique<BSPNode>();
+
+            BSPPlane plane;
+            if (!readValue(file, plane.normal) || !readValue(file, plane.distance) ||
+                !readValue(file, plane.boundsMin) || !readValue(file, plane.boundsMax))
+                return nullptr;
+
+            std::unique_ptr<BSPNode> node = std::make_unique<BSPNode>(plane);
+            node->frontChild = readNode(file, depth + 1);
+            if (!node->frontChild) return nullptr;
+            node->backChild = readNode(file, depth + 1);
+            if (!node->backChild) return nullptr;
+            return node;
+        }
+    }
+
+    std::unique_ptr<BSPNode> BSPCompiler::compile(const std::vector<Model*>& levelModels,
+                                                  const BSPCompilerSettings& settings)
+    {
+        std::vector<Polygon> polygons;
+        for (Model* model : levelModels)
+        {
+            if (model) collectPolygons(model, polygons);
+        }
+
+        std::unique_ptr<BSPNode> root = compileNode(polygons, settings, 0);
+        std::cout << "BSP compiled from " << polygons.size() << " triangles into " << root->countNodes()
+            << " nodes\n";
+        return root;
+    }
+
+    bool BSPCompiler::save(const std::string& path, const BSPNode& root)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cout << "Couldn't write BSP file " << path << std::endl;
+            return false;
+        }
+
+        file.write(FileMagic, sizeof(FileMagic));
+        writeValue(file, FileVersion);
+        writeNode(file, root);
+        return static_cast<bool>(file);
+    }
+
+    std::unique_ptr<BSPNode> BSPCompiler::load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cout << "Couldn't open BSP file " << path << std::endl;
+            return nullptr;
+        }
+
+        char magic[4] = {};
+        unsigned int version = 0;
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, FileMagic, sizeof(magic)) != 0 ||
+            !readValue(file, version) || version != FileVersion)
+        {
+            std::cout << "Not a BSP file of version " << FileVersion << ": " << path << std::endl;
+            return nullptr;
+        }
+
+        std::unique_ptr<BSPNode> root = readNode(file, 0);
+        if (!root)
+            std::cout << "BSP file is truncated: " << path << std::endl;
+        return root;
+    }
+}
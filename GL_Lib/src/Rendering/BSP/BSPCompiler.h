@@ -0,0 +1,39 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "BSPNode.h"
+
+namespace gllib
+{
+    class Model;
+
+    struct DLLExport BSPCompilerSettings
+    {
+        float splitWeight = 8.0f; // Cost of every polygon a candidate plane cuts in two
+        float balanceWeight = 1.0f; // Cost of every polygon of difference between the front and back sides
+        size_t maxCandidates = 32; // Planes tried per node, spread evenly over the node's polygons
+        float planeEpsilon = 0.01f; // Distance under which a point counts as on the plane
+    };
+
+    /// <summary>
+    /// Fully static class. Builds a BSP tree offline from the triangles of static level models, trying a set of
+    /// their planes at every node and splitting with the cheapest one. Trees can be saved as a small binary file
+    /// and loaded by the game instead of being compiled at startup.
+    /// </summary>
+    class DLLExport BSPCompiler
+    {
+    public:
+        /// <summary>
+        /// Uses the models where they are now, the tree does not follow them if they move afterwards
+        /// </summary>
+        static std::unique_ptr<BSPNode> compile(const std::vector<Model*>& levelModels,
+                                                const BSPCompilerSettings& settings = BSPCompilerSettings());
+
+        static bool save(const std::string& path, const BSPNode& root);
+        /// <summary>
+        /// Returns nullptr when the file is missing or not a BSP file of this version
+        /// </summary>
+        static std::unique_ptr<BSPNode> load(const std::string& path);
+    };
+}
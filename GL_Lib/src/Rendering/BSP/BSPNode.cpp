@@ -1,26 +1,170 @@
 #include "BSPNode.h"
+#include <algorithm>
+#include <limits>
 #include "Importer/Model.h"
 #include "Rendering/Frustum.h"
+#include "Rendering/RenderStats.h"
 #include "Rendering/Camera/Camera.h"
 
 namespace gllib {
 
+    std::unique_ptr<BSPNode> BSPNode::build(const std::vector<BSPPlane>& planes, int depth) {
+        if (planes.empty() || depth >= MaxDepth)
+            return std::make_unique<BSPNode>();
+
+        std::unique_ptr<BSPNode> node = std::make_unique<BSPNode>(planes.front());
+
+        std::vector<BSPPlane> frontPlanes;
+        std::vector<BSPPlane> backPlanes;
+        for (size_t i = 1; i < planes.size(); i++) {
+            const BSPPlane& p = planes[i];
+            // The same wall added twice splits nothing
+            if (p.normal == node->plane.normal && p.distance == node->plane.distance)
+                continue;
+
+            const Side side = classifyPlane(node->plane, p);
+            if (side != Side::Back) frontPlanes.push_back(p);
+            if (side != Side::Front) backPlanes.push_back(p);
+        }
+
+        node->frontChild = build(frontPlanes, depth + 1);
+        node->backChild = build(backPlanes, depth + 1);
+        return node;
+    }
+
+    BSPNode::Side BSPNode::classifyAABB(const BSPPlane& plane, const glm::vec3& min, const glm::vec3& max) {
+        // Same rule as isPointInFront on the corners: front when every corner is at >= 0, back when all are < 0
+        const glm::vec3 center = (min + max) * 0.5f;
+        const glm::vec3 extents = (max - min) * 0.5f;
+        const float distance = plane.distanceToPoint(center);
+        const float radius = glm::dot(glm::abs(plane.normal), extents);
+
+        if (distance - radius >= 0.0f) return Side::Front;
+        if (distance + radius < 0.0f) return Side::Back;
+        return Side::Straddling;
+    }
+
+    BSPNode::Side BSPNode::classifyPlane(const BSPPlane& splitter, const BSPPlane& plane) {
+        if (plane.hasBounds())
+            return classifyAABB(splitter, plane.boundsMin, plane.boundsMax);
+
+        // An infinite plane only stays on one side of a splitter it is parallel to
+        if (glm::abs(glm::dot(splitter.normal, plane.normal)) < 1.0f - 1e-5f)
+            return Side::Straddling;
+        const glm::vec3 pointOnPlane = -plane.normal * plane.distance;
+        return splitter.isPointInFront(pointOnPlane) ? Side::Front : Side::Back;
+    }
+
+    bool BSPNode::isHiddenByWall(const BSPPlane& wall, const glm::vec3& cameraPos, const glm::vec3& min,
+                                 const glm::vec3& max) {
+        if (!wall.hasBounds())
+            return false;
+
+        // The box projects to the hull of its corners, so it is hidden when every corner is behind the plane
+        // and seen through the wall. Slack covers walls whose bounds are flat along the normal.
+        const float cameraDistance = wall.distanceToPoint(cameraPos);
+        const glm::vec3 slack(0.01f);
+        for (int i = 0; i < 8; i++) {
+            const glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+            const float cornerDistance = wall.distanceToPoint(corner);
+            if (cameraDistance * cornerDistance >= 0.0f)
+                return false;
+
+            const glm::vec3 hit = cameraPos + (corner - cameraPos) * (cameraDistance / (cameraDistance - cornerDistance));
+            if (glm::any(glm::lessThan(hit, wall.boundsMin - slack)) ||
+                glm::any(glm::greaterThan(hit, wall.boundsMax + slack)))
+                return false;
+        }
+        return true;
+    }
+
     void BSPNode::addModel(Model* model) {
         if (model) models.push_back(model);
     }
 
-    void BSPNode::collectVisibleModels(const glm::vec3&,const Frustum& frustum, std::vector<Model*>& out)
+    BSPNode* BSPNode::insertModel(Model* model, const glm::vec3& min, const glm::vec3& max) {
+        if (!hasPlane) {
+            addModel(model);
+            return this;
+        }
+
+        switch (classifyAABB(plane, min, max)) {
+        case Side::Front:
+            return frontChild->insertModel(model, min, max);
+        case Side::Back:
+            return backChild->insertModel(model, min, max);
+        default:
+            addModel(model);
+            return this;
+        }
+    }
+
+    void BSPNode::removeModel(Model* model) {
+        models.erase(std::remove(models.begin(), models.end(), model), models.end());
+    }
+
+    void BSPNode::refitBounds() {
+        subtreeModelCount = 0;
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(-std::numeric_limits<float>::max());
+
+        for (Model* m : models) {
+            min = glm::min(min, m->transform.getWorldAABBMin());
+            max = glm::max(max, m->transform.getWorldAABBMax());
+            subtreeModelCount++;
+        }
+
+        for (BSPNode* child : {frontChild.get(), backChild.get()}) {
+            if (!child) continue;
+            child->refitBounds();
+            if (child->subtreeModelCount == 0) continue;
+            min = glm::min(min, child->boundsMin);
+            max = glm::max(max, child->boundsMax);
+            subtreeModelCount += child->subtreeModelCount;
+        }
+
+        boundsMin = subtreeModelCount > 0 ? min : glm::vec3(0.0f);
+        boundsMax = subtreeModelCount > 0 ? max : glm::vec3(0.0f);
+    }
+
+    size_t BSPNode::countNodes() const {
+        size_t count = 1;
+        if (frontChild) count += frontChild->countNodes();
+        if (backChild) count += backChild->countNodes();
+        return count;
+    }
+
+    void BSPNode::collectVisibleModels(const glm::vec3& cameraPos, const Frustum& frustum, unsigned int planeMask,
+                                       bool cullOppositeSide, std::vector<BSPVisibleModel>& out) const
     {
-        if (isLeaf()) {
-            for (Model* m : models) {
-                if (!m) continue;
-                const glm::vec3 mn = m->transform.getWorldAABBMin();
-                const glm::vec3 mx = m->transform.getWorldAABBMax();
-                if (frustum.isAABBInside(mn, mx)) out.push_back(m);
-            }
+        if (subtreeModelCount == 0) return;
+
+        if (planeMask != 0 && frustum.classifyAABB(boundsMin, boundsMax, planeMask) == Frustum::Containment::Outside) {
+            RenderStats::countModelTested(subtreeModelCount);
+            RenderStats::countModelFrustumCulled(subtreeModelCount);
+            return;
+        }
+
+        if (!hasPlane) {
+            for (Model* m : models) out.push_back({m, nullptr, planeMask});
+            return;
+        }
+
+        const bool cameraInFront = plane.isPointInFront(cameraPos);
+        const BSPNode* nearChild = cameraInFront ? frontChild.get() : backChild.get();
+        const BSPNode* farChild = cameraInFront ? backChild.get() : frontChild.get();
+
+        if (nearChild) nearChild->collectVisibleModels(cameraPos, frustum, planeMask, cullOppositeSide, out);
+
+        // Models crossing the plane draw the parts on the camera side when the far side is culled
+        for (Model* m : models) out.push_back({m, cullOppositeSide ? &plane : nullptr, planeMask});
+
+        if (!farChild || farChild->subtreeModelCount == 0) return;
+        if (cullOppositeSide && isHiddenByWall(plane, cameraPos, farChild->boundsMin, farChild->boundsMax)) {
+            RenderStats::countModelTested(farChild->subtreeModelCount);
+            RenderStats::countModelBSPCulled(farChild->subtreeModelCount);
             return;
         }
-        if (frontChild) frontChild->collectVisibleModels({}, frustum, out);
-        if (backChild)  backChild ->collectVisibleModels({}, frustum, out);
+        farChild->collectVisibleModels(cameraPos, frustum, planeMask, cullOppositeSide, out);
     }
-} 
+}
@@ -10,6 +10,10 @@ namespace gllib {
     struct DLLExport BSPPlane {
         glm::vec3 normal {0,0,1};
         float distance = 0.0f;
+        // World bounds of the wall the plane comes from, used to place it in the tree and to tell what the wall
+        // hides. Equal bounds mean an unbounded plane, BSPSystem only builds from bounded ones.
+        glm::vec3 boundsMin {0,0,0};
+        glm::vec3 boundsMax {0,0,0};
 
         float distanceToPoint(const glm::vec3& p) const {
             return glm::dot(normal, p) + distance;
@@ -18,27 +22,86 @@ namespace gllib {
         bool isPointInFront(const glm::vec3& p) const {
             return distanceToPoint(p) >= 0.0f;
         }
+
+        bool hasBounds() const {
+            return boundsMin != boundsMax;
+        }
     };
 
     class Model;
     class Camera;
 
+    /// <summary>
+    /// A model reached by the traversal. splitPlane is the plane it straddles (nullptr when it sits in a leaf),
+    /// planeMask the frustum planes its node was not fully inside of, 0 means it needs no frustum test.
+    /// </summary>
+    struct DLLExport BSPVisibleModel {
+        Model* model;
+        const BSPPlane* splitPlane;
+        unsigned int planeMask;
+    };
+
     class DLLExport BSPNode {
     public:
+        enum class Side {
+            Front,
+            Back,
+            Straddling
+        };
+
+        static constexpr int MaxDepth = 32;
+
         BSPPlane plane;
+        bool hasPlane = false;
         std::unique_ptr<BSPNode> frontChild;
         std::unique_ptr<BSPNode> backChild;
 
+        // Leaves hold the models fully inside their region, split nodes the ones crossing their plane
         std::vector<Model*> models;
 
+        // Bounds of every model in the subtree, kept by refitBounds
+        glm::vec3 boundsMin {0,0,0};
+        glm::vec3 boundsMax {0,0,0};
+        unsigned int subtreeModelCount = 0;
+
         BSPNode() = default;
-        explicit BSPNode(const BSPPlane& p) : plane(p) {}
+        explicit BSPNode(const BSPPlane& p) : plane(p), hasPlane(true) {}
 
         bool isLeaf() const { return !frontChild && !backChild; }
 
+        /// <summary>
+        /// Each node splits with the first plane of its set, the rest go to the side their bounds are on
+        /// (both when they cross it). Split nodes always get two children, leaves have no plane.
+        /// </summary>
+        static std::unique_ptr<BSPNode> build(const std::vector<BSPPlane>& planes, int depth = 0);
+        static Side classifyAABB(const BSPPlane& plane, const glm::vec3& min, const glm::vec3& max);
+        /// <summary>
+        /// Side of the splitter a plane is on: its bounds when it has them, otherwise a parallel plane is on one
+        /// side and any other crosses it
+        /// </summary>
+        static Side classifyPlane(const BSPPlane& splitter, const BSPPlane& plane);
+        /// <summary>
+        /// True when every line of sight from the camera to the box goes through the wall's bounds. Unbounded
+        /// planes hide nothing.
+        /// </summary>
+        static bool isHiddenByWall(const BSPPlane& wall, const glm::vec3& cameraPos, const glm::vec3& min,
+                                   const glm::vec3& max);
+
         void addModel(Model* model);
+        /// <summary>
+        /// Walks down while the box is fully on one side, returns the node that keeps the model
+        /// </summary>
+        BSPNode* insertModel(Model* model, const glm::vec3& min, const glm::vec3& max);
+        void removeModel(Model* model);
+        void refitBounds();
+        size_t countNodes() const;
 
-        void collectVisibleModels(const glm::vec3& cameraPos,const Frustum&   frustum,std::vector<Model*>& out);
+        /// <summary>
+        /// Front to back from the camera: near side, models on the plane, far side. Nodes outside the frustum are
+        /// skipped whole, with cullOppositeSide a far side the wall fully hides is skipped too.
+        /// </summary>
+        void collectVisibleModels(const glm::vec3& cameraPos, const Frustum& frustum, unsigned int planeMask,
+                                  bool cullOppositeSide, std::vector<BSPVisibleModel>& out) const;
     };
 
 }
@@ -1,8 +1,13 @@
 #include "BSPSystem.h"
 #include <algorithm>
+#include <iostream>
+#include "Core/Profiler.h"
 #include "Importer/Model.h"
 #include "Rendering/Frustum.h"
+#include "Rendering/GpuProfiler.h"
+#include "Rendering/RenderStats.h"
 #include "Rendering/Camera/Camera.h"
+#include "Rendering/DebugDraw.h"
 
 namespace gllib
 {
@@ -15,20 +20,42 @@ namespace gllib
     {
         if (!model) return;
         models_.push_back(model);
+        placements_.push_back(ModelPlacement());
     }
 
     void BSPSystem::removeModel(Model* model)
     {
         if (!model) return;
-        std::vector<Model*>::iterator it = std::remove(models_.begin(), models_.end(), model);
-        models_.erase(it, models_.end());
+        for (size_t i = 0; i < models_.size();)
+        {
+            if (models_[i] != model)
+            {
+                i++;
+                continue;
+            }
+
+            if (placements_[i].node) placements_[i].node->removeModel(model);
+            models_.erase(models_.begin() + i);
+            placements_.erase(placements_.begin() + i);
+            boundsDirty_ = true;
+        }
     }
 
     void BSPSystem::buildBSP(const std::vector<BSPPlane>& planes)
     {
-        if (!planes.empty())
+        std::vector<BSPPlane> boundedPlanes;
+        boundedPlanes.reserve(planes.size());
+        for (const BSPPlane& plane : planes)
         {
-            activePlane_ = planes.front();
+            if (plane.hasBounds())
+                boundedPlanes.push_back(plane);
+        }
+        if (boundedPlanes.size() != planes.size())
+            std::cout << planes.size() - boundedPlanes.size() << " BSP planes without bounds ignored" << std::endl;
+
+        if (!boundedPlanes.empty())
+        {
+            activePlane_ = boundedPlanes.front();
             hasActivePlane_ = true;
         }
         else
@@ -36,9 +63,73 @@ namespace gllib
             hasActivePlane_ = false;
         }
 
-        root_ = std::make_unique<BSPNode>(hasActivePlane_ ? activePlane_ : BSPPlane{});
-        root_->models.clear();
-        for (Model* m : models_) root_->addModel(m);
+        root_ = BSPNode::build(boundedPlanes);
+        for (ModelPlacement& placement : placements_)
+            placement.node = nullptr;
+        boundsDirty_ = true;
+    }
+
+    void BSPSystem::setTree(std::unique_ptr<BSPNode> root)
+    {
+        if (!root) return;
+
+        root_ = std::move(root);
+        hasActivePlane_ = root_->hasPlane;
+        if (hasActivePlane_) activePlane_ = root_->plane;
+        for (ModelPlacement& placement : placements_)
+            placement.node = nullptr;
+        boundsDirty_ = true;
+    }
+
+    void BSPSystem::compileBSP(const BSPCompilerSettings& settings)
+    {
+        std::vector<Model*> levelModels;
+        for (Model* model : models_)
+        {
+            if (model->isFromPlanesFolder()) levelModels.push_back(model);
+        }
+        setTree(BSPCompiler::compile(levelModels, settings));
+    }
+
+    bool BSPSystem::saveBSP(const std::string& path) const
+    {
+        return BSPCompiler::save(path, *root_);
+    }
+
+    bool BSPSystem::loadBSP(const std::string& path)
+    {
+        std::unique_ptr<BSPNode> root = BSPCompiler::load(path);
+        if (!root) return false;
+
+        setTree(std::move(root));
+        return true;
+    }
+
+    void BSPSystem::updatePlacements()
+    {
+        for (size_t i = 0; i < models_.size(); i++)
+        {
+            Model* model = models_[i];
+            model->updateHierarchy();
+
+            const glm::vec3 min = model->transform.getWorldAABBMin();
+            const glm::vec3 max = model->transform.getWorldAABBMax();
+            ModelPlacement& placement = placements_[i];
+            if (placement.node && placement.min == min && placement.max == max)
+                continue;
+
+            if (placement.node) placement.node->removeModel(model);
+            placement.node = root_->insertModel(model, min, max);
+            placement.min = min;
+            placement.max = max;
+            boundsDirty_ = true;
+        }
+
+        if (boundsDirty_)
+        {
+            root_->refitBounds();
+            boundsDirty_ = false;
+        }
     }
 
     bool BSPSystem::aabbFullyOpposite(const glm::vec3& wMin,const glm::vec3& wMax,const BSPPlane& plane,bool cameraInFront)
@@ -59,46 +150,72 @@ namespace gllib
 
     void BSPSystem::render(const Camera& camera)
     {
+        GLLIB_PROFILE_SCOPE("BSPSystem::render");
+        GLLIB_GPU_PROFILE_SCOPE("BSPSystem::render");
         Frustum frustum(camera.getProjectionMatrix() * camera.getViewMatrix());
 
-        bool cameraInFront = true;
-        if (hasActivePlane_)
+        updatePlacements();
+
+        const glm::vec3 cameraPos = camera.getPosition();
+        visibleModels_.clear();
+        root_->collectVisibleModels(cameraPos, frustum, Frustum::AllPlanesMask, cullOppositeSides_, visibleModels_);
+
+        // Models under nodes fully inside the frustum skip the test, the rest go through one batch
+        modelBoxes_.clear();
+        for (const BSPVisibleModel& visible : visibleModels_)
         {
-            const glm::vec3 camPos = camera.getPosition();
-            cameraInFront = activePlane_.isPointInFront(camPos);
+            if (visible.planeMask != 0)
+                modelBoxes_.addMinMax(visible.model->transform.getWorldAABBMin(),
+                                      visible.model->transform.getWorldAABBMax());
         }
+        FrustumCulling::cullAABBs(frustum, modelBoxes_, modelVisibility_);
 
-        for (Model* model : models_)
+        size_t boxIndex = 0;
+        for (const BSPVisibleModel& visible : visibleModels_)
         {
-            if (!model) continue;
-
-            model->transform.updateTRSAndAABB();
-
-            const glm::vec3 modelMin = model->transform.getWorldAABBMin();
-            const glm::vec3 modelMax = model->transform.getWorldAABBMax();
-
-            if (!frustum.isAABBInside(modelMin, modelMax)) continue;
-
-            if (hasActivePlane_ && aabbFullyOpposite(modelMin, modelMax, activePlane_, cameraInFront)) continue;
+            RenderStats::countModelTested();
+            if (visible.planeMask != 0 && !FrustumCulling::isVisible(modelVisibility_, boxIndex++))
+            {
+                RenderStats::countModelFrustumCulled();
+                continue;
+            }
 
-            model->drawFrustumAndBSP(frustum, hasActivePlane_ ? &activePlane_ : nullptr, camera.getPosition());
+            visible.model->drawFrustumAndBSP(frustum, visible.splitPlane, cameraPos);
         }
     }
 
-    void BSPSystem::renderDebug(const Camera& camera, bool drawAABB)
+    void BSPSystem::renderDebug(const Camera& camera, bool drawAABB, bool drawPlanes)
     {
         if (drawAABB)
         {
             for (Model* m : models_)
             {
                 if (!m) continue;
-                m->drawAllAABBsDebug(camera.getViewMatrix(), camera.getProjectionMatrix());
+                m->drawAllAABBsDebug();
+            }
+        }
+
+        if (drawPlanes)
+        {
+            // Centered under the camera so the part of the plane that matters is always in view
+            for (const BSPPlane& plane : planes_)
+            {
+                const bool isActive = hasActivePlane_ && plane.normal == activePlane_.normal &&
+                    plane.distance == activePlane_.distance;
+                DebugDraw::addPlane(plane, camera.getPosition(), 20.0f,
+                                    isActive ? glm::vec4(1.0f, 1.0f, 0.0f, 1.0f) : glm::vec4(1.0f, 0.5f, 0.0f, 1.0f));
             }
         }
     }
 
     void BSPSystem::addPlane(const BSPPlane& plane)
     {
+        // An infinite plane crosses every other splitter, each one would double it down the tree
+        if (!plane.hasBounds())
+        {
+            std::cout << "BSP plane without bounds ignored, planes need the bounds of their wall" << std::endl;
+            return;
+        }
         planes_.push_back(plane);
     }
 
@@ -115,7 +232,9 @@ namespace gllib
     void BSPSystem::clear()
     {
         models_.clear();
+        placements_.clear();
         root_ = std::make_unique<BSPNode>();
         hasActivePlane_ = false;
+        boundsDirty_ = true;
     }
-}
\ No newline at end of file
+}
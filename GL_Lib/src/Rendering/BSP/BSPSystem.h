@@ -1,7 +1,9 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include "BSPCompiler.h"
 #include "BSPNode.h"
+#include "Rendering/FrustumCulling.h"
 
 namespace gllib
 {
@@ -11,27 +13,73 @@ namespace gllib
     class DLLExport BSPSystem
     {
     private:
+        // Where each model sits in the tree and the bounds it was placed with, same index as models_
+        struct ModelPlacement
+        {
+            BSPNode* node = nullptr;
+            glm::vec3 min {0,0,0};
+            glm::vec3 max {0,0,0};
+        };
+
         std::vector<Model*> models_;
+        std::vector<ModelPlacement> placements_;
         std::unique_ptr<BSPNode> root_;
         std::vector<BSPPlane> planes_;
         BSPPlane activePlane_;
-        bool hasActivePlane_;
+        bool hasActivePlane_ = false;
+        bool cullOppositeSides_ = false;
+        bool boundsDirty_ = true;
+        // Reused every render, models the traversal reached are culled in one batch
+        std::vector<BSPVisibleModel> visibleModels_;
+        CullingBoxes modelBoxes_;
+        std::vector<uint64_t> modelVisibility_;
 
-        bool aabbFullyOpposite(const glm::vec3& wMin, const glm::vec3& wMax, const BSPPlane& plane, bool cameraInFront);
+        void updatePlacements();
 
     public:
         BSPSystem();
 
+        /// <summary>
+        /// True when the whole box is on the side of the plane the camera is not on
+        /// </summary>
+        static bool aabbFullyOpposite(const glm::vec3& wMin, const glm::vec3& wMax, const BSPPlane& plane, bool cameraInFront);
+
         void addModel(Model* model);
         void removeModel(Model* model);
+        /// <summary>
+        /// Planes need the bounds of their wall, unbounded ones are ignored
+        /// </summary>
         void addPlane(const BSPPlane& plane);
         void clearPlanes();
         const std::vector<BSPPlane>& getPlanes() const { return planes_; }
 
+        /// <summary>
+        /// Builds the tree from every bounded plane, the first one is the root. Models are placed again on the next render,
+        /// after that only the ones whose bounds changed move.
+        /// </summary>
         void buildBSP(const std::vector<BSPPlane>& planes);
         void buildBSP(); // Build with current planes
+        /// <summary>
+        /// Off by default. On, what is on the far side of a plane and fully behind its wall from the camera is
+        /// skipped, the rest of the far side is still drawn front to back.
+        /// </summary>
+        void setCullOppositeSides(bool cull) { cullOppositeSides_ = cull; }
+
+        /// <summary>
+        /// Replaces the tree with a prebuilt one, models are placed again on the next render
+        /// </summary>
+        void setTree(std::unique_ptr<BSPNode> root);
+        /// <summary>
+        /// Compiles the tree from the registered models loaded from a planes folder (Model::isFromPlanesFolder).
+        /// Compiled planes are real level surfaces without wall bounds, so they hide nothing even with
+        /// setCullOppositeSides(true).
+        /// </summary>
+        void compileBSP(const BSPCompilerSettings& settings = BSPCompilerSettings());
+        bool saveBSP(const std::string& path) const;
+        bool loadBSP(const std::string& path);
+        size_t getNodeCount() const { return root_->countNodes(); }
         void render(const Camera& camera);
-        void renderDebug(const Camera& camera, bool drawAABB);
+        void renderDebug(const Camera& camera, bool drawAABB, bool drawPlanes = false);
         void clear();
     };
 }
@@ -0,0 +1,348 @@
+#include "DebugDraw.h"
+
+#include <cstddef>
+#include <iostream>
+
+#include "Rendering/BSP/BSPNode.h"
+#include "Rendering/GLStateCache.h"
+#include "Rendering/RenderStats.h"
+
+using namespace gllib;
+using namespace std;
+
+unsigned int DebugDraw::VAO = 0;
+unsigned int DebugDraw::VBO = 0;
+unsigned int DebugDraw::regionCapacity = 1 << 17;
+unsigned int DebugDraw::region = 0;
+unsigned int DebugDraw::vertexCount = 0;
+unsigned int DebugDraw::droppedVertices = 0;
+bool DebugDraw::dropReported = false;
+bool DebugDraw::missingProgramReported = false;
+bool DebugDraw::regionOpen = false;
+bool DebugDraw::enabled = true;
+
+DebugVertex* DebugDraw::mapped = nullptr;
+GLsync DebugDraw::fences[DebugDraw::regionCount] = {};
+vector<DebugVertex> DebugDraw::staging;
+
+unsigned int DebugDraw::program = 0;
+UniformHandle DebugDraw::mvpUniform;
+
+// Private
+
+bool DebugDraw::createBuffer()
+{
+    if (VAO != 0)
+        return true;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+
+    GLStateCache::bindVertexArray(VAO);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    const size_t size = sizeof(DebugVertex) * regionCapacity * regionCount;
+    if (GLAD_GL_ARB_buffer_storage)
+    {
+        // Coherent mapping, lines written this frame are visible to the draw without an explicit flush
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        RenderStats::countBufferAllocation();
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        mapped = static_cast<DebugVertex*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    }
+    if (!mapped)
+    {
+        RenderStats::countBufferAllocation();
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        staging.reserve(regionCapacity);
+    }
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, color));
+    glEnableVertexAttribArray(1);
+
+    cout << "Created debug draw buffer (" << regionCapacity << " vertices per frame, "
+        << (mapped ? "persistent" : "streamed") << ")" << endl;
+    return true;
+}
+
+void DebugDraw::openRegion()
+{
+    if (regionOpen)
+        return;
+
+    createBuffer();
+
+    // The region was last drawn regionCount frames ago, this only blocks if the GPU is that far behind
+    GLsync& fence = fences[region];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    vertexCount = 0;
+    droppedVertices = 0;
+    staging.clear();
+    regionOpen = true;
+}
+
+DebugVertex* DebugDraw::reserve(unsigned int count)
+{
+    openRegion();
+
+    if (vertexCount + count > regionCapacity)
+    {
+        droppedVertices += count;
+        return nullptr;
+    }
+
+    DebugVertex* out;
+    if (mapped)
+    {
+        out = mapped + static_cast<size_t>(region) * regionCapacity + vertexCount;
+    }
+    else
+    {
+        staging.resize(vertexCount + count);
+        out = &staging[vertexCount];
+    }
+    vertexCount += count;
+    return out;
+}
+
+void DebugDraw::writeLine(DebugVertex* out, const glm::vec3& a, const glm::vec3& b, const glm::vec4& color)
+{
+    out[0].position = a;
+    out[0].color = color;
+    out[1].position = b;
+    out[1].color = color;
+}
+
+void DebugDraw::addCorners(const glm::vec3 corners[8], const glm::vec4& color)
+{
+    // Corner i has x from bit 0, y from bit 1 and z from bit 2
+    static const unsigned int edges[12][2] = {
+        {0, 1}, {1, 5}, {5, 4}, {4, 0}, // Bottom face
+        {2, 3}, {3, 7}, {7, 6}, {6, 2}, // Top face
+        {0, 2}, {1, 3}, {5, 7}, {4, 6} // Vertical edges
+    };
+
+    DebugVertex* out = reserve(24);
+    if (!out)
+        return;
+
+    for (unsigned int i = 0; i < 12; i++)
+        writeLine(out + i * 2, corners[edges[i][0]], corners[edges[i][1]], color);
+}
+
+// Public
+
+void DebugDraw::setShaderProgram(const ShaderProgram& shaderProgram)
+{
+    program = shaderProgram;
+    mvpUniform = shaderProgram.getUniform("u_MVP");
+}
+
+void DebugDraw::setCapacity(unsigned int verticesPerFrame)
+{
+    if (VAO != 0)
+    {
+        cout << "Debug draw capacity can only change before the first line is added" << endl;
+        return;
+    }
+    regionCapacity = verticesPerFrame;
+}
+
+void DebugDraw::setEnabled(bool isEnabled)
+{
+    enabled = isEnabled;
+}
+
+bool DebugDraw::isEnabled()
+{
+    return enabled;
+}
+
+void DebugDraw::addLine(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color)
+{
+    if (!enabled)
+        return;
+
+    DebugVertex* out = reserve(2);
+    if (out)
+        writeLine(out, from, to, color);
+}
+
+void DebugDraw::addBox(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color)
+{
+    if (!enabled)
+        return;
+
+    glm::vec3 corners[8];
+    for (unsigned int i = 0; i < 8; i++)
+        corners[i] = glm::vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+    addCorners(corners, color);
+}
+
+void DebugDraw::addBox(const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform, const glm::vec4& color)
+{
+    if (!enabled)
+        return;
+
+    glm::vec3 corners[8];
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        const glm::vec4 local(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z, 1.0f);
+        corners[i] = glm::vec3(transform * local);
+    }
+    addCorners(corners, color);
+}
+
+void DebugDraw::addPlane(const glm::vec3& normal, float distance, const glm::vec3& center, float size,
+                         const glm::vec4& color)
+{
+    if (!enabled)
+        return;
+
+    const float length = glm::length(normal);
+    if (length <= 0.0f)
+        return;
+
+    const glm::vec3 n = normal / length;
+    const glm::vec3 origin = center - n * (glm::dot(n, center) + distance / length);
+
+    // Any vector not parallel to the normal gives the two axes of the square
+    const glm::vec3 helper = glm::abs(n.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    const glm::vec3 u = glm::normalize(glm::cross(helper, n)) * (size * 0.5f);
+    const glm::vec3 v = glm::cross(n, u);
+
+    const glm::vec3 a = origin - u - v;
+    const glm::vec3 b = origin + u - v;
+    const glm::vec3 c = origin + u + v;
+    const glm::vec3 d = origin - u + v;
+
+    DebugVertex* out = reserve(14);
+    if (!out)
+        return;
+
+    writeLine(out, a, b, color);
+    writeLine(out + 2, b, c, color);
+    writeLine(out + 4, c, d, color);
+    writeLine(out + 6, d, a, color);
+    writeLine(out + 8, a, c, color);
+    writeLine(out + 10, b, d, color);
+    writeLine(out + 12, origin, origin + n * (size * 0.25f), color);
+}
+
+void DebugDraw::addPlane(const BSPPlane& plane, const glm::vec3& center, float size, const glm::vec4& color)
+{
+    addPlane(plane.normal, plane.distance, center, size, color);
+}
+
+void DebugDraw::addFrustum(const glm::mat4& viewProjection, const glm::vec4& color)
+{
+    if (!enabled)
+        return;
+
+    const glm::mat4 inverse = glm::inverse(viewProjection);
+    glm::vec3 corners[8];
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        const glm::vec4 ndc(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+        const glm::vec4 world = inverse * ndc;
+        corners[i] = glm::vec3(world) / world.w;
+    }
+    addCorners(corners, color);
+}
+
+unsigned int DebugDraw::getVertexCount()
+{
+    return vertexCount;
+}
+
+void DebugDraw::flush(const glm::mat4& viewProjection)
+{
+    if (!regionOpen)
+        return;
+    regionOpen = false;
+
+    if (droppedVertices > 0)
+    {
+        // Every frame over capacity shows in the stats, the console only hears about the first one
+        RenderStats::countDebugVerticesDropped(droppedVertices);
+        if (!dropReported)
+        {
+            cout << "Debug draw dropped " << droppedVertices << " vertices, raise the capacity. Later drops are only "
+                "counted in RenderStats" << endl;
+            dropReported = true;
+        }
+    }
+
+    if (vertexCount == 0)
+        return;
+
+    if (program == 0)
+    {
+        if (!missingProgramReported)
+        {
+            cout << "Debug draw has no shader program, call DebugDraw::setShaderProgram" << endl;
+            missingProgramReported = true;
+        }
+        return;
+    }
+
+    const GLint first = static_cast<GLint>(region * regionCapacity);
+    if (!mapped)
+    {
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(DebugVertex) * first, sizeof(DebugVertex) * vertexCount,
+                        staging.data());
+    }
+
+    GLStateCache::useProgram(program);
+    ShaderProgram::setMat4(mvpUniform, viewProjection);
+    GLStateCache::bindVertexArray(VAO);
+    RenderStats::countDraw(0);
+    glDrawArrays(GL_LINES, first, vertexCount);
+
+    if (mapped)
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % regionCount;
+    vertexCount = 0;
+}
+
+void DebugDraw::destroy()
+{
+    if (VAO == 0)
+        return;
+
+    for (GLsync& fence : fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (mapped)
+    {
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mapped = nullptr;
+    }
+
+    GLStateCache::forgetBuffer(VBO);
+    GLStateCache::forgetVertexArray(VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+    VBO = 0;
+    VAO = 0;
+    region = 0;
+    vertexCount = 0;
+    regionOpen = false;
+    staging.clear();
+}
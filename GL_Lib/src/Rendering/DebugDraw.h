@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+
+#include "Core/deps.h"
+#include "glm.hpp"
+#include "Rendering/ShaderProgram.h"
+
+namespace gllib
+{
+    struct BSPPlane;
+
+    /// <summary>
+    /// Layout of the debug vertices, read by the solid color shader (aPosition, aColor)
+    /// </summary>
+    struct DLLExport DebugVertex
+    {
+        glm::vec3 position;
+        glm::vec4 color;
+    };
+
+    /// <summary>
+    /// Fully static class. Collects world space lines, boxes, planes and frustums during the frame straight
+    /// into a persistently mapped ring buffer and draws all of them with one glDrawArrays(GL_LINES) on flush.
+    /// Each frame writes its own region of the ring, a fence keeps it from overwriting lines the GPU still reads.
+    /// </summary>
+    class DLLExport DebugDraw
+    {
+    private:
+        static const unsigned int regionCount = 3;
+
+        static unsigned int VAO;
+        static unsigned int VBO;
+        static unsigned int regionCapacity;
+        static unsigned int region;
+        static unsigned int vertexCount;
+        static unsigned int droppedVertices;
+        static bool dropReported;
+        static bool missingProgramReported;
+        static bool regionOpen;
+        static bool enabled;
+
+        // Persistent path
+        static DebugVertex* mapped;
+        static GLsync fences[regionCount];
+        // Fallback when the driver has no buffer storage, uploaded on flush
+        static std::vector<DebugVertex> staging;
+
+        static unsigned int program;
+        static UniformHandle mvpUniform;
+
+        static bool createBuffer();
+        static void openRegion();
+        static DebugVertex* reserve(unsigned int count);
+        static void writeLine(DebugVertex* out, const glm::vec3& a, const glm::vec3& b, const glm::vec4& color);
+        static void addCorners(const glm::vec3 corners[8], const glm::vec4& color);
+
+    public:
+        /// <summary>
+        /// Program used to draw the lines, it needs the "u_MVP" uniform of the solid color shader
+        /// </summary>
+        static void setShaderProgram(const ShaderProgram& shaderProgram);
+        /// <summary>
+        /// Vertices each frame can hold, lines past it are dropped and counted in RenderStats.
+        /// Takes effect before the first line is added.
+        /// </summary>
+        static void setCapacity(unsigned int verticesPerFrame);
+        static void setEnabled(bool isEnabled);
+        static bool isEnabled();
+
+        static void addLine(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color);
+        static void addBox(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color);
+        /// <summary>
+        /// Local box moved by a transform, for oriented bounds
+        /// </summary>
+        static void addBox(const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform, const glm::vec4& color);
+        /// <summary>
+        /// Square of the given size on the plane, centered on the point of the plane closest to center, plus its normal
+        /// </summary>
+        static void addPlane(const glm::vec3& normal, float distance, const glm::vec3& center, float size,
+                             const glm::vec4& color);
+        static void addPlane(const BSPPlane& plane, const glm::vec3& center, float size, const glm::vec4& color);
+        /// <summary>
+        /// Edges of the volume a projection * view matrix sees
+        /// </summary>
+        static void addFrustum(const glm::mat4& viewProjection, const glm::vec4& color);
+
+        static unsigned int getVertexCount();
+
+        /// <summary>
+        /// Draws everything added since the last flush and moves on to the next region of the ring
+        /// </summary>
+        static void flush(const glm::mat4& viewProjection);
+        static void destroy();
+    };
+}
@@ -18,6 +18,15 @@ public:
         }
     };
 
+    enum class Containment
+    {
+        Outside,
+        Inside,
+        Intersecting
+    };
+
+    static constexpr unsigned int AllPlanesMask = 0x3F; // One bit per plane, in the planes order
+
 private:
     Plane planes[6]; // left, right, bottom, top, near, far
 
@@ -84,6 +93,42 @@ public:
         return true;
     }
 
+    /// <summary>
+    /// Tests the box against the planes set in planeMask and clears the ones it is fully in front of.
+    /// A box inside its parent's box can start from the parent's mask, once the mask is 0 nothing is left to test.
+    /// </summary>
+    Containment classifyAABB(const glm::vec3& minPoint, const glm::vec3& maxPoint, unsigned int& planeMask) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            const unsigned int planeBit = 1u << i;
+            if ((planeMask & planeBit) == 0)
+                continue;
+
+            // Positive vertex is the corner furthest along the normal, negative vertex the one furthest behind it
+            glm::vec3 positiveVertex = minPoint;
+            glm::vec3 negativeVertex = maxPoint;
+            if (planes[i].normal.x >= 0) { positiveVertex.x = maxPoint.x; negativeVertex.x = minPoint.x; }
+            if (planes[i].normal.y >= 0) { positiveVertex.y = maxPoint.y; negativeVertex.y = minPoint.y; }
+            if (planes[i].normal.z >= 0) { positiveVertex.z = maxPoint.z; negativeVertex.z = minPoint.z; }
+
+            if (planes[i].distanceToPoint(positiveVertex) < 0)
+                return Containment::Outside;
+
+            if (planes[i].distanceToPoint(negativeVertex) >= 0)
+                planeMask &= ~planeBit;
+        }
+        return planeMask == 0 ? Containment::Inside : Containment::Intersecting;
+    }
+
+    /// <summary>
+    /// Normalized plane, 0..5 in the order left, right, bottom, top, near, far
+    /// </summary>
+    const Plane& getPlane(int index) const
+    {
+        return planes[index];
+    }
+
     Frustum() = default;
     explicit Frustum(glm::mat<4, 4, float> mat)
     {
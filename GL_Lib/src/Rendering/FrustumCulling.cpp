@@ -0,0 +1,275 @@
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if !defined(GLLIB_CULLING_NO_SIMD) && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GLLIB_CULLING_SSE 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+// MSVC accepts AVX intrinsics in any function, GCC and Clang need them enabled per function
+#if defined(__GNUC__) || defined(__clang__)
+#define GLLIB_CULLING_AVX2_TARGET __attribute__((target("avx2,fma,popcnt")))
+#else
+#define GLLIB_CULLING_AVX2_TARGET
+#endif
+#endif
+
+using namespace gllib;
+using namespace std;
+
+namespace
+{
+    FrustumCulling::Path maxPath = FrustumCulling::Path::AVX2;
+
+    // Plane in the form the kernels use: outside when dot(normal, center) + distance + dot(|normal|, extents) < 0
+    struct CullPlane
+    {
+        float nx, ny, nz, d;
+        float ax, ay, az;
+    };
+
+    void toCullPlanes(const Frustum& frustum, CullPlane (&cullPlanes)[6])
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            const Frustum::Plane& plane = frustum.getPlane(i);
+            cullPlanes[i] = {plane.normal.x, plane.normal.y, plane.normal.z, plane.distance,
+                std::fabs(plane.normal.x), std::fabs(plane.normal.y), std::fabs(plane.normal.z)};
+        }
+    }
+
+    size_t cullScalar(const CullPlane (&planes)[6], const float* cx, const float* cy, const float* cz,
+                      const float* ex, const float* ey, const float* ez, size_t begin, size_t end, uint64_t* mask)
+    {
+        size_t visibleCount = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            bool visible = true;
+            for (const CullPlane& plane : planes)
+            {
+                const float distance = plane.nx * cx[i] + plane.ny * cy[i] + plane.nz * cz[i] + plane.d;
+                const float radius = plane.ax * ex[i] + plane.ay * ey[i] + plane.az * ez[i];
+                if (distance + radius < 0.0f)
+                {
+                    visible = false;
+                    break;
+                }
+            }
+
+            if (visible)
+            {
+                mask[i >> 6] |= 1ull << (i & 63);
+                visibleCount++;
+            }
+        }
+        return visibleCount;
+    }
+
+#if defined(GLLIB_CULLING_SSE)
+    size_t cullSSE(const CullPlane (&planes)[6], const float* cx, const float* cy, const float* cz,
+                   const float* ex, const float* ey, const float* ez, size_t count, uint64_t* mask)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        size_t visibleCount = 0;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 centerX = _mm_loadu_ps(cx + i);
+            const __m128 centerY = _mm_loadu_ps(cy + i);
+            const __m128 centerZ = _mm_loadu_ps(cz + i);
+            const __m128 extentX = _mm_loadu_ps(ex + i);
+            const __m128 extentY = _mm_loadu_ps(ey + i);
+            const __m128 extentZ = _mm_loadu_ps(ez + i);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const CullPlane& plane : planes)
+            {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.nx), centerX), _mm_set1_ps(plane.d));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.ny), centerY));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.nz), centerZ));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.ax), extentX));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.ay), extentY));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.az), extentZ));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+            }
+
+            // i is a multiple of 4, so the 4 bits never straddle two words
+            const uint64_t bits = static_cast<uint64_t>(_mm_movemask_ps(inside));
+            mask[i >> 6] |= bits << (i & 63);
+            visibleCount += static_cast<size_t>((bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + (bits >> 3));
+        }
+        return visibleCount + cullScalar(planes, cx, cy, cz, ex, ey, ez, i, count, mask);
+    }
+
+    GLLIB_CULLING_AVX2_TARGET
+    size_t cullAVX2(const CullPlane (&planes)[6], const float* cx, const float* cy, const float* cz,
+                    const float* ex, const float* ey, const float* ez, size_t count, uint64_t* mask)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        size_t visibleCount = 0;
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 centerX = _mm256_loadu_ps(cx + i);
+            const __m256 centerY = _mm256_loadu_ps(cy + i);
+            const __m256 centerZ = _mm256_loadu_ps(cz + i);
+            const __m256 extentX = _mm256_loadu_ps(ex + i);
+            const __m256 extentY = _mm256_loadu_ps(ey + i);
+            const __m256 extentZ = _mm256_loadu_ps(ez + i);
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const CullPlane& plane : planes)
+            {
+                __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.nx), centerX, _mm256_set1_ps(plane.d));
+                distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.ny), centerY, distance);
+                distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.nz), centerZ, distance);
+                distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.ax), extentX, distance);
+                distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.ay), extentY, distance);
+                distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.az), extentZ, distance);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+            }
+
+            const uint64_t bits = static_cast<uint64_t>(_mm256_movemask_ps(inside));
+            mask[i >> 6] |= bits << (i & 63);
+            visibleCount += static_cast<size_t>(_mm_popcnt_u32(static_cast<unsigned int>(bits)));
+        }
+        return visibleCount + cullScalar(planes, cx, cy, cz, ex, ey, ez, i, count, mask);
+    }
+
+    bool cpuHasAVX2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // AVX needs the OS to save the YMM registers (OSXSAVE and XCR0 bits 1-2)
+        __cpuid(info, 1);
+        const bool hasFMA = (info[2] & (1 << 12)) != 0;
+        const bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+        const bool hasAVX = (info[2] & (1 << 28)) != 0;
+        const bool hasPopcnt = (info[2] & (1 << 23)) != 0;
+        if (!hasFMA || !hasOSXSave || !hasAVX || !hasPopcnt || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+            __builtin_cpu_supports("popcnt");
+#endif
+    }
+#endif
+
+    FrustumCulling::Path detectPath()
+    {
+#if defined(GLLIB_CULLING_SSE)
+        return cpuHasAVX2() ? FrustumCulling::Path::AVX2 : FrustumCulling::Path::SSE;
+#else
+        return FrustumCulling::Path::Scalar;
+#endif
+    }
+}
+
+// CullingBoxes
+
+void CullingBoxes::add(const glm::vec3& center, const glm::vec3& extents)
+{
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extents.x);
+    extentY.push_back(extents.y);
+    extentZ.push_back(extents.z);
+}
+
+void CullingBoxes::addMinMax(const glm::vec3& minPoint, const glm::vec3& maxPoint)
+{
+    add((minPoint + maxPoint) * 0.5f, (maxPoint - minPoint) * 0.5f);
+}
+
+void CullingBoxes::reserve(size_t count)
+{
+    centerX.reserve(count);
+    centerY.reserve(count);
+    centerZ.reserve(count);
+    extentX.reserve(count);
+    extentY.reserve(count);
+    extentZ.reserve(count);
+}
+
+void CullingBoxes::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+// FrustumCulling
+
+size_t FrustumCulling::cullAABBs(const Frustum& frustum, const CullingBoxes& boxes, vector<uint64_t>& visibleMask)
+{
+    const size_t count = boxes.size();
+    visibleMask.resize((count + 63) / 64);
+    if (count == 0)
+        return 0;
+
+    return cullAABBs(frustum, boxes.centerX.data(), boxes.centerY.data(), boxes.centerZ.data(),
+                     boxes.extentX.data(), boxes.extentY.data(), boxes.extentZ.data(), count, visibleMask.data());
+}
+
+size_t FrustumCulling::cullAABBs(const Frustum& frustum, const float* centerX, const float* centerY,
+                                 const float* centerZ, const float* extentX, const float* extentY,
+                                 const float* extentZ, size_t count, uint64_t* visibleMask)
+{
+    fill(visibleMask, visibleMask + (count + 63) / 64, 0ull);
+
+    CullPlane planes[6];
+    toCullPlanes(frustum, planes);
+
+    const Path path = static_cast<Path>(min(static_cast<int>(getPath()), static_cast<int>(maxPath)));
+    switch (path)
+    {
+#if defined(GLLIB_CULLING_SSE)
+    case Path::AVX2:
+        return cullAVX2(planes, centerX, centerY, centerZ, extentX, extentY, extentZ, count, visibleMask);
+    case Path::SSE:
+        return cullSSE(planes, centerX, centerY, centerZ, extentX, extentY, extentZ, count, visibleMask);
+#endif
+    default:
+        return cullScalar(planes, centerX, centerY, centerZ, extentX, extentY, extentZ, 0, count, visibleMask);
+    }
+}
+
+FrustumCulling::Path FrustumCulling::getPath()
+{
+    static const Path detected = detectPath();
+    return detected;
+}
+
+void FrustumCulling::setMaxPath(Path path)
+{
+    maxPath = path;
+}
+
+const char* FrustumCulling::getPathName(Path path)
+{
+    switch (path)
+    {
+    case Path::AVX2:
+        return "AVX2";
+    case Path::SSE:
+        return "SSE";
+    default:
+        return "Scalar";
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Core/deps.h"
+#include "Rendering/Frustum.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// Bounding boxes as center and extents, one array per component so the culling kernel loads 4 or 8 boxes at once
+    /// </summary>
+    struct DLLExport CullingBoxes
+    {
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> extentX;
+        std::vector<float> extentY;
+        std::vector<float> extentZ;
+
+        void add(const glm::vec3& center, const glm::vec3& extents);
+        void addMinMax(const glm::vec3& minPoint, const glm::vec3& maxPoint);
+        void reserve(size_t count);
+        void clear();
+        size_t size() const { return centerX.size(); }
+    };
+
+    /// <summary>
+    /// Fully static class. Tests boxes against the six frustum planes in batches, AVX2 when the CPU has it,
+    /// SSE otherwise and scalar code on other targets or when GLLIB_CULLING_NO_SIMD is defined.
+    /// Results are bitmasks, bit i of word i / 64 is set when box i is at least partly inside.
+    /// </summary>
+    class DLLExport FrustumCulling
+    {
+    public:
+        enum class Path
+        {
+            Scalar,
+            SSE,
+            AVX2
+        };
+
+        /// <summary>
+        /// Returns how many boxes are visible. visibleMask is resized to hold count bits, unused high bits are 0.
+        /// </summary>
+        static size_t cullAABBs(const Frustum& frustum, const CullingBoxes& boxes, std::vector<uint64_t>& visibleMask);
+        static size_t cullAABBs(const Frustum& frustum, const float* centerX, const float* centerY,
+                                const float* centerZ, const float* extentX, const float* extentY,
+                                const float* extentZ, size_t count, uint64_t* visibleMask);
+
+        static bool isVisible(const std::vector<uint64_t>& visibleMask, size_t index)
+        {
+            return (visibleMask[index >> 6] >> (index & 63)) & 1ull;
+        }
+
+        /// <summary>
+        /// Best path of this build and CPU
+        /// </summary>
+        static Path getPath();
+        /// <summary>
+        /// Caps the path used, for comparing them. A path the CPU can't run falls back to the next one down.
+        /// </summary>
+        static void setMaxPath(Path path);
+        static const char* getPathName(Path path);
+    };
+}
@@ -0,0 +1,305 @@
+#include "GLStateCache.h"
+
+#include "RenderStats.h"
+
+using namespace gllib;
+using namespace std;
+
+unsigned int GLStateCache::program = GLStateCache::unknown;
+unsigned int GLStateCache::vertexArray = GLStateCache::unknown;
+unsigned int GLStateCache::activeUnit = GLStateCache::unknown;
+unsigned int GLStateCache::textures[GLStateCache::maxTextureUnits] = {
+    unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown,
+    unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown,
+    unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown,
+    unknown, unknown, unknown, unknown, unknown, unknown, unknown, unknown
+};
+unsigned int GLStateCache::arrayBuffer = GLStateCache::unknown;
+unsigned int GLStateCache::uniformBuffer = GLStateCache::unknown;
+unsigned int GLStateCache::indirectBuffer = GLStateCache::unknown;
+unordered_map<unsigned int, unsigned int> GLStateCache::elementBuffers;
+
+int GLStateCache::blend = -1;
+unsigned int GLStateCache::blendSrc = GLStateCache::unknown;
+unsigned int GLStateCache::blendDst = GLStateCache::unknown;
+int GLStateCache::depthTest = -1;
+unsigned int GLStateCache::depthFunc = GLStateCache::unknown;
+int GLStateCache::depthMask = -1;
+
+unsigned long long GLStateCache::issuedCalls = 0;
+unsigned long long GLStateCache::skippedCalls = 0;
+
+// Private
+
+bool GLStateCache::changed(unsigned int& cached, unsigned int value)
+{
+    if (cached == value)
+    {
+        skippedCalls++;
+        return false;
+    }
+    cached = value;
+    issuedCalls++;
+    return true;
+}
+
+bool GLStateCache::changed(int& cached, int value)
+{
+    if (cached == value)
+    {
+        skippedCalls++;
+        return false;
+    }
+    cached = value;
+    issuedCalls++;
+    return true;
+}
+
+unsigned int* GLStateCache::getBufferSlot(unsigned int target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        return &arrayBuffer;
+    case GL_UNIFORM_BUFFER:
+        return &uniformBuffer;
+    case GL_DRAW_INDIRECT_BUFFER:
+        return &indirectBuffer;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        if (vertexArray == unknown)
+            return nullptr;
+        {
+            // Unseen VAOs start with no element buffer, that is what a new VAO has
+            unordered_map<unsigned int, unsigned int>::iterator it = elementBuffers.find(vertexArray);
+            if (it == elementBuffers.end())
+                it = elementBuffers.emplace(vertexArray, unknown).first;
+            return &it->second;
+        }
+    default:
+        return nullptr;
+    }
+}
+
+// Public
+
+void GLStateCache::useProgram(unsigned int newProgram)
+{
+    if (!changed(program, newProgram))
+        return;
+    RenderStats::countProgramBind();
+    glUseProgram(newProgram);
+}
+
+void GLStateCache::bindVertexArray(unsigned int newVertexArray)
+{
+    if (!changed(vertexArray, newVertexArray))
+        return;
+    RenderStats::countVertexArrayBind();
+    glBindVertexArray(newVertexArray);
+}
+
+void GLStateCache::activeTexture(unsigned int unit)
+{
+    if (changed(activeUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLStateCache::bindTexture(unsigned int unit, unsigned int texture)
+{
+    if (unit >= maxTextureUnits)
+    {
+        activeTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        issuedCalls++;
+        RenderStats::countTextureBind();
+        return;
+    }
+
+    if (textures[unit] == texture)
+    {
+        skippedCalls++;
+        return;
+    }
+
+    activeTexture(unit);
+    changed(textures[unit], texture);
+    RenderStats::countTextureBind();
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLStateCache::bindTexture(unsigned int texture)
+{
+    if (activeUnit == unknown)
+        activeTexture(0);
+    bindTexture(activeUnit, texture);
+}
+
+void GLStateCache::bindBuffer(unsigned int target, unsigned int buffer)
+{
+    unsigned int* slot = getBufferSlot(target);
+    if (!slot)
+    {
+        glBindBuffer(target, buffer);
+        issuedCalls++;
+        return;
+    }
+
+    if (changed(*slot, buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLStateCache::bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer)
+{
+    // Indexed bindings are set up once, only the generic binding they also change is tracked
+    glBindBufferBase(target, index, buffer);
+    issuedCalls++;
+
+    unsigned int* slot = getBufferSlot(target);
+    if (slot)
+        *slot = buffer;
+}
+
+void GLStateCache::setBlend(bool enabled)
+{
+    if (!changed(blend, enabled ? 1 : 0))
+        return;
+    if (enabled)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+}
+
+void GLStateCache::setBlendFunc(unsigned int src, unsigned int dst)
+{
+    if (blendSrc == src && blendDst == dst)
+    {
+        skippedCalls++;
+        return;
+    }
+    blendSrc = src;
+    blendDst = dst;
+    issuedCalls++;
+    glBlendFunc(src, dst);
+}
+
+void GLStateCache::setDepthTest(bool enabled)
+{
+    if (!changed(depthTest, enabled ? 1 : 0))
+        return;
+    if (enabled)
+        glEnable(GL_DEPTH_TEST);
+    else
+        glDisable(GL_DEPTH_TEST);
+}
+
+void GLStateCache::setDepthFunc(unsigned int func)
+{
+    if (changed(depthFunc, func))
+        glDepthFunc(func);
+}
+
+void GLStateCache::setDepthMask(bool enabled)
+{
+    if (changed(depthMask, enabled ? 1 : 0))
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+unsigned int GLStateCache::getProgram()
+{
+    if (program == unknown)
+    {
+        GLint current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        program = static_cast<unsigned int>(current);
+    }
+    return program;
+}
+
+unsigned int GLStateCache::getVertexArray()
+{
+    if (vertexArray == unknown)
+    {
+        GLint current = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &current);
+        vertexArray = static_cast<unsigned int>(current);
+    }
+    return vertexArray;
+}
+
+void GLStateCache::forgetProgram(unsigned int deletedProgram)
+{
+    // A program deleted while in use stays bound until another one is used, so nothing changes in GL
+    // but the next use of a recycled name has to go through
+    if (program == deletedProgram)
+        program = unknown;
+}
+
+void GLStateCache::forgetVertexArray(unsigned int deletedVertexArray)
+{
+    elementBuffers.erase(deletedVertexArray);
+    if (vertexArray == deletedVertexArray)
+        vertexArray = 0;
+}
+
+void GLStateCache::forgetBuffer(unsigned int buffer)
+{
+    if (arrayBuffer == buffer)
+        arrayBuffer = 0;
+    if (uniformBuffer == buffer)
+        uniformBuffer = 0;
+    if (indirectBuffer == buffer)
+        indirectBuffer = 0;
+
+    // GL only detaches it from the bound VAO, the others keep referencing it
+    if (vertexArray != unknown)
+    {
+        unordered_map<unsigned int, unsigned int>::iterator it = elementBuffers.find(vertexArray);
+        if (it != elementBuffers.end() && it->second == buffer)
+            it->second = 0;
+    }
+}
+
+void GLStateCache::forgetTexture(unsigned int texture)
+{
+    for (unsigned int unit = 0; unit < maxTextureUnits; unit++)
+    {
+        if (textures[unit] == texture)
+            textures[unit] = 0;
+    }
+}
+
+void GLStateCache::invalidate()
+{
+    program = unknown;
+    vertexArray = unknown;
+    activeUnit = unknown;
+    for (unsigned int unit = 0; unit < maxTextureUnits; unit++)
+        textures[unit] = unknown;
+    arrayBuffer = unknown;
+    uniformBuffer = unknown;
+    indirectBuffer = unknown;
+    elementBuffers.clear();
+
+    blend = -1;
+    blendSrc = unknown;
+    blendDst = unknown;
+    depthTest = -1;
+    depthFunc = unknown;
+    depthMask = -1;
+}
+
+unsigned long long GLStateCache::getIssuedCalls()
+{
+    return issuedCalls;
+}
+
+unsigned long long GLStateCache::getSkippedCalls()
+{
+    return skippedCalls;
+}
+
+void GLStateCache::resetCounters()
+{
+    issuedCalls = 0;
+    skippedCalls = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <unordered_map>
+
+#include "Core/deps.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// Fully static class. Shadows the GL binding and capability state so calls that would not change
+    /// anything are never sent to the driver. Every bind in the library goes through here, code that calls
+    /// GL directly has to call invalidate() afterwards.
+    /// </summary>
+    class DLLExport GLStateCache
+    {
+    private:
+        static const unsigned int unknown = ~0u;
+        static const unsigned int maxTextureUnits = 32;
+
+        static unsigned int program;
+        static unsigned int vertexArray;
+        static unsigned int activeUnit;
+        static unsigned int textures[maxTextureUnits];
+        static unsigned int arrayBuffer;
+        static unsigned int uniformBuffer;
+        static unsigned int indirectBuffer;
+        // The element buffer binding belongs to the VAO, it is remembered per VAO
+        static std::unordered_map<unsigned int, unsigned int> elementBuffers;
+
+        static int blend;
+        static unsigned int blendSrc;
+        static unsigned int blendDst;
+        static int depthTest;
+        static unsigned int depthFunc;
+        static int depthMask;
+
+        static unsigned long long issuedCalls;
+        static unsigned long long skippedCalls;
+
+        static bool changed(unsigned int& cached, unsigned int value);
+        static bool changed(int& cached, int value);
+        static unsigned int* getBufferSlot(unsigned int target);
+
+    public:
+        static void useProgram(unsigned int program);
+        static void bindVertexArray(unsigned int vertexArray);
+        static void activeTexture(unsigned int unit);
+        /// <summary>
+        /// Binds a 2D texture on the given unit, switching the active unit only if the texture changes
+        /// </summary>
+        static void bindTexture(unsigned int unit, unsigned int texture);
+        /// <summary>
+        /// Binds a 2D texture on whatever unit is active
+        /// </summary>
+        static void bindTexture(unsigned int texture);
+        static void bindBuffer(unsigned int target, unsigned int buffer);
+        static void bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer);
+
+        static void setBlend(bool enabled);
+        static void setBlendFunc(unsigned int src, unsigned int dst);
+        static void setDepthTest(bool enabled);
+        static void setDepthFunc(unsigned int func);
+        static void setDepthMask(bool enabled);
+
+        static unsigned int getProgram();
+        static unsigned int getVertexArray();
+
+        // Deleting a bound object unbinds it in GL, the cache has to follow
+        static void forgetProgram(unsigned int program);
+        static void forgetVertexArray(unsigned int vertexArray);
+        static void forgetBuffer(unsigned int buffer);
+        static void forgetTexture(unsigned int texture);
+
+        /// <summary>
+        /// Marks all the state as unknown, the next call of each kind always reaches GL
+        /// </summary>
+        static void invalidate();
+
+        static unsigned long long getIssuedCalls();
+        static unsigned long long getSkippedCalls();
+        static void resetCounters();
+    };
+}
@@ -0,0 +1,379 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+#include "GLStateCache.h"
+#include "Importer/Mesh.h"
+#include "Rendering/RenderStats.h"
+
+using namespace gllib;
+using namespace std;
+
+GeometryArena::Pool GeometryArena::pools[VertexFormat_Count];
+unsigned int GeometryArena::maxVertices = 1 << 20;
+unsigned int GeometryArena::maxIndices = 3 << 20;
+
+// Smallest first pool, so a handful of small meshes don't grow it right away
+static const unsigned int minPoolVertices = 1 << 14;
+static const unsigned int minPoolIndices = 3 << 14;
+
+unsigned int GeometryArena::indirectBuffer = 0;
+unsigned int GeometryArena::drawMatrixBuffer = 0;
+size_t GeometryArena::indirectCapacity = 0;
+size_t GeometryArena::drawMatrixCapacity = 0;
+
+// Private
+
+unsigned int GeometryArena::getVertexStride(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat_Mesh:
+        return sizeof(Vertex);
+    default:
+        return 0;
+    }
+}
+
+void GeometryArena::createStorage(unsigned int target, size_t size)
+{
+    // Immutable storage lets the driver place the buffer once and for all, data goes in through glBufferSubData
+    RenderStats::countBufferAllocation();
+    if (GLAD_GL_ARB_buffer_storage)
+        glBufferStorage(target, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    else
+        glBufferData(target, size, nullptr, GL_STATIC_DRAW);
+}
+
+void GeometryArena::setUpVertexFormat(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat_Mesh:
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        break;
+    default:
+        break;
+    }
+}
+
+unsigned int GeometryArena::resizeBuffer(unsigned int buffer, size_t oldSize, size_t newSize)
+{
+    unsigned int resized;
+    glGenBuffers(1, &resized);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+    createStorage(GL_COPY_WRITE_BUFFER, newSize);
+
+    // Copied on the GPU, the old contents never come back to the CPU
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+    GLStateCache::forgetBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+    return resized;
+}
+
+bool GeometryArena::growVertices(VertexFormat format, unsigned int vertexCount)
+{
+    Pool& pool = pools[format];
+    const unsigned int capacity = min(maxVertices, max(pool.vertexCapacity * 2, pool.vertexCapacity + vertexCount));
+    if (capacity <= pool.vertexCapacity)
+        return false;
+
+    pool.VBO = resizeBuffer(pool.VBO, static_cast<size_t>(pool.vertexCapacity) * pool.vertexStride,
+                            static_cast<size_t>(capacity) * pool.vertexStride);
+
+    // Same VAO, its attributes now read from the new buffer
+    GLStateCache::bindVertexArray(pool.VAO);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    setUpVertexFormat(format);
+
+    returnSpan(pool.freeVertices, pool.vertexCapacity, capacity - pool.vertexCapacity);
+    pool.vertexCapacity = capacity;
+    cout << "Grew geometry pool " << format << " to " << capacity << " vertices" << endl;
+    return true;
+}
+
+bool GeometryArena::growIndices(VertexFormat format, unsigned int indexCount)
+{
+    Pool& pool = pools[format];
+    const unsigned int capacity = min(maxIndices, max(pool.indexCapacity * 2, pool.indexCapacity + indexCount));
+    if (capacity <= pool.indexCapacity)
+        return false;
+
+    pool.EBO = resizeBuffer(pool.EBO, static_cast<size_t>(pool.indexCapacity) * sizeof(unsigned int),
+                            static_cast<size_t>(capacity) * sizeof(unsigned int));
+
+    GLStateCache::bindVertexArray(pool.VAO);
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+
+    returnSpan(pool.freeIndices, pool.indexCapacity, capacity - pool.indexCapacity);
+    pool.indexCapacity = capacity;
+    cout << "Grew geometry pool " << format << " to " << capacity << " indices" << endl;
+    return true;
+}
+
+bool GeometryArena::takeSpan(vector<Span>& freeSpans, unsigned int count, unsigned int& offset)
+{
+    for (size_t i = 0; i < freeSpans.size(); i++)
+    {
+        if (freeSpans[i].count < count)
+            continue;
+
+        offset = freeSpans[i].offset;
+        freeSpans[i].offset += count;
+        freeSpans[i].count -= count;
+        if (freeSpans[i].count == 0)
+            freeSpans.erase(freeSpans.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::returnSpan(vector<Span>& freeSpans, unsigned int offset, unsigned int count)
+{
+    vector<Span>::iterator next = lower_bound(freeSpans.begin(), freeSpans.end(), offset,
+                                              [](const Span& span, unsigned int value) { return span.offset < value; });
+
+    // Merged with the span right before and the one right after when they touch
+    if (next != freeSpans.begin())
+    {
+        Span& previous = *(next - 1);
+        if (previous.offset + previous.count == offset)
+        {
+            previous.count += count;
+            if (next != freeSpans.end() && previous.offset + previous.count == next->offset)
+            {
+                previous.count += next->count;
+                freeSpans.erase(next);
+            }
+            return;
+        }
+    }
+
+    if (next != freeSpans.end() && offset + count == next->offset)
+    {
+        next->offset = offset;
+        next->count += count;
+        return;
+    }
+
+    freeSpans.insert(next, {offset, count});
+}
+
+bool GeometryArena::createPool(VertexFormat format, unsigned int vertexCount, unsigned int indexCount)
+{
+    Pool& pool = pools[format];
+    if (pool.VAO != 0)
+        return true;
+
+    pool.vertexStride = getVertexStride(format);
+    if (pool.vertexStride == 0)
+        return false;
+
+    // Room for the first request and as much again, growth takes it from there
+    pool.vertexCapacity = min(maxVertices, max(minPoolVertices, vertexCount * 2));
+    pool.indexCapacity = min(maxIndices, max(minPoolIndices, indexCount * 2));
+    pool.vertexCount = 0;
+    pool.indexCount = 0;
+    pool.freeVertices.assign(1, {0, pool.vertexCapacity});
+    pool.freeIndices.assign(1, {0, pool.indexCapacity});
+
+    glGenVertexArrays(1, &pool.VAO);
+    glGenBuffers(1, &pool.VBO);
+    glGenBuffers(1, &pool.EBO);
+
+    GLStateCache::bindVertexArray(pool.VAO);
+
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    createStorage(GL_ARRAY_BUFFER, static_cast<size_t>(pool.vertexCapacity) * pool.vertexStride);
+
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+    createStorage(GL_ELEMENT_ARRAY_BUFFER, static_cast<size_t>(pool.indexCapacity) * sizeof(unsigned int));
+
+    setUpVertexFormat(format);
+
+    cout << "Created geometry pool " << format << " (" << pool.vertexCapacity << " vertices, "
+        << pool.indexCapacity << " indices)" << endl;
+    return true;
+}
+
+// Public
+
+void GeometryArena::setCapacity(unsigned int vertices, unsigned int indices)
+{
+    maxVertices = vertices;
+    maxIndices = indices;
+}
+
+GeometryAllocation GeometryArena::allocate(VertexFormat format, const void* vertices, unsigned int vertexCount,
+                                           const unsigned int* indices, unsigned int indexCount)
+{
+    GeometryAllocation allocation;
+    allocation.indexCount = indexCount;
+
+    if (format >= VertexFormat_Count || vertexCount == 0 || indexCount == 0 ||
+        !createPool(format, vertexCount, indexCount))
+        return allocation;
+
+    Pool& pool = pools[format];
+    unsigned int firstVertex = 0;
+    unsigned int firstIndex = 0;
+    const bool hasVertices = takeSpan(pool.freeVertices, vertexCount, firstVertex) ||
+        (growVertices(format, vertexCount) && takeSpan(pool.freeVertices, vertexCount, firstVertex));
+    const bool hasIndices = hasVertices && (takeSpan(pool.freeIndices, indexCount, firstIndex) ||
+        (growIndices(format, indexCount) && takeSpan(pool.freeIndices, indexCount, firstIndex)));
+    if (!hasIndices)
+    {
+        if (hasVertices)
+            returnSpan(pool.freeVertices, firstVertex, vertexCount);
+        cout << "Geometry pool " << format << " is full, mesh keeps its own buffers" << endl;
+        return allocation;
+    }
+
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<size_t>(firstVertex) * pool.vertexStride,
+                    static_cast<size_t>(vertexCount) * pool.vertexStride, vertices);
+
+    // The element buffer is VAO state, bind the VAO so the binding of whatever VAO is current stays untouched
+    GLStateCache::bindVertexArray(pool.VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, static_cast<size_t>(firstIndex) * sizeof(unsigned int),
+                    static_cast<size_t>(indexCount) * sizeof(unsigned int), indices);
+
+    allocation.VAO = pool.VAO;
+    allocation.firstIndex = firstIndex;
+    allocation.baseVertex = static_cast<int>(firstVertex);
+    allocation.inArena = true;
+    allocation.vertexCount = vertexCount;
+    allocation.format = format;
+
+    pool.vertexCount += vertexCount;
+    pool.indexCount += indexCount;
+    return allocation;
+}
+
+void GeometryArena::free(GeometryAllocation& allocation)
+{
+    // A pool destroyed since has nothing to take back
+    if (allocation.inArena && pools[allocation.format].VAO == allocation.VAO)
+    {
+        Pool& pool = pools[allocation.format];
+        returnSpan(pool.freeVertices, static_cast<unsigned int>(allocation.baseVertex), allocation.vertexCount);
+        returnSpan(pool.freeIndices, allocation.firstIndex, allocation.indexCount);
+        pool.vertexCount -= allocation.vertexCount;
+        pool.indexCount -= allocation.indexCount;
+    }
+    allocation = GeometryAllocation();
+}
+
+unsigned int GeometryArena::getVAO(VertexFormat format)
+{
+    return format < VertexFormat_Count ? pools[format].VAO : 0;
+}
+
+unsigned int GeometryArena::getUsedVertices(VertexFormat format)
+{
+    return format < VertexFormat_Count ? pools[format].vertexCount : 0;
+}
+
+unsigned int GeometryArena::getUsedIndices(VertexFormat format)
+{
+    return format < VertexFormat_Count ? pools[format].indexCount : 0;
+}
+
+unsigned int GeometryArena::getVertexCapacity(VertexFormat format)
+{
+    return format < VertexFormat_Count ? pools[format].vertexCapacity : 0;
+}
+
+bool GeometryArena::isMultiDrawSupported()
+{
+    // baseInstance is how each command finds its world matrix
+    return GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance;
+}
+
+void GeometryArena::uploadIndirect(const vector<DrawElementsIndirectCommand>& commands,
+                                   const vector<glm::mat4>& drawMatrices)
+{
+    if (indirectBuffer == 0)
+    {
+        glGenBuffers(1, &indirectBuffer);
+        glGenBuffers(1, &drawMatrixBuffer);
+    }
+
+    const size_t commandSize = commands.size() * sizeof(DrawElementsIndirectCommand);
+    if (commandSize > indirectCapacity)
+    {
+        indirectCapacity = commandSize + commandSize / 2;
+        RenderStats::countBufferAllocation();
+    }
+    // Orphaned every frame, only a larger capacity counts as an allocation
+    GLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandSize, commands.data());
+
+    const size_t matrixSize = drawMatrices.size() * sizeof(glm::mat4);
+    if (matrixSize > drawMatrixCapacity)
+    {
+        drawMatrixCapacity = matrixSize + matrixSize / 2;
+        RenderStats::countBufferAllocation();
+    }
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, drawMatrixBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawMatrixCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, matrixSize, drawMatrices.data());
+}
+
+unsigned int GeometryArena::getIndirectBuffer()
+{
+    return indirectBuffer;
+}
+
+unsigned int GeometryArena::getDrawMatrixBuffer()
+{
+    return drawMatrixBuffer;
+}
+
+void GeometryArena::destroy()
+{
+    for (Pool& pool : pools)
+    {
+        if (pool.VAO == 0)
+            continue;
+
+        GLStateCache::forgetBuffer(pool.VBO);
+        GLStateCache::forgetBuffer(pool.EBO);
+        GLStateCache::forgetVertexArray(pool.VAO);
+        glDeleteBuffers(1, &pool.VBO);
+        glDeleteBuffers(1, &pool.EBO);
+        glDeleteVertexArrays(1, &pool.VAO);
+        pool = Pool();
+    }
+
+    if (indirectBuffer != 0)
+    {
+        GLStateCache::forgetBuffer(indirectBuffer);
+        GLStateCache::forgetBuffer(drawMatrixBuffer);
+        glDeleteBuffers(1, &indirectBuffer);
+        glDeleteBuffers(1, &drawMatrixBuffer);
+        indirectBuffer = 0;
+        drawMatrixBuffer = 0;
+        indirectCapacity = 0;
+        drawMatrixCapacity = 0;
+    }
+}
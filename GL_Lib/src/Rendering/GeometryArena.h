@@ -0,0 +1,134 @@
+#pragma once
+#include <vector>
+
+#include "Core/deps.h"
+#include "glm.hpp"
+
+namespace gllib
+{
+    /// <summary>
+    /// Vertex layouts the arena keeps a pool and a VAO for
+    /// </summary>
+    enum VertexFormat
+    {
+        VertexFormat_Mesh = 0, // Vertex from Importer/Mesh.h: position, normal, uv, tangent, bitangent
+        VertexFormat_Count
+    };
+
+    /// <summary>
+    /// Where a mesh lives. Meshes outside the arena use their own VAO with firstIndex and baseVertex at 0.
+    /// </summary>
+    struct DLLExport GeometryAllocation
+    {
+        unsigned int VAO = 0;
+        unsigned int indexCount = 0;
+        unsigned int firstIndex = 0;
+        int baseVertex = 0;
+        bool inArena = false;
+        unsigned int vertexCount = 0; // Span to hand back to GeometryArena::free
+        VertexFormat format = VertexFormat_Mesh;
+    };
+
+    /// <summary>
+    /// Layout read by glMultiDrawElementsIndirect
+    /// </summary>
+    struct DLLExport DrawElementsIndirectCommand
+    {
+        unsigned int count;
+        unsigned int instanceCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        unsigned int baseInstance;
+    };
+
+    /// <summary>
+    /// Fully static class. Suballocates the vertices and indices of static meshes from one immutable buffer pair
+    /// per vertex format, so every mesh of a format shares the same VAO. Freed spans are reused first fit, a full
+    /// pool grows into larger buffers behind the same VAO so the allocations handed out stay valid.
+    /// </summary>
+    class DLLExport GeometryArena
+    {
+    private:
+        struct Span
+        {
+            unsigned int offset;
+            unsigned int count;
+        };
+
+        struct Pool
+        {
+            unsigned int VAO = 0;
+            unsigned int VBO = 0;
+            unsigned int EBO = 0;
+            unsigned int vertexStride = 0;
+            unsigned int vertexCapacity = 0;
+            unsigned int indexCapacity = 0;
+            unsigned int vertexCount = 0; // In use
+            unsigned int indexCount = 0; // In use
+            std::vector<Span> freeVertices; // Sorted by offset, neighbours merged
+            std::vector<Span> freeIndices;
+        };
+
+        static Pool pools[VertexFormat_Count];
+        static unsigned int maxVertices;
+        static unsigned int maxIndices;
+
+        static unsigned int indirectBuffer;
+        static unsigned int drawMatrixBuffer;
+        static size_t indirectCapacity;
+        static size_t drawMatrixCapacity;
+
+        static bool createPool(VertexFormat format, unsigned int vertexCount, unsigned int indexCount);
+        static void createStorage(unsigned int target, size_t size);
+        /// <summary>
+        /// Replaces the buffer with a larger one holding the same data, returns the new name
+        /// </summary>
+        static unsigned int resizeBuffer(unsigned int buffer, size_t oldSize, size_t newSize);
+        static bool growVertices(VertexFormat format, unsigned int vertexCount);
+        static bool growIndices(VertexFormat format, unsigned int indexCount);
+        static bool takeSpan(std::vector<Span>& freeSpans, unsigned int count, unsigned int& offset);
+        static void returnSpan(std::vector<Span>& freeSpans, unsigned int offset, unsigned int count);
+        static void setUpVertexFormat(VertexFormat format);
+        static unsigned int getVertexStride(VertexFormat format);
+
+    public:
+        /// <summary>
+        /// Largest size a pool grows to, in vertices and indices per format. Pools start sized from their first
+        /// request.
+        /// </summary>
+        static void setCapacity(unsigned int vertices, unsigned int indices);
+
+        /// <summary>
+        /// Copies the geometry into the pool of its format. Returns an allocation outside the arena (VAO 0)
+        /// if the pool can't grow enough, the caller is expected to keep its own buffers in that case.
+        /// </summary>
+        static GeometryAllocation allocate(VertexFormat format, const void* vertices, unsigned int vertexCount,
+                                           const unsigned int* indices, unsigned int indexCount);
+        /// <summary>
+        /// Hands the spans back to the pool and resets the allocation. Allocations outside the arena are ignored.
+        /// </summary>
+        static void free(GeometryAllocation& allocation);
+
+        static unsigned int getVAO(VertexFormat format);
+        static unsigned int getUsedVertices(VertexFormat format);
+        static unsigned int getUsedIndices(VertexFormat format);
+        static unsigned int getVertexCapacity(VertexFormat format);
+
+        /// <summary>
+        /// True when the driver can take a whole batch of arena meshes in one glMultiDrawElementsIndirect
+        /// </summary>
+        static bool isMultiDrawSupported();
+        /// <summary>
+        /// Uploads the commands and the per draw world matrices (read as instance attributes through baseInstance)
+        /// </summary>
+        static void uploadIndirect(const std::vector<DrawElementsIndirectCommand>& commands,
+                                   const std::vector<glm::mat4>& drawMatrices);
+        static unsigned int getIndirectBuffer();
+        static unsigned int getDrawMatrixBuffer();
+
+        /// <summary>
+        /// Frees every pool, allocations handed out before become invalid
+        /// </summary>
+        static void destroy();
+    };
+}
@@ -0,0 +1,246 @@
+#include "GpuProfiler.h"
+
+using namespace gllib;
+using namespace std;
+
+bool GpuProfiler::enabled = false;
+int GpuProfiler::available = -1;
+unsigned int GpuProfiler::windowSize = 60;
+GpuProfiler::FrameQueries GpuProfiler::frames[frameLatency];
+unsigned int GpuProfiler::frameIndex = 0;
+bool GpuProfiler::frameOpen = false;
+vector<GpuProfiler::Region> GpuProfiler::regions;
+unordered_map<string, unsigned int> GpuProfiler::regionLookup;
+vector<unsigned int> GpuProfiler::openRegions;
+
+// Private
+
+unsigned int GpuProfiler::getRegion(const char* name)
+{
+    const auto it = regionLookup.find(name);
+    if (it != regionLookup.end())
+        return it->second;
+
+    Region region;
+    region.name = name;
+    region.history.assign(windowSize, 0.0);
+    regions.push_back(region);
+
+    const unsigned int index = static_cast<unsigned int>(regions.size() - 1);
+    regionLookup[name] = index;
+    return index;
+}
+
+unsigned int GpuProfiler::issueTimestamp()
+{
+    FrameQueries& frame = frames[frameIndex % frameLatency];
+    if (frame.used == frame.pool.size())
+    {
+        unsigned int query = 0;
+        glGenQueries(1, &query);
+        frame.pool.push_back(query);
+    }
+
+    glQueryCounter(frame.pool[frame.used], GL_TIMESTAMP);
+    return frame.used++;
+}
+
+void GpuProfiler::collect(FrameQueries& frame)
+{
+    frame.submitted = false;
+    if (frame.used == 0)
+        return;
+
+    // Timestamps complete in order, if the last one is ready the whole frame is
+    GLint ready = 0;
+    glGetQueryObjectiv(frame.pool[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+    if (!ready)
+        return;
+
+    // A region can be opened several times in a frame, its entries add up
+    vector<double> frameMs(regions.size(), 0.0);
+    vector<bool> touched(regions.size(), false);
+    for (const PendingRegion& region : frame.pending)
+    {
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(frame.pool[region.startQuery], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.pool[region.endQuery], GL_QUERY_RESULT, &end);
+        frameMs[region.region] += end > start ? (end - start) / 1000000.0 : 0.0;
+        touched[region.region] = true;
+    }
+
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        if (!touched[i])
+            continue;
+
+        Region& region = regions[i];
+        region.lastMs = frameMs[i];
+        region.history[region.historyNext] = frameMs[i];
+        region.historyNext = (region.historyNext + 1) % windowSize;
+        if (region.historyCount < windowSize)
+            region.historyCount++;
+    }
+}
+
+// Public
+
+bool GpuProfiler::isAvailable()
+{
+    if (available < 0)
+    {
+        if (glQueryCounter == nullptr || !(GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query))
+        {
+            available = 0;
+        }
+        else
+        {
+            // Some drivers expose the entry points with a 0 bit counter
+            GLint bits = 0;
+            glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+            available = bits > 0 ? 1 : 0;
+        }
+    }
+    return available == 1;
+}
+
+void GpuProfiler::setEnabled(bool isEnabled)
+{
+    enabled = isEnabled;
+    if (!enabled)
+    {
+        frameOpen = false;
+        openRegions.clear();
+    }
+}
+
+bool GpuProfiler::isEnabled()
+{
+    return enabled;
+}
+
+void GpuProfiler::setWindowSize(unsigned int frames)
+{
+    windowSize = frames > 0 ? frames : 1;
+    for (Region& region : regions)
+    {
+        region.history.assign(windowSize, 0.0);
+        region.historyNext = 0;
+        region.historyCount = 0;
+    }
+}
+
+void GpuProfiler::beginFrame()
+{
+    if (!enabled || !isAvailable())
+        return;
+
+    FrameQueries& frame = frames[frameIndex % frameLatency];
+    if (frame.submitted)
+        collect(frame);
+
+    frame.used = 0;
+    frame.pending.clear();
+    openRegions.clear();
+    frameOpen = true;
+}
+
+void GpuProfiler::endFrame()
+{
+    if (!frameOpen)
+        return;
+
+    while (!openRegions.empty())
+        endRegion();
+
+    frames[frameIndex % frameLatency].submitted = true;
+    frameIndex++;
+    frameOpen = false;
+}
+
+void GpuProfiler::beginRegion(const char* name)
+{
+    if (!frameOpen)
+        return;
+
+    FrameQueries& frame = frames[frameIndex % frameLatency];
+    PendingRegion region;
+    region.region = getRegion(name);
+    region.startQuery = issueTimestamp();
+    region.endQuery = region.startQuery;
+    frame.pending.push_back(region);
+    openRegions.push_back(static_cast<unsigned int>(frame.pending.size() - 1));
+}
+
+void GpuProfiler::endRegion()
+{
+    if (!frameOpen || openRegions.empty())
+        return;
+
+    FrameQueries& frame = frames[frameIndex % frameLatency];
+    frame.pending[openRegions.back()].endQuery = issueTimestamp();
+    openRegions.pop_back();
+}
+
+double GpuProfiler::getRegionMs(const string& name)
+{
+    const auto it = regionLookup.find(name);
+    if (it == regionLookup.end())
+        return 0.0;
+
+    const Region& region = regions[it->second];
+    if (region.historyCount == 0)
+        return 0.0;
+
+    double total = 0.0;
+    for (unsigned int i = 0; i < region.historyCount; i++)
+        total += region.history[i];
+    return total / region.historyCount;
+}
+
+double GpuProfiler::getRegionLastMs(const string& name)
+{
+    const auto it = regionLookup.find(name);
+    return it != regionLookup.end() ? regions[it->second].lastMs : 0.0;
+}
+
+vector<string> GpuProfiler::getRegionNames()
+{
+    vector<string> names;
+    for (const Region& region : regions)
+        names.push_back(region.name);
+    return names;
+}
+
+void GpuProfiler::destroy()
+{
+    for (FrameQueries& frame : frames)
+    {
+        if (!frame.pool.empty())
+            glDeleteQueries(static_cast<GLsizei>(frame.pool.size()), frame.pool.data());
+        frame.pool.clear();
+        frame.pending.clear();
+        frame.used = 0;
+        frame.submitted = false;
+    }
+    regions.clear();
+    regionLookup.clear();
+    openRegions.clear();
+    frameOpen = false;
+    available = -1;
+}
+
+// GpuProfileScope
+
+GpuProfileScope::GpuProfileScope(const char* name) : active(GpuProfiler::isEnabled())
+{
+    if (active)
+        GpuProfiler::beginRegion(name);
+}
+
+GpuProfileScope::~GpuProfileScope()
+{
+    if (active)
+        GpuProfiler::endRegion();
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Core/deps.h"
+#include "Core/Profiler.h"
+
+#ifndef GLLIB_PROFILER_DISABLED
+#define GLLIB_GPU_PROFILE_SCOPE(name) gllib::GpuProfileScope GLLIB_PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+#else
+#define GLLIB_GPU_PROFILE_SCOPE(name)
+#endif
+
+namespace gllib
+{
+    /// <summary>
+    /// Fully static class. Times named regions on the GPU with GL_TIMESTAMP queries, so regions can nest.
+    /// Queries are kept per frame in a ring of frameLatency frames and only read once the GPU reports them
+    /// available, results that are still pending are dropped instead of waiting on them.
+    /// Region times are averaged over the last few frames that returned results.
+    /// </summary>
+    class DLLExport GpuProfiler
+    {
+    private:
+        static const unsigned int frameLatency = 3;
+
+        struct Region
+        {
+            std::string name;
+            std::vector<double> history;
+            unsigned int historyNext = 0;
+            unsigned int historyCount = 0;
+            double lastMs = 0.0;
+        };
+
+        struct PendingRegion
+        {
+            unsigned int region;
+            unsigned int startQuery; // Index in the frame query pool
+            unsigned int endQuery;
+        };
+
+        struct FrameQueries
+        {
+            std::vector<unsigned int> pool;
+            unsigned int used = 0;
+            std::vector<PendingRegion> pending;
+            bool submitted = false;
+        };
+
+        static bool enabled;
+        static int available; // -1 until checked against the context
+        static unsigned int windowSize;
+        static FrameQueries frames[frameLatency];
+        static unsigned int frameIndex;
+        static bool frameOpen;
+        static std::vector<Region> regions;
+        static std::unordered_map<std::string, unsigned int> regionLookup;
+        static std::vector<unsigned int> openRegions; // Indices into the current frame pending regions
+
+        static unsigned int getRegion(const char* name);
+        static unsigned int issueTimestamp();
+        static void collect(FrameQueries& frame);
+
+    public:
+        /// <summary>
+        /// Needs a context, timer queries are core since GL 3.3 (Mesa llvmpipe included)
+        /// </summary>
+        static bool isAvailable();
+        static void setEnabled(bool isEnabled);
+        static bool isEnabled();
+        /// <summary>
+        /// Frames averaged per region, resets every region history
+        /// </summary>
+        static void setWindowSize(unsigned int frames);
+
+        /// <summary>
+        /// Reads the frame issued frameLatency frames ago, if the GPU is done with it, and starts a new one
+        /// </summary>
+        static void beginFrame();
+        static void endFrame();
+
+        static void beginRegion(const char* name);
+        static void endRegion();
+
+        /// <summary>
+        /// Averaged GPU milliseconds, 0 for regions that haven't returned results yet
+        /// </summary>
+        static double getRegionMs(const std::string& name);
+        static double getRegionLastMs(const std::string& name);
+        static std::vector<std::string> getRegionNames();
+        static void destroy();
+    };
+
+    /// <summary>
+    /// Times the scope it lives in on the GPU, use it through GLLIB_GPU_PROFILE_SCOPE
+    /// </summary>
+    class DLLExport GpuProfileScope
+    {
+    private:
+        bool active;
+
+    public:
+        explicit GpuProfileScope(const char* name);
+        ~GpuProfileScope();
+    };
+}
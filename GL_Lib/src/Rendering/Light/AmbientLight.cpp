@@ -9,6 +9,7 @@ namespace gllib
     void AmbientLight::setIntensity(float newIntensity)
     {
         intensity = newIntensity;
+        markDirty();
     }
 
     float AmbientLight::getIntensity() const
@@ -16,20 +17,8 @@ namespace gllib
         return intensity;
     }
 
-    void AmbientLight::apply(unsigned int shaderProgram) const
+    void AmbientLight::writeTo(LightBlock& block) const
     {
-        // Set ambient color and intensity
-        Shader::setVec3(shaderProgram, "ambientStrength", color.r * intensity, color.g * intensity,
-                        color.b * intensity);
-        
-        Shader::setVec3(shaderProgram, "lightColor", color.r, color.g, color.b);
-        Shader::setVec3(shaderProgram, "lightPos", 0.0f, 0.0f, 0.0f);
-        
-        Shader::setFloat(shaderProgram, "diffuseStrength", 0.0f);
-        Shader::setFloat(shaderProgram, "specularStrength", 0.0f);
-        
-        Shader::setFloat(shaderProgram, "light.constant", 1.0f);
-        Shader::setFloat(shaderProgram, "light.linear", 0.0f);
-        Shader::setFloat(shaderProgram, "light.quadratic", 0.0f);
+        block.ambient += glm::vec4(color.r * intensity, color.g * intensity, color.b * intensity, 0.0f);
     }
 }
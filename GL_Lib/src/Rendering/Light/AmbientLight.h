@@ -15,6 +15,6 @@ namespace gllib
         void setIntensity(float newIntensity);
         float getIntensity() const;
 
-        void apply(unsigned int shaderProgram) const override;
+        void writeTo(LightBlock& block) const override;
     };
 }
@@ -5,20 +5,38 @@ namespace gllib
     Light::Light(const Color& color): color(color)
     {
         lights.push_back(this);
+        markDirty();
     }
 
     Light::~Light()
     {
         lights.remove(this);
+        markDirty();
     }
 
     void Light::setColor(const Color& newColor)
     {
         color = newColor;
+        markDirty();
     }
 
     Color Light::getColor() const
     {
         return color;
     }
+
+    void Light::markDirty()
+    {
+        dirty = true;
+    }
+
+    bool Light::isDirty()
+    {
+        return dirty;
+    }
+
+    void Light::clearDirty()
+    {
+        dirty = false;
+    }
 }
@@ -5,6 +5,7 @@
 #include "Math/transform.h"
 #include "../Shader.h"
 #include "Material.h"
+#include "Rendering/UniformBuffers.h"
 
 namespace gllib
 {
@@ -13,6 +14,8 @@ namespace gllib
     protected:
         Color color;
 
+        inline static bool dirty = true;
+
     public:
         inline  static std::list<Light*> lights;
 
@@ -23,6 +26,16 @@ namespace gllib
         void setColor(const Color& newColor);
         Color getColor() const;
 
-        virtual void apply(unsigned int shaderProgram) const = 0;
+        /// <summary>
+        /// Adds the light to the block uploaded to the "LightData" uniform buffer
+        /// </summary>
+        virtual void writeTo(LightBlock& block) const = 0;
+
+        /// <summary>
+        /// Flags the light block for upload, every setter calls it
+        /// </summary>
+        static void markDirty();
+        static bool isDirty();
+        static void clearDirty();
     };
 }
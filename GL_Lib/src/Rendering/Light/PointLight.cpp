@@ -6,6 +6,7 @@ namespace gllib
     void PointLight::setPosition(const glm::vec3& newPosition)
     {
         position = newPosition;
+        markDirty();
     }
 
     PointLight::PointLight(const glm::vec3& position, const Color& color, float constant, float linear, float quadratic)
@@ -23,18 +24,17 @@ namespace gllib
         constant = newConstant;
         linear = newLinear;
         quadratic = newQuadratic;
+        markDirty();
     }
 
-    void PointLight::apply(unsigned int shaderProgram) const
+    void PointLight::writeTo(LightBlock& block) const
     {
-        Shader::setVec3(shaderProgram, "lightPos", position.x, position.y, position.z);
-        Shader::setVec3(shaderProgram, "lightColor", color.r, color.g, color.b);
+        if (block.counts.x >= LightBlock::maxPointLights)
+            return;
 
-        Shader::setFloat(shaderProgram, "diffuseStrength", 1.0f);
-        Shader::setFloat(shaderProgram, "specularStrength", 0.5f);
-
-        Shader::setFloat(shaderProgram, "light.constant", constant);
-        Shader::setFloat(shaderProgram, "light.linear", linear);
-        Shader::setFloat(shaderProgram, "light.quadratic", quadratic);
+        PointLightData& data = block.pointLights[block.counts.x++];
+        data.position = glm::vec4(position, 1.0f);
+        data.color = glm::vec4(color.r, color.g, color.b, 0.5f);
+        data.attenuation = glm::vec4(constant, linear, quadratic, 0.0f);
     }
 }
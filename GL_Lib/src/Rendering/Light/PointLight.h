@@ -19,6 +19,6 @@ namespace gllib
         glm::vec3 getPosition() const;
         void setPosition(const glm::vec3& newPosition);
         void setAttenuation(float newConstant, float newLinear, float newQuadratic);
-        void apply(unsigned int shaderProgram) const override;
+        void writeTo(LightBlock& block) const override;
     };
 }
@@ -19,6 +19,7 @@
         void SpotLight::setPosition(const glm::vec3& newPosition)
         {
             position = newPosition;
+            markDirty();
         }
     
         glm::vec3 SpotLight::getDirection() const
@@ -29,12 +30,14 @@
         void SpotLight::setDirection(const glm::vec3& newDirection)
         {
             direction = glm::normalize(newDirection);
+            markDirty();
         }
     
         void SpotLight::setCutOff(float newInnerCutOff, float newOuterCutOff)
         {
             innerCutOff = newInnerCutOff;
             outerCutOff = newOuterCutOff;
+            markDirty();
         }
     
         float SpotLight::getInnerCutOff() const
@@ -52,28 +55,21 @@
             constant = newConstant;
             linear = newLinear;
             quadratic = newQuadratic;
+            markDirty();
         }
     
-        void SpotLight::apply(unsigned int shaderProgram) const
+        void SpotLight::writeTo(LightBlock& block) const
         {
-            // Set spotlight position and direction
-            Shader::setVec3(shaderProgram, "spotLight.position", position.x, position.y, position.z);
-            Shader::setVec3(shaderProgram, "spotLight.direction", direction.x, direction.y, direction.z);
+            if (block.counts.y >= LightBlock::maxSpotLights)
+                return;
     
-            // Set spotlight color
-            Shader::setVec3(shaderProgram, "spotLight.color", color.r, color.g, color.b);
+            SpotLightData& data = block.spotLights[block.counts.y++];
+            data.position = glm::vec4(position, 1.0f);
+            data.direction = glm::vec4(direction, 0.5f);
+            data.color = glm::vec4(color.r, color.g, color.b, 0.0f);
     
-            // Set spotlight cone angles (convert to cosine for shader efficiency)
-            Shader::setFloat(shaderProgram, "spotLight.innerCutOff", cos(glm::radians(innerCutOff)));
-            Shader::setFloat(shaderProgram, "spotLight.outerCutOff", cos(glm::radians(outerCutOff)));
-    
-            // Set attenuation factors
-            Shader::setFloat(shaderProgram, "spotLight.constant", constant);
-            Shader::setFloat(shaderProgram, "spotLight.linear", linear);
-            Shader::setFloat(shaderProgram, "spotLight.quadratic", quadratic);
-    
-            // Set light strengths
-            Shader::setFloat(shaderProgram, "spotLight.diffuseStrength", 1.0f);
-            Shader::setFloat(shaderProgram, "spotLight.specularStrength", 0.5f);
+            // Cone angles are sent as cosines for shader efficiency
+            data.cutOff = glm::vec4(cos(glm::radians(innerCutOff)), cos(glm::radians(outerCutOff)), 0.0f, 0.0f);
+            data.attenuation = glm::vec4(constant, linear, quadratic, 0.0f);
         }
-    }
\ No newline at end of file
+    }
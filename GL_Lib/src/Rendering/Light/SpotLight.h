@@ -35,6 +35,6 @@ namespace gllib
 
         void setAttenuation(float newConstant, float newLinear, float newQuadratic);
 
-        void apply(unsigned int shaderProgram) const override;
+        void writeTo(LightBlock& block) const override;
     };
 }
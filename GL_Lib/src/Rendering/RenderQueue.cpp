@@ -0,0 +1,523 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "Rendering/GLStateCache.h"
+#include "Rendering/GpuProfiler.h"
+#include "Rendering/RenderStats.h"
+#include "Rendering/shader.h"
+
+using namespace gllib;
+using namespace std;
+
+namespace
+{
+    // Bits of each field in the sort key, from the most significant one. Everything but the layer and the
+    // depth is a dense id handed out per flush, not a GL name or an address.
+    const unsigned int layerBits = 2;
+    const unsigned int programBits = 8;
+    const unsigned int materialBits = 14;
+    const unsigned int textureSetBits = 14;
+    const unsigned int VAOBits = 10;
+    const unsigned int depthBits = 16;
+
+    const unsigned int depthShift = 0;
+    const unsigned int VAOShift = depthShift + depthBits;
+    const unsigned int textureSetShift = VAOShift + VAOBits;
+    const unsigned int materialShift = textureSetShift + textureSetBits;
+    const unsigned int programShift = materialShift + materialBits;
+    const unsigned int layerShift = programShift + programBits;
+
+    const unsigned int radixBits = 16;
+    const unsigned int radixBuckets = 1u << radixBits;
+
+    unsigned long long field(unsigned long long value, unsigned int bits, unsigned int shift)
+    {
+        // An id past its field only costs sort order and batching, packets keep their real state
+        assert(value < (1ull << bits) && "Too many distinct states in one render queue flush");
+        return (value & ((1ull << bits) - 1)) << shift;
+    }
+
+    // GPU profiler region of each layer
+    const char* const layerRegionNames[] = { "RenderQueue::Opaque", "RenderQueue::Ordered", "RenderQueue::Layer2",
+                                             "RenderQueue::Layer3" };
+}
+
+vector<DrawPacket> RenderQueue::packets;
+vector<unsigned long long> RenderQueue::sortKeys;
+vector<unsigned int> RenderQueue::sortedIndices;
+vector<unsigned long long> RenderQueue::keyScratch;
+vector<unsigned int> RenderQueue::indexScratch;
+
+vector<unsigned int> RenderQueue::batchSizes;
+vector<unsigned int> RenderQueue::batchCommands;
+vector<DrawElementsIndirectCommand> RenderQueue::commands;
+vector<glm::mat4> RenderQueue::drawMatrices;
+
+vector<MaterialData> RenderQueue::materials;
+unordered_map<unsigned long long, unsigned int> RenderQueue::materialLookup;
+vector<TextureSet> RenderQueue::textureSets;
+unordered_map<TextureSet, unsigned int, TextureSetHash> RenderQueue::textureSetLookup;
+unordered_map<unsigned int, unsigned int> RenderQueue::programIds;
+unordered_map<unsigned int, unsigned int> RenderQueue::vertexArrayIds;
+vector<FrameView> RenderQueue::views;
+
+unsigned int RenderQueue::sequence = 0;
+bool RenderQueue::enabled = true;
+bool RenderQueue::multiDrawEnabled = true;
+float RenderQueue::maxDepth = 1000.0f;
+
+bool TextureSet::operator==(const TextureSet& other) const
+{
+    return usedUnits == other.usedUnits && memcmp(textures, other.textures, sizeof(textures)) == 0;
+}
+
+size_t TextureSetHash::operator()(const TextureSet& set) const
+{
+    size_t hash = set.usedUnits;
+    for (unsigned int unit = 0; unit < LitShaderUniforms::maxTextureUnits; unit++)
+        hash = hash * 31 + set.textures[unit];
+    return hash;
+}
+
+// Private
+
+unsigned int RenderQueue::addMaterial(const Material* material, bool hasTexture)
+{
+    // Materials are owned by the entities, their address is stable for the whole frame
+    const unsigned long long lookupKey = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(material)) << 1 |
+        (hasTexture ? 1ull : 0ull);
+
+    unordered_map<unsigned long long, unsigned int>::iterator it = materialLookup.find(lookupKey);
+    if (it != materialLookup.end())
+        return it->second;
+
+    const unsigned int index = static_cast<unsigned int>(materials.size());
+    materials.push_back(UniformBuffers::toMaterialData(material, hasTexture));
+    materialLookup[lookupKey] = index;
+    return index;
+}
+
+unsigned int RenderQueue::addTextureSet(const TextureSet& set)
+{
+    unordered_map<TextureSet, unsigned int, TextureSetHash>::iterator it = textureSetLookup.find(set);
+    if (it != textureSetLookup.end())
+        return it->second;
+
+    const unsigned int index = static_cast<unsigned int>(textureSets.size());
+    textureSets.push_back(set);
+    textureSetLookup[set] = index;
+    return index;
+}
+
+unsigned int RenderQueue::addView(const glm::mat4& view, const glm::mat4& projection)
+{
+    // The camera rarely changes within a frame, only a change adds an entry
+    if (views.empty() || views.back().view != view || views.back().projection != projection)
+        views.push_back({view, projection});
+    return static_cast<unsigned int>(views.size() - 1);
+}
+
+unsigned int RenderQueue::getDenseId(unordered_map<unsigned int, unsigned int>& ids, unsigned int name)
+{
+    return ids.emplace(name, static_cast<unsigned int>(ids.size())).first->second;
+}
+
+unsigned long long RenderQueue::makeKey(RenderLayer layer, unsigned int program, unsigned int materialIndex,
+                                        unsigned int textureSetIndex, unsigned int VAO, float depth)
+{
+    // Ordered draws only sort by submission, everything below the layer is the sequence number
+    if (layer == RenderLayer_Ordered)
+        return field(layer, layerBits, layerShift) | sequence++;
+
+    float normalized = depth / maxDepth;
+    if (normalized < 0.0f)
+        normalized = 0.0f;
+    if (normalized > 1.0f)
+        normalized = 1.0f;
+    const unsigned int depthBucket = static_cast<unsigned int>(normalized * ((1u << depthBits) - 1));
+
+    return field(layer, layerBits, layerShift) |
+        field(getDenseId(programIds, program), programBits, programShift) |
+        field(materialIndex, materialBits, materialShift) |
+        field(textureSetIndex, textureSetBits, textureSetShift) |
+        field(getDenseId(vertexArrayIds, VAO), VAOBits, VAOShift) |
+        field(depthBucket, depthBits, depthShift);
+}
+
+void RenderQueue::radixSort()
+{
+    const size_t count = sortKeys.size();
+    sortedIndices.resize(count);
+    for (size_t i = 0; i < count; i++)
+        sortedIndices[i] = static_cast<unsigned int>(i);
+
+    if (count < 2)
+        return;
+
+    keyScratch.resize(count);
+    indexScratch.resize(count);
+
+    // LSD radix sort on 16 bit digits, stable so equal keys keep their submission order
+    static vector<unsigned int> histogram(radixBuckets);
+    for (unsigned int shift = 0; shift < 64; shift += radixBits)
+    {
+        fill(histogram.begin(), histogram.end(), 0u);
+        for (size_t i = 0; i < count; i++)
+            histogram[(sortKeys[i] >> shift) & (radixBuckets - 1)]++;
+
+        // Every key has the same digit, this pass would not move anything
+        if (histogram[(sortKeys[0] >> shift) & (radixBuckets - 1)] == count)
+            continue;
+
+        unsigned int offset = 0;
+        for (unsigned int bucket = 0; bucket < radixBuckets; bucket++)
+        {
+            const unsigned int bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const unsigned int destination = histogram[(sortKeys[i] >> shift) & (radixBuckets - 1)]++;
+            keyScratch[destination] = sortKeys[i];
+            indexScratch[destination] = sortedIndices[i];
+        }
+
+        sortKeys.swap(keyScratch);
+        sortedIndices.swap(indexScratch);
+    }
+}
+
+bool RenderQueue::canBatch(const DrawPacket& first, const DrawPacket& next)
+{
+    return next.type == DrawPacketType_Lit && next.inArena && next.instanceCount == 0 &&
+        next.program == first.program && next.VAO == first.VAO && next.viewIndex == first.viewIndex &&
+        next.materialIndex == first.materialIndex && next.textureSetIndex == first.textureSetIndex;
+}
+
+void RenderQueue::buildIndirectBatches()
+{
+    const size_t count = sortedIndices.size();
+    batchSizes.assign(count, 1);
+    batchCommands.assign(count, 0);
+    commands.clear();
+    drawMatrices.clear();
+
+    if (!multiDrawEnabled || !GeometryArena::isMultiDrawSupported())
+        return;
+
+    size_t i = 0;
+    while (i < count)
+    {
+        const DrawPacket& first = packets[sortedIndices[i]];
+        size_t end = i + 1;
+        if (first.type == DrawPacketType_Lit && first.inArena && first.instanceCount == 0)
+        {
+            while (end < count && canBatch(first, packets[sortedIndices[end]]))
+                end++;
+        }
+
+        // A single draw is cheaper without the indirect buffer round trip
+        if (end - i > 1)
+        {
+            batchSizes[i] = static_cast<unsigned int>(end - i);
+            batchCommands[i] = static_cast<unsigned int>(commands.size());
+            for (size_t j = i; j < end; j++)
+            {
+                const DrawPacket& packet = packets[sortedIndices[j]];
+                batchSizes[j] = j == i ? batchSizes[i] : 0;
+
+                DrawElementsIndirectCommand command;
+                command.count = packet.indexCount;
+                command.instanceCount = 1;
+                command.firstIndex = packet.firstIndex;
+                command.baseVertex = packet.baseVertex;
+                command.baseInstance = static_cast<unsigned int>(drawMatrices.size());
+                commands.push_back(command);
+                drawMatrices.push_back(packet.matrix);
+            }
+        }
+        i = end;
+    }
+
+    if (!commands.empty())
+        GeometryArena::uploadIndirect(commands, drawMatrices);
+}
+
+// Public
+
+void RenderQueue::submitModel(const GeometryAllocation& geometry, const glm::mat4& model,
+                              const vector<Texture>& textures, const Material* material,
+                              unsigned int instanceBuffer, unsigned int instanceCount)
+{
+    const unsigned int program = Renderer::getShader3DProgram();
+
+    TextureSet set;
+    memset(&set, 0, sizeof(set));
+    set.usedUnits = Renderer::resolveTextureUnits(textures, set.textures);
+
+    // Sort key depth is the distance along the camera forward axis
+    const glm::mat4 view = Renderer::getViewMatrix();
+    const glm::vec4 viewPosition = view * model[3];
+
+    DrawPacket packet;
+    packet.type = DrawPacketType_Lit;
+    packet.program = program;
+    packet.VAO = geometry.VAO;
+    packet.EBO = 0;
+    packet.indexCount = geometry.indexCount;
+    packet.firstIndex = geometry.firstIndex;
+    packet.baseVertex = geometry.baseVertex;
+    packet.inArena = geometry.inArena;
+    packet.viewIndex = addView(view, Renderer::getProjectionMatrix());
+    packet.materialIndex = addMaterial(material, !textures.empty());
+    packet.textureSetIndex = addTextureSet(set);
+    packet.instanceBuffer = instanceBuffer;
+    packet.instanceCount = instanceCount;
+    packet.matrix = model;
+    packet.sortKey = makeKey(RenderLayer_Opaque, program, packet.materialIndex, packet.textureSetIndex, geometry.VAO,
+                             -viewPosition.z);
+
+    packets.push_back(packet);
+}
+
+void RenderQueue::submitMVP(unsigned int program, unsigned int VAO, unsigned int EBO, unsigned int indexCount,
+                            const glm::mat4& mvp, unsigned int textureID, RenderLayer layer)
+{
+    TextureSet set;
+    memset(&set, 0, sizeof(set));
+    set.textures[0] = textureID;
+    set.usedUnits = 1u;
+
+    DrawPacket packet;
+    packet.type = DrawPacketType_MVP;
+    packet.program = program;
+    packet.VAO = VAO;
+    packet.EBO = EBO;
+    packet.indexCount = indexCount;
+    packet.firstIndex = 0;
+    packet.baseVertex = 0;
+    packet.inArena = false;
+    packet.viewIndex = 0;
+    packet.materialIndex = 0;
+    packet.textureSetIndex = addTextureSet(set);
+    packet.instanceBuffer = 0;
+    packet.instanceCount = 0;
+    packet.matrix = mvp;
+    packet.sortKey = makeKey(layer, program, 0, packet.textureSetIndex, VAO, mvp[3].w);
+
+    packets.push_back(packet);
+}
+
+void RenderQueue::flush()
+{
+    if (packets.empty())
+    {
+        clear();
+        return;
+    }
+
+    sortKeys.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); i++)
+        sortKeys[i] = packets[i].sortKey;
+    radixSort();
+    buildIndirectBatches();
+
+    const LitShaderUniforms& litUniforms = Renderer::getLitUniforms();
+
+    // Binds are filtered by the state cache, only the uniforms of the previous draw are tracked here
+    unsigned int boundProgram = 0;
+    unsigned int boundMaterial = ~0u;
+    unsigned int uploadedWindow = ~0u;
+    unsigned int uploadedView = ~0u;
+    bool lightsUploaded = false;
+    UniformHandle mvpUniform;
+    bool programBound = false;
+    int boundInstanced = -1;
+    // Packets are sorted by layer first, each layer is one GPU region
+    const bool timeLayers = GpuProfiler::isEnabled();
+    unsigned int timedLayer = ~0u;
+
+    for (size_t i = 0; i < sortedIndices.size(); i++)
+    {
+        const DrawPacket& packet = packets[sortedIndices[i]];
+        const unsigned int batchSize = batchSizes[i];
+
+        if (timeLayers)
+        {
+            const unsigned int layer = static_cast<unsigned int>(packet.sortKey >> layerShift) & ((1u << layerBits) - 1);
+            if (layer != timedLayer)
+            {
+                if (timedLayer != ~0u)
+                    GpuProfiler::endRegion();
+                GpuProfiler::beginRegion(layerRegionNames[layer]);
+                timedLayer = layer;
+            }
+        }
+
+        if (!programBound || packet.program != boundProgram)
+        {
+            GLStateCache::useProgram(packet.program);
+            boundProgram = packet.program;
+            programBound = true;
+            boundMaterial = ~0u;
+            boundInstanced = -1;
+
+            // Lights are the same for the whole flush
+            if (packet.type == DrawPacketType_Lit)
+            {
+                if (!lightsUploaded)
+                {
+                    UniformBuffers::updateLights();
+                    lightsUploaded = true;
+                }
+            }
+            else
+            {
+                const ShaderProgram* program = Shader::getProgram(packet.program);
+                mvpUniform = program ? program->getUniform("u_MVP") : UniformHandle();
+            }
+        }
+
+        if (packet.type == DrawPacketType_Lit)
+        {
+            // The camera of the submission, not whatever the renderer has when the queue is flushed
+            if (packet.viewIndex != uploadedView)
+            {
+                const FrameView& view = views[packet.viewIndex];
+                UniformBuffers::updateFrame(view.view, view.projection);
+                uploadedView = packet.viewIndex;
+            }
+
+            // Batched draws get their world matrix per command as an instance attribute
+            ShaderProgram::setMat4(litUniforms.model, batchSize > 1 ? glm::mat4(1.0f) : packet.matrix);
+            const int instanced = packet.instanceCount > 0 || batchSize > 1 ? 1 : 0;
+            if (instanced != boundInstanced)
+            {
+                ShaderProgram::setInt(litUniforms.instanced, instanced);
+                boundInstanced = instanced;
+            }
+            if (packet.materialIndex != boundMaterial)
+            {
+                // Materials go up in windows of the buffer size, packets are sorted by material so each window is uploaded once
+                const unsigned int window = packet.materialIndex / UniformBuffers::maxMaterials;
+                if (window != uploadedWindow)
+                {
+                    const unsigned int first = window * UniformBuffers::maxMaterials;
+                    UniformBuffers::uploadMaterials(&materials[first], static_cast<unsigned int>(materials.size()) - first);
+                    uploadedWindow = window;
+                }
+                ShaderProgram::setInt(litUniforms.materialIndex, packet.materialIndex - window * UniformBuffers::maxMaterials);
+                boundMaterial = packet.materialIndex;
+            }
+        }
+        else
+        {
+            ShaderProgram::setMat4(mvpUniform, packet.matrix);
+        }
+
+        const TextureSet& set = textureSets[packet.textureSetIndex];
+        for (unsigned int unit = 0; unit < LitShaderUniforms::maxTextureUnits; unit++)
+        {
+            if (set.usedUnits & (1u << unit))
+                GLStateCache::bindTexture(unit, set.textures[unit]);
+        }
+
+        GLStateCache::bindVertexArray(packet.VAO);
+        if (packet.EBO != 0)
+            GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, packet.EBO);
+
+        const void* indexOffset = (void*)(sizeof(unsigned int) * packet.firstIndex);
+        if (batchSize > 1)
+        {
+            Renderer::bindInstanceAttributes(GeometryArena::getDrawMatrixBuffer());
+            GLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, GeometryArena::getIndirectBuffer());
+            unsigned long long batchTriangles = 0;
+            for (unsigned int j = 0; j < batchSize; j++)
+                batchTriangles += packets[sortedIndices[i + j]].indexCount / 3;
+            RenderStats::countMultiDraw(batchTriangles);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (void*)(sizeof(DrawElementsIndirectCommand) * batchCommands[i]),
+                                        batchSize, 0);
+            Renderer::unbindInstanceAttributes();
+
+            // The rest of the batch is already drawn
+            i += batchSize - 1;
+        }
+        else if (packet.instanceCount > 0)
+        {
+            Renderer::bindInstanceAttributes(packet.instanceBuffer);
+            RenderStats::countDraw(packet.indexCount, packet.instanceCount);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, indexOffset,
+                                              packet.instanceCount, packet.baseVertex);
+            Renderer::unbindInstanceAttributes();
+        }
+        else
+        {
+            RenderStats::countDraw(packet.indexCount);
+            glDrawElementsBaseVertex(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, indexOffset, packet.baseVertex);
+        }
+    }
+
+    if (timedLayer != ~0u)
+        GpuProfiler::endRegion();
+
+    // Uniform sets made between frames go to the program the user picked
+    GLStateCache::useProgram(Shader::getCurrentShaderProgram());
+
+    clear();
+}
+
+void RenderQueue::clear()
+{
+    packets.clear();
+    sortKeys.clear();
+    sortedIndices.clear();
+    materials.clear();
+    materialLookup.clear();
+    textureSets.clear();
+    textureSetLookup.clear();
+    programIds.clear();
+    vertexArrayIds.clear();
+    views.clear();
+    sequence = 0;
+}
+
+void RenderQueue::setEnabled(bool enabled)
+{
+    // Anything already queued has to be drawn with the mode it was submitted for
+    if (!enabled)
+        flush();
+    RenderQueue::enabled = enabled;
+}
+
+bool RenderQueue::isEnabled()
+{
+    return enabled;
+}
+
+void RenderQueue::setMultiDrawEnabled(bool enabled)
+{
+    multiDrawEnabled = enabled;
+}
+
+bool RenderQueue::isMultiDrawEnabled()
+{
+    return multiDrawEnabled;
+}
+
+void RenderQueue::setMaxDepth(float maxDepth)
+{
+    if (maxDepth > 0.0f)
+        RenderQueue::maxDepth = maxDepth;
+}
+
+size_t RenderQueue::getPacketCount()
+{
+    return packets.size();
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+
+#include "Core/deps.h"
+#include "Importer/Mesh.h"
+#include "Rendering/Light/Material.h"
+#include "Rendering/GeometryArena.h"
+#include "Rendering/renderer.h"
+#include "Rendering/UniformBuffers.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// Layers are replayed in order. Opaque draws are sorted by state and then front to back,
+    /// ordered draws (2D shapes and sprites) keep the order in which they were submitted.
+    /// </summary>
+    enum RenderLayer
+    {
+        RenderLayer_Opaque = 0,
+        RenderLayer_Ordered = 1
+    };
+
+    /// <summary>
+    /// How the per draw matrix of a packet is uploaded
+    /// </summary>
+    enum DrawPacketType
+    {
+        DrawPacketType_Lit, // "model" of the renderer 3D program, with material and frame uniforms
+        DrawPacketType_MVP // "u_MVP" of the packet program, already multiplied on submission
+    };
+
+    /// <summary>
+    /// Everything needed to replay one glDrawElements without touching the object that submitted it
+    /// </summary>
+    struct DLLExport DrawPacket
+    {
+        unsigned long long sortKey;
+        DrawPacketType type;
+        unsigned int program;
+        unsigned int VAO;
+        unsigned int EBO; // 0 when the element buffer is already part of the VAO
+        unsigned int indexCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        bool inArena; // Lives in the geometry arena, can be merged into a multi draw
+        unsigned int viewIndex; // Camera the draw was submitted with, lit draws only
+        unsigned int materialIndex;
+        unsigned int textureSetIndex;
+        unsigned int instanceBuffer;
+        unsigned int instanceCount; // 0 for a regular draw
+        glm::mat4 matrix;
+    };
+
+    /// <summary>
+    /// Texture bound to each unit for a draw, 0 means the unit is left empty
+    /// </summary>
+    struct DLLExport TextureSet
+    {
+        unsigned int textures[LitShaderUniforms::maxTextureUnits];
+        unsigned int usedUnits;
+
+        bool operator==(const TextureSet& other) const;
+    };
+
+    struct DLLExport TextureSetHash
+    {
+        size_t operator()(const TextureSet& set) const;
+    };
+
+    /// <summary>
+    /// View and projection of the renderer when lit draws were submitted, replayed into the frame uniforms
+    /// </summary>
+    struct DLLExport FrameView
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+    };
+
+    /// <summary>
+    /// Fully static class. Collects the frame draws as packets with a 64 bit sort key
+    /// (layer | program | material | texture set | VAO | depth), radix sorts them once
+    /// and replays them skipping every state change that matches the previous draw.
+    /// Programs, materials, texture sets and VAOs get dense ids per flush so they fit their key fields.
+    /// </summary>
+    class DLLExport RenderQueue
+    {
+    private:
+        static std::vector<DrawPacket> packets;
+        static std::vector<unsigned long long> sortKeys;
+        static std::vector<unsigned int> sortedIndices;
+        static std::vector<unsigned long long> keyScratch;
+        static std::vector<unsigned int> indexScratch;
+
+        // Runs of sorted arena packets sharing all their state, drawn with one glMultiDrawElementsIndirect
+        static std::vector<unsigned int> batchSizes; // Per sorted packet, 0 when it belongs to the previous batch
+        static std::vector<unsigned int> batchCommands; // Per sorted packet, first command of its batch
+        static std::vector<DrawElementsIndirectCommand> commands;
+        static std::vector<glm::mat4> drawMatrices;
+
+        static std::vector<MaterialData> materials; // Uploaded to the material uniform buffer on flush
+        static std::unordered_map<unsigned long long, unsigned int> materialLookup;
+        static std::vector<TextureSet> textureSets;
+        static std::unordered_map<TextureSet, unsigned int, TextureSetHash> textureSetLookup;
+        static std::unordered_map<unsigned int, unsigned int> programIds;
+        static std::unordered_map<unsigned int, unsigned int> vertexArrayIds;
+        static std::vector<FrameView> views;
+
+        static unsigned int sequence;
+        static bool enabled;
+        static bool multiDrawEnabled;
+        static float maxDepth;
+
+        static unsigned int addMaterial(const Material* material, bool hasTexture);
+        static unsigned int addTextureSet(const TextureSet& set);
+        static unsigned int addView(const glm::mat4& view, const glm::mat4& projection);
+        /// <summary>
+        /// Dense id of a GL name in submission order
+        /// </summary>
+        static unsigned int getDenseId(std::unordered_map<unsigned int, unsigned int>& ids, unsigned int name);
+        static unsigned long long makeKey(RenderLayer layer, unsigned int program, unsigned int materialIndex,
+                                          unsigned int textureSetIndex, unsigned int VAO, float depth);
+        static void radixSort();
+        static bool canBatch(const DrawPacket& first, const DrawPacket& next);
+        static void buildIndirectBatches();
+
+    public:
+        /// <summary>
+        /// Queues a mesh drawn with the renderer 3D program, material may be null for the default one
+        /// </summary>
+        static void submitModel(const GeometryAllocation& geometry, const glm::mat4& model,
+                                const std::vector<Texture>& textures, const Material* material,
+                                unsigned int instanceBuffer = 0, unsigned int instanceCount = 0);
+        /// <summary>
+        /// Queues a draw of the given program that only needs its "u_MVP" and one texture on unit 0
+        /// </summary>
+        static void submitMVP(unsigned int program, unsigned int VAO, unsigned int EBO, unsigned int indexCount,
+                              const glm::mat4& mvp, unsigned int textureID, RenderLayer layer = RenderLayer_Ordered);
+
+        /// <summary>
+        /// Sorts and draws everything submitted since the last flush, then empties the queue
+        /// </summary>
+        static void flush();
+        static void clear();
+
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+        /// <summary>
+        /// Merges arena meshes with the same state into indirect multi draws when the driver supports it
+        /// </summary>
+        static void setMultiDrawEnabled(bool enabled);
+        static bool isMultiDrawEnabled();
+        /// <summary>
+        /// View distance mapped to the last depth bucket of the sort key
+        /// </summary>
+        static void setMaxDepth(float maxDepth);
+        static size_t getPacketCount();
+    };
+}
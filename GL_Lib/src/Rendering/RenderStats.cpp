@@ -0,0 +1,82 @@
+#include "RenderStats.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace gllib;
+using namespace std;
+
+FrameRenderStats RenderStats::current;
+FrameRenderStats RenderStats::last;
+unsigned long long RenderStats::frameIndex = 0;
+
+namespace
+{
+    ofstream csvFile;
+}
+
+void RenderStats::endFrame()
+{
+    last = current;
+    current = FrameRenderStats();
+
+    if (csvFile.is_open())
+    {
+        csvFile << frameIndex << ',' << last.drawCalls << ',' << last.triangles << ',' << last.vertexArrayBinds << ','
+            << last.programBinds << ',' << last.textureBinds << ',' << last.uniformUploads << ','
+            << last.bufferAllocations << ',' << last.modelsTested << ',' << last.modelsFrustumCulled << ','
+            << last.modelsBSPCulled << ',' << last.meshesTested << ',' << last.meshesFrustumCulled << ','
+            << last.nodesBSPCulled << ',' << last.nodesFrustumCulled << ',' << last.debugVerticesDropped << '\n';
+    }
+
+    frameIndex++;
+}
+
+const FrameRenderStats& RenderStats::getCurrentFrame()
+{
+    return current;
+}
+
+const FrameRenderStats& RenderStats::getLastFrame()
+{
+    return last;
+}
+
+unsigned long long RenderStats::getFrameIndex()
+{
+    return frameIndex;
+}
+
+bool RenderStats::startCsv(const string& path)
+{
+    stopCsv();
+    csvFile.open(path);
+    if (!csvFile.is_open())
+    {
+        cout << "Failed to open render stats file: " << path << endl;
+        return false;
+    }
+
+    csvFile << "frame,drawCalls,triangles,vertexArrayBinds,programBinds,textureBinds,uniformUploads,"
+        "bufferAllocations,modelsTested,modelsFrustumCulled,modelsBSPCulled,meshesTested,meshesFrustumCulled,"
+        "nodesBSPCulled,nodesFrustumCulled,debugVerticesDropped\n";
+    return true;
+}
+
+void RenderStats::stopCsv()
+{
+    if (csvFile.is_open())
+        csvFile.close();
+}
+
+string RenderStats::toString(const FrameRenderStats& stats)
+{
+    ostringstream text;
+    text << "draws " << stats.drawCalls << " | tris " << stats.triangles << " | binds vao " << stats.vertexArrayBinds
+        << " prog " << stats.programBinds << " tex " << stats.textureBinds << " | uniforms " << stats.uniformUploads
+        << " | models " << stats.modelsTested - stats.modelsFrustumCulled - stats.modelsBSPCulled << "/"
+        << stats.modelsTested << " | meshes " << stats.meshesTested - stats.meshesFrustumCulled << "/"
+        << stats.meshesTested;
+    return text.str();
+}
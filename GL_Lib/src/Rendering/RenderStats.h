@@ -0,0 +1,96 @@
+#pragma once
+#include <string>
+
+#include "Core/deps.h"
+
+namespace gllib
+{
+    /// <summary>
+    /// What one frame sent to the driver and how much the culling rejected
+    /// </summary>
+    struct DLLExport FrameRenderStats
+    {
+        unsigned int drawCalls = 0;
+        unsigned long long triangles = 0;
+        unsigned int vertexArrayBinds = 0;
+        unsigned int programBinds = 0;
+        unsigned int textureBinds = 0;
+        unsigned int uniformUploads = 0; // glUniform calls and uniform buffer updates
+        unsigned int bufferAllocations = 0; // glBufferData / glBufferStorage creating or growing a buffer
+
+        unsigned int modelsTested = 0;
+        unsigned int modelsFrustumCulled = 0;
+        unsigned int modelsBSPCulled = 0;
+        unsigned int meshesTested = 0;
+        unsigned int meshesFrustumCulled = 0;
+        unsigned int nodesBSPCulled = 0; // Transform subtrees skipped whole by the BSP plane
+        unsigned int nodesFrustumCulled = 0; // Transform subtrees whose hierarchical AABB is outside the frustum
+
+        unsigned int debugVerticesDropped = 0; // Debug lines past DebugDraw's capacity
+    };
+
+    /// <summary>
+    /// Fully static class. Counts are added where the GL calls are issued (binds only when the state cache
+    /// lets them through) and closed once per frame, the closed frame can be written as a CSV row.
+    /// </summary>
+    class DLLExport RenderStats
+    {
+    private:
+        static FrameRenderStats current;
+        static FrameRenderStats last;
+        static unsigned long long frameIndex;
+
+    public:
+        static void countDraw(unsigned int indexCount, unsigned int instances = 1)
+        {
+            current.drawCalls++;
+            current.triangles += static_cast<unsigned long long>(indexCount / 3) * instances;
+        }
+        /// <summary>
+        /// One indirect call drawing several commands, triangles are counted by the caller
+        /// </summary>
+        static void countMultiDraw(unsigned long long triangles)
+        {
+            current.drawCalls++;
+            current.triangles += triangles;
+        }
+        static void countVertexArrayBind() { current.vertexArrayBinds++; }
+        static void countProgramBind() { current.programBinds++; }
+        static void countTextureBind() { current.textureBinds++; }
+        static void countUniformUpload() { current.uniformUploads++; }
+        static void countBufferAllocation() { current.bufferAllocations++; }
+
+        // The BSP tree rejects whole regions, the models in them are counted at once
+        static void countModelTested(unsigned int count = 1) { current.modelsTested += count; }
+        static void countModelFrustumCulled(unsigned int count = 1) { current.modelsFrustumCulled += count; }
+        static void countModelBSPCulled(unsigned int count = 1) { current.modelsBSPCulled += count; }
+        static void countMeshTested() { current.meshesTested++; }
+        static void countMeshFrustumCulled() { current.meshesFrustumCulled++; }
+        static void countNodeBSPCulled() { current.nodesBSPCulled++; }
+        static void countNodeFrustumCulled() { current.nodesFrustumCulled++; }
+        static void countDebugVerticesDropped(unsigned int count) { current.debugVerticesDropped += count; }
+
+        /// <summary>
+        /// Closes the frame: it becomes the last frame, goes to the CSV if one is open, and counting restarts
+        /// </summary>
+        static void endFrame();
+
+        /// <summary>
+        /// Counts of the frame still being recorded
+        /// </summary>
+        static const FrameRenderStats& getCurrentFrame();
+        static const FrameRenderStats& getLastFrame();
+        static unsigned long long getFrameIndex();
+
+        /// <summary>
+        /// Every closed frame is appended as a row until stopCsv, the header is written here
+        /// </summary>
+        static bool startCsv(const std::string& path);
+        static void stopCsv();
+
+        /// <summary>
+        /// Short single line summary, fits in a window title
+        /// </summary>
+        static std::string toString(const FrameRenderStats& stats);
+    };
+}
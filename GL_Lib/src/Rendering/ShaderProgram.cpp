@@ -0,0 +1,212 @@
+#include "ShaderProgram.h"
+
+#include <iostream>
+#include <gtc/type_ptr.hpp>
+#include "GLStateCache.h"
+#include "Rendering/RenderStats.h"
+
+using namespace gllib;
+using namespace std;
+
+ShaderProgram::ShaderProgram() : id(0)
+{
+}
+
+ShaderProgram::ShaderProgram(unsigned int id) : id(id)
+{
+    if (id != 0)
+        reflect();
+}
+
+// Private
+
+bool ShaderProgram::isSamplerType(unsigned int type)
+{
+    switch (type)
+    {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ShaderProgram::reflect()
+{
+    uniforms.clear();
+    samplers.clear();
+    reflectUniformBlocks();
+
+    int uniformCount = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    if (uniformCount <= 0)
+        return;
+
+    // Sampler units are fixed here so draws only have to bind textures, never set the sampler uniform
+    const unsigned int previousProgram = GLStateCache::getProgram();
+    GLStateCache::useProgram(id);
+
+    vector<char> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+    int nextTextureUnit = 0;
+
+    for (int i = 0; i < uniformCount; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id, i, static_cast<GLsizei>(nameBuffer.size()), &length, &size, &type, nameBuffer.data());
+        string name(nameBuffer.data(), length);
+
+        // Uniform blocks members are reported too but they have no location
+        int location = glGetUniformLocation(id, name.c_str());
+        if (location == -1)
+            continue;
+
+        // Arrays come back as "name[0]", register the plain name as well
+        string baseName = name;
+        const bool isArray = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+        if (isArray)
+            baseName = name.substr(0, name.size() - 3);
+
+        for (int element = 0; element < size; element++)
+        {
+            UniformHandle handle;
+            handle.type = type;
+            handle.size = size - element;
+            handle.location = element == 0 ? location : glGetUniformLocation(id, (baseName + "[" + to_string(element) + "]").c_str());
+            if (handle.location == -1)
+                continue;
+
+            if (isSamplerType(type))
+            {
+                handle.textureUnit = nextTextureUnit++;
+                glUniform1i(handle.location, handle.textureUnit);
+            }
+
+            const string elementName = isArray ? baseName + "[" + to_string(element) + "]" : name;
+            uniforms[elementName] = handle;
+            if (element == 0 && isArray)
+                uniforms[baseName] = handle;
+            if (handle.isSampler())
+                samplers.push_back(elementName);
+        }
+    }
+
+    GLStateCache::useProgram(previousProgram);
+
+    cout << "(" << id << ") Reflected " << uniforms.size() << " uniforms, " << samplers.size() << " samplers and "
+        << uniformBlocks.size() << " uniform blocks" << endl;
+}
+
+void ShaderProgram::reflectUniformBlocks()
+{
+    uniformBlocks.clear();
+
+    int blockCount = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+
+    vector<char> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+    for (int i = 0; i < blockCount; i++)
+    {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(id, i, static_cast<GLsizei>(nameBuffer.size()), &length, nameBuffer.data());
+        uniformBlocks[string(nameBuffer.data(), length)] = static_cast<unsigned int>(i);
+    }
+}
+
+// Public
+
+UniformHandle ShaderProgram::getUniform(const string& name) const
+{
+    unordered_map<string, UniformHandle>::const_iterator it = uniforms.find(name);
+    if (it == uniforms.end())
+        return UniformHandle();
+    return it->second;
+}
+
+bool ShaderProgram::hasUniform(const string& name) const
+{
+    return uniforms.find(name) != uniforms.end();
+}
+
+int ShaderProgram::getTextureUnit(const string& name) const
+{
+    return getUniform(name).textureUnit;
+}
+
+bool ShaderProgram::hasUniformBlock(const string& name) const
+{
+    return uniformBlocks.find(name) != uniformBlocks.end();
+}
+
+bool ShaderProgram::bindUniformBlock(const string& name, unsigned int bindingPoint) const
+{
+    unordered_map<string, unsigned int>::const_iterator it = uniformBlocks.find(name);
+    if (it == uniformBlocks.end())
+        return false;
+
+    glUniformBlockBinding(id, it->second, bindingPoint);
+    return true;
+}
+
+void ShaderProgram::setMat4(const UniformHandle& uniform, const glm::mat4& value)
+{
+    if (!uniform.isValid())
+        return;
+
+    RenderStats::countUniformUpload();
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ShaderProgram::setVec3(const UniformHandle& uniform, const glm::vec3& value)
+{
+    if (!uniform.isValid())
+        return;
+
+    RenderStats::countUniformUpload();
+    glUniform3fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setVec4(const UniformHandle& uniform, const glm::vec4& value)
+{
+    if (!uniform.isValid())
+        return;
+
+    RenderStats::countUniformUpload();
+    glUniform4fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setFloat(const UniformHandle& uniform, float value)
+{
+    if (!uniform.isValid())
+        return;
+
+    RenderStats::countUniformUpload();
+    glUniform1f(uniform.location, value);
+}
+
+void ShaderProgram::setInt(const UniformHandle& uniform, int value)
+{
+    if (!uniform.isValid())
+        return;
+
+    RenderStats::countUniformUpload();
+    glUniform1i(uniform.location, value);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Core/deps.h"
+#include "glm.hpp"
+
+namespace gllib
+{
+    /// <summary>
+    /// An active uniform of a linked program, resolved once through glGetActiveUniform
+    /// </summary>
+    struct DLLExport UniformHandle
+    {
+        int location = -1;
+        unsigned int type = 0;
+        int size = 0;
+        int textureUnit = -1; // Only samplers get a texture unit
+
+        bool isValid() const { return location != -1; }
+        bool isSampler() const { return textureUnit != -1; }
+    };
+
+    /// <summary>
+    /// Linked shader program plus the reflection of all its active uniforms.
+    /// Handles should be fetched once (after linking) and reused on every draw.
+    /// </summary>
+    class DLLExport ShaderProgram
+    {
+    private:
+        unsigned int id;
+        std::unordered_map<std::string, UniformHandle> uniforms;
+        std::vector<std::string> samplers;
+        std::unordered_map<std::string, unsigned int> uniformBlocks; // Block index by name
+
+        void reflect();
+        void reflectUniformBlocks();
+        static bool isSamplerType(unsigned int type);
+
+    public:
+        ShaderProgram();
+        explicit ShaderProgram(unsigned int id);
+
+        unsigned int getID() const { return id; }
+        bool isValid() const { return id != 0; }
+        /// <summary>
+        /// Lets a program be passed wherever the raw GL id used to be expected
+        /// </summary>
+        operator unsigned int() const { return id; }
+
+        /// <summary>
+        /// Returns an invalid handle (location -1) if the uniform is not active in the program
+        /// </summary>
+        UniformHandle getUniform(const std::string& name) const;
+        bool hasUniform(const std::string& name) const;
+        /// <summary>
+        /// Texture unit assigned to a sampler at link time, -1 if it is not a sampler
+        /// </summary>
+        int getTextureUnit(const std::string& name) const;
+
+        bool hasUniformBlock(const std::string& name) const;
+        /// <summary>
+        /// Links a uniform block of the program to a buffer binding point, false if the block is not active
+        /// </summary>
+        bool bindUniformBlock(const std::string& name, unsigned int bindingPoint) const;
+
+        const std::unordered_map<std::string, UniformHandle>& getUniforms() const { return uniforms; }
+        const std::vector<std::string>& getSamplers() const { return samplers; }
+
+        // Setters work on the currently bound program, they never look anything up by name.
+        static void setMat4(const UniformHandle& uniform, const glm::mat4& value);
+        static void setVec3(const UniformHandle& uniform, const glm::vec3& value);
+        static void setVec4(const UniformHandle& uniform, const glm::vec4& value);
+        static void setFloat(const UniformHandle& uniform, float value);
+        static void setInt(const UniformHandle& uniform, int value);
+    };
+}
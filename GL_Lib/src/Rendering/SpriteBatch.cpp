@@ -0,0 +1,351 @@
+#include "SpriteBatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Rendering/GLStateCache.h"
+#include "Rendering/renderer.h"
+#include "Rendering/shader.h"
+#include "Rendering/RenderStats.h"
+
+using namespace gllib;
+using namespace std;
+
+vector<float> SpriteBatch::vertices;
+vector<unsigned int> SpriteBatch::localIndices;
+vector<unsigned int> SpriteBatch::sortedIndices;
+vector<SpriteBatch::BatchItem> SpriteBatch::items;
+vector<glm::mat4> SpriteBatch::viewProjections;
+vector<int> SpriteBatch::stateSortedLayers;
+
+unsigned int SpriteBatch::VAO = 0;
+unsigned int SpriteBatch::VBO = 0;
+unsigned int SpriteBatch::EBO = 0;
+size_t SpriteBatch::vertexCapacity = 0;
+size_t SpriteBatch::indexCapacity = 0;
+unsigned int SpriteBatch::region = 0;
+bool SpriteBatch::enabled = true;
+
+float* SpriteBatch::mappedVertices = nullptr;
+unsigned int* SpriteBatch::mappedIndices = nullptr;
+GLsync SpriteBatch::fences[SpriteBatch::regionCount] = {};
+
+// Private
+
+void SpriteBatch::createBuffers(size_t vertexCount, size_t indexCount)
+{
+    if (VAO != 0 && vertexCount <= vertexCapacity && indexCount <= indexCapacity)
+        return;
+
+    // Only while the frame size is still growing, the draws in flight keep the old storage alive
+    releaseBuffers();
+    vertexCapacity = max(vertexCapacity, vertexCount + vertexCount / 2);
+    indexCapacity = max(indexCapacity, indexCount + indexCount / 2);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    GLStateCache::bindVertexArray(VAO);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    const size_t vertexSize = sizeof(float) * floatsPerVertex * vertexCapacity * regionCount;
+    const size_t indexSize = sizeof(unsigned int) * indexCapacity * regionCount;
+    if (GLAD_GL_ARB_buffer_storage)
+    {
+        // Coherent mapping, the frame written on flush is visible to its draws without an explicit flush
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        RenderStats::countBufferAllocation();
+        glBufferStorage(GL_ARRAY_BUFFER, vertexSize, nullptr, flags);
+        mappedVertices = static_cast<float*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexSize, flags));
+        RenderStats::countBufferAllocation();
+        glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexSize, nullptr, flags);
+        mappedIndices = static_cast<unsigned int*>(glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexSize, flags));
+    }
+    if (!mappedVertices || !mappedIndices)
+    {
+        if (GLAD_GL_ARB_buffer_storage)
+        {
+            // Immutable storage can't be respecified, the fallback gets buffers of its own
+            releaseBuffers();
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+            GLStateCache::bindVertexArray(VAO);
+            GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+            GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        }
+        RenderStats::countBufferAllocation();
+        glBufferData(GL_ARRAY_BUFFER, vertexSize, nullptr, GL_STREAM_DRAW);
+        RenderStats::countBufferAllocation();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    Renderer::setUpVertexAttributes();
+}
+
+void SpriteBatch::releaseBuffers()
+{
+    if (VAO == 0)
+        return;
+
+    for (GLsync& fence : fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    GLStateCache::bindVertexArray(VAO);
+    if (mappedVertices)
+    {
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mappedVertices = nullptr;
+    }
+    if (mappedIndices)
+    {
+        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+        mappedIndices = nullptr;
+    }
+
+    GLStateCache::forgetBuffer(VBO);
+    GLStateCache::forgetBuffer(EBO);
+    GLStateCache::forgetVertexArray(VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteVertexArrays(1, &VAO);
+    VAO = 0;
+    VBO = 0;
+    EBO = 0;
+    region = 0;
+}
+
+void SpriteBatch::waitForRegion()
+{
+    // The region was last drawn regionCount frames ago, this only blocks if the GPU is that far behind
+    GLsync& fence = fences[region];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+bool SpriteBatch::itemLess(const BatchItem& a, const BatchItem& b)
+{
+    // Reordering by state inside a layer would change which blended sprite ends up on top, only layers that
+    // opted in are grouped
+    if (a.layer != b.layer)
+        return a.layer < b.layer;
+    if (a.stateSorted)
+    {
+        if (a.matrixIndex != b.matrixIndex)
+            return a.matrixIndex < b.matrixIndex;
+        if (a.program != b.program)
+            return a.program < b.program;
+        if (a.texture != b.texture)
+            return a.texture < b.texture;
+    }
+    return a.sequence < b.sequence;
+}
+
+// Public
+
+void SpriteBatch::setEnabled(bool isEnabled)
+{
+    if (enabled && !isEnabled)
+        flush();
+    enabled = isEnabled;
+}
+
+bool SpriteBatch::isEnabled()
+{
+    return enabled;
+}
+
+void SpriteBatch::setLayerSortedByState(int layer, bool sorted)
+{
+    vector<int>::iterator it = find(stateSortedLayers.begin(), stateSortedLayers.end(), layer);
+    if (sorted && it == stateSortedLayers.end())
+        stateSortedLayers.push_back(layer);
+    else if (!sorted && it != stateSortedLayers.end())
+        stateSortedLayers.erase(it);
+}
+
+bool SpriteBatch::isLayerSortedByState(int layer)
+{
+    return find(stateSortedLayers.begin(), stateSortedLayers.end(), layer) != stateSortedLayers.end();
+}
+
+void SpriteBatch::submit(const float vertexData[], unsigned int vertexCount, const int index[], unsigned int indexCount,
+                         const glm::mat4& model, unsigned int textureID, unsigned int program, int layer)
+{
+    if (vertexCount == 0 || indexCount == 0)
+        return;
+
+    const glm::mat4 viewProjection = Renderer::getProjectionMatrix() * Renderer::getViewMatrix();
+    if (viewProjections.empty() || viewProjections.back() != viewProjection)
+        viewProjections.push_back(viewProjection);
+
+    BatchItem item;
+    item.layer = layer;
+    item.matrixIndex = static_cast<unsigned int>(viewProjections.size() - 1);
+    item.program = program;
+    item.texture = textureID;
+    item.sequence = static_cast<unsigned int>(items.size());
+    item.stateSorted = false;
+    item.firstVertex = static_cast<unsigned int>(vertices.size() / floatsPerVertex);
+    item.firstIndex = static_cast<unsigned int>(localIndices.size());
+    item.indexCount = indexCount;
+    items.push_back(item);
+
+    // Positions go to world space here so the whole batch shares one u_MVP
+    const size_t start = vertices.size();
+    vertices.insert(vertices.end(), vertexData, vertexData + vertexCount * floatsPerVertex);
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        float* vertex = &vertices[start + i * floatsPerVertex];
+        const glm::vec4 world = model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+        vertex[0] = world.x;
+        vertex[1] = world.y;
+        vertex[2] = world.z;
+    }
+
+    for (unsigned int i = 0; i < indexCount; i++)
+        localIndices.push_back(static_cast<unsigned int>(index[i]));
+}
+
+unsigned int SpriteBatch::getQueuedCount()
+{
+    return static_cast<unsigned int>(items.size());
+}
+
+void SpriteBatch::flush()
+{
+    if (items.empty())
+    {
+        clear();
+        return;
+    }
+
+    // Looked up here so every item of a layer agrees, even if the setting changed during the frame
+    if (!stateSortedLayers.empty())
+    {
+        for (BatchItem& item : items)
+            item.stateSorted = isLayerSortedByState(item.layer);
+    }
+    sort(items.begin(), items.end(), itemLess);
+    createBuffers(vertices.size() / floatsPerVertex, localIndices.size());
+    waitForRegion();
+
+    // Indices are written in draw order, so every run of equal state is one contiguous range. They point at
+    // this frame's region of the vertex buffer.
+    const size_t firstVertex = region * vertexCapacity;
+    const size_t firstIndex = region * indexCapacity;
+    unsigned int* indexOut;
+    if (mappedIndices)
+    {
+        indexOut = mappedIndices + firstIndex;
+    }
+    else
+    {
+        sortedIndices.resize(localIndices.size());
+        indexOut = sortedIndices.data();
+    }
+    for (const BatchItem& item : items)
+    {
+        const unsigned int base = static_cast<unsigned int>(firstVertex) + item.firstVertex;
+        for (unsigned int i = 0; i < item.indexCount; i++)
+            *indexOut++ = localIndices[item.firstIndex + i] + base;
+    }
+
+    GLStateCache::bindVertexArray(VAO);
+    if (mappedVertices)
+    {
+        memcpy(mappedVertices + firstVertex * floatsPerVertex, vertices.data(), vertices.size() * sizeof(float));
+    }
+    else
+    {
+        GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * floatsPerVertex * firstVertex,
+                        sizeof(float) * vertices.size(), vertices.data());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * firstIndex,
+                        sizeof(unsigned int) * sortedIndices.size(), sortedIndices.data());
+    }
+
+    GLStateCache::setBlend(true);
+    GLStateCache::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    unsigned int boundProgram = 0;
+    unsigned int boundMatrix = ~0u;
+    UniformHandle mvpUniform;
+    size_t runStart = 0;
+    unsigned int runIndices = 0;
+
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        const BatchItem& item = items[i];
+        runIndices += item.indexCount;
+
+        // Keep growing the run while the next draw shares its state
+        if (i + 1 < items.size())
+        {
+            const BatchItem& next = items[i + 1];
+            if (next.matrixIndex == item.matrixIndex && next.program == item.program && next.texture == item.texture)
+                continue;
+        }
+
+        if (item.program != boundProgram)
+        {
+            GLStateCache::useProgram(item.program);
+            const ShaderProgram* program = Shader::getProgram(item.program);
+            mvpUniform = program ? program->getUniform("u_MVP") : UniformHandle();
+            boundProgram = item.program;
+            boundMatrix = ~0u;
+        }
+        if (item.matrixIndex != boundMatrix)
+        {
+            ShaderProgram::setMat4(mvpUniform, viewProjections[item.matrixIndex]);
+            boundMatrix = item.matrixIndex;
+        }
+        if (item.texture != 0)
+            GLStateCache::bindTexture(0, item.texture);
+
+        RenderStats::countDraw(runIndices);
+        glDrawElements(GL_TRIANGLES, runIndices, GL_UNSIGNED_INT,
+                       (void*)(sizeof(unsigned int) * (firstIndex + runStart)));
+
+        runStart += runIndices;
+        runIndices = 0;
+    }
+
+    if (mappedVertices)
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % regionCount;
+
+    // Uniform sets made between frames go to the program the user picked
+    GLStateCache::useProgram(Shader::getCurrentShaderProgram());
+
+    clear();
+}
+
+void SpriteBatch::clear()
+{
+    vertices.clear();
+    localIndices.clear();
+    items.clear();
+    viewProjections.clear();
+}
+
+void SpriteBatch::destroy()
+{
+    clear();
+    releaseBuffers();
+    vertexCapacity = 0;
+    indexCapacity = 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+
+#include "Core/deps.h"
+#include "glm.hpp"
+
+namespace gllib
+{
+    /// <summary>
+    /// Fully static class. 2D shapes and sprites write their vertices, already transformed on the CPU, into one
+    /// streaming vertex buffer. On flush the draws are ordered by layer, keeping submission order within a layer
+    /// so blended sprites still overlap the way they were drawn, and every run of adjacent draws sharing program,
+    /// texture and camera goes out in a single glDrawElements. Interleaved textures in a layer therefore cost a
+    /// draw each, layers marked with setLayerSortedByState are grouped by texture instead.
+    /// Like DebugDraw the buffers are a persistently mapped ring, each frame writes its own fenced region.
+    /// Vertices use the shape layout: xyz, rgba, uv (9 floats).
+    /// </summary>
+    class DLLExport SpriteBatch
+    {
+    private:
+        static const unsigned int floatsPerVertex = 9;
+        static const unsigned int regionCount = 3;
+
+        struct BatchItem
+        {
+            int layer;
+            unsigned int matrixIndex; // View projection active when it was submitted
+            unsigned int program;
+            unsigned int texture;
+            unsigned int sequence;
+            bool stateSorted; // Its layer is grouped by state rather than kept in submission order
+            unsigned int firstVertex;
+            unsigned int firstIndex;
+            unsigned int indexCount;
+        };
+
+        static std::vector<float> vertices;
+        static std::vector<unsigned int> localIndices;
+        static std::vector<unsigned int> sortedIndices;
+        static std::vector<BatchItem> items;
+        static std::vector<glm::mat4> viewProjections;
+        static std::vector<int> stateSortedLayers;
+
+        static unsigned int VAO;
+        static unsigned int VBO;
+        static unsigned int EBO;
+        static size_t vertexCapacity; // Vertices per region
+        static size_t indexCapacity; // Indices per region
+        static unsigned int region;
+        static bool enabled;
+
+        // Persistent path, sortedIndices is the index staging of the fallback
+        static float* mappedVertices;
+        static unsigned int* mappedIndices;
+        static GLsync fences[regionCount];
+
+        /// <summary>
+        /// Makes sure every region holds the frame, the ring is recreated bigger when it doesn't
+        /// </summary>
+        static void createBuffers(size_t vertexCount, size_t indexCount);
+        static void releaseBuffers();
+        static void waitForRegion();
+        static bool itemLess(const BatchItem& a, const BatchItem& b);
+
+    public:
+        static void setEnabled(bool isEnabled);
+        static bool isEnabled();
+
+        /// <summary>
+        /// Off by default. On, the draws of the layer are grouped by camera, program and texture instead of kept in
+        /// submission order: fewer draws, but blended sprites overlapping in it may change which one is on top.
+        /// For layers of opaque or non overlapping sprites, like tiles.
+        /// </summary>
+        static void setLayerSortedByState(int layer, bool sorted);
+        static bool isLayerSortedByState(int layer);
+
+        /// <summary>
+        /// Queues a shape. vertexData is in local space and gets multiplied by model here, indices are local to it.
+        /// Lower layers are drawn first, draws in the same layer keep the order they were submitted in unless the
+        /// layer is sorted by state.
+        /// </summary>
+        static void submit(const float vertexData[], unsigned int vertexCount, const int index[], unsigned int indexCount,
+                           const glm::mat4& model, unsigned int textureID, unsigned int program, int layer);
+
+        static unsigned int getQueuedCount();
+
+        /// <summary>
+        /// Writes the frame into the next region of the ring and draws it, one draw per run of shared state
+        /// </summary>
+        static void flush();
+        static void clear();
+        static void destroy();
+    };
+}
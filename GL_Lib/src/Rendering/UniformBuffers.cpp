@@ -0,0 +1,167 @@
+#include "UniformBuffers.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "Rendering/GLStateCache.h"
+#include "Rendering/Light/Light.h"
+#include "Rendering/Light/Material.h"
+#include "Rendering/RenderStats.h"
+
+using namespace gllib;
+using namespace std;
+
+unsigned int UniformBuffers::frameBuffer = 0;
+unsigned int UniformBuffers::lightBuffer = 0;
+unsigned int UniformBuffers::materialBuffer = 0;
+
+FrameBlock UniformBuffers::frameData = {};
+bool UniformBuffers::frameValid = false;
+MaterialData UniformBuffers::singleMaterial = {};
+bool UniformBuffers::singleMaterialValid = false;
+
+// Private
+
+void UniformBuffers::createBuffers()
+{
+    if (frameBuffer != 0)
+        return;
+
+    glGenBuffers(1, &frameBuffer);
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    RenderStats::countBufferAllocation();
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &lightBuffer);
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+    RenderStats::countBufferAllocation();
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &materialBuffer);
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+    RenderStats::countBufferAllocation();
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialData) * maxMaterials, nullptr, GL_DYNAMIC_DRAW);
+
+    GLStateCache::bindBufferBase(GL_UNIFORM_BUFFER, UniformBinding_Frame, frameBuffer);
+    GLStateCache::bindBufferBase(GL_UNIFORM_BUFFER, UniformBinding_Lights, lightBuffer);
+    GLStateCache::bindBufferBase(GL_UNIFORM_BUFFER, UniformBinding_Materials, materialBuffer);
+
+    // New buffers start empty, everything has to be uploaded once
+    frameValid = false;
+    singleMaterialValid = false;
+    Light::markDirty();
+
+    cout << "Created frame, light and material uniform buffers" << endl;
+}
+
+// Public
+
+void UniformBuffers::bindProgram(const ShaderProgram& program)
+{
+    createBuffers();
+
+    program.bindUniformBlock("FrameData", UniformBinding_Frame);
+    program.bindUniformBlock("LightData", UniformBinding_Lights);
+    program.bindUniformBlock("MaterialData", UniformBinding_Materials);
+}
+
+void UniformBuffers::updateFrame(const glm::mat4& view, const glm::mat4& projection)
+{
+    createBuffers();
+
+    if (frameValid && frameData.view == view && frameData.projection == projection)
+        return;
+
+    frameData.view = view;
+    frameData.projection = projection;
+    // The camera sits at the translation of the inverse view
+    frameData.viewPos = glm::vec4(glm::vec3(glm::inverse(view)[3]), 1.0f);
+    frameValid = true;
+
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    RenderStats::countUniformUpload();
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &frameData);
+}
+
+void UniformBuffers::updateLights()
+{
+    createBuffers();
+
+    if (!Light::isDirty())
+        return;
+
+    LightBlock block;
+    memset(&block, 0, sizeof(block));
+    for (Light* light : Light::lights)
+    {
+        light->writeTo(block);
+    }
+
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+    RenderStats::countUniformUpload();
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightBlock), &block);
+
+    Light::clearDirty();
+}
+
+void UniformBuffers::uploadMaterials(const MaterialData* materials, unsigned int count)
+{
+    createBuffers();
+
+    if (count > maxMaterials)
+        count = maxMaterials;
+    if (count == 0)
+        return;
+
+    GLStateCache::bindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+    RenderStats::countUniformUpload();
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MaterialData) * count, materials);
+
+    singleMaterialValid = false;
+}
+
+void UniformBuffers::uploadMaterial(const MaterialData& material)
+{
+    if (singleMaterialValid && memcmp(&singleMaterial, &material, sizeof(MaterialData)) == 0)
+        return;
+
+    uploadMaterials(&material, 1);
+    singleMaterial = material;
+    singleMaterialValid = true;
+}
+
+MaterialData UniformBuffers::toMaterialData(const Material* material, bool hasTexture)
+{
+    MaterialData data;
+    if (material)
+    {
+        data.diffuse = glm::vec4(material->diffuse, 1.0f);
+        data.specular = glm::vec4(material->specular, material->shininess);
+    }
+    else
+    {
+        // Default white/gray material
+        data.diffuse = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+        data.specular = glm::vec4(0.5f, 0.5f, 0.5f, 32.0f);
+    }
+    data.flags = glm::ivec4(hasTexture ? 1 : 0, 0, 0, 0);
+    return data;
+}
+
+void UniformBuffers::destroy()
+{
+    if (frameBuffer == 0)
+        return;
+
+    GLStateCache::forgetBuffer(frameBuffer);
+    GLStateCache::forgetBuffer(lightBuffer);
+    GLStateCache::forgetBuffer(materialBuffer);
+    glDeleteBuffers(1, &frameBuffer);
+    glDeleteBuffers(1, &lightBuffer);
+    glDeleteBuffers(1, &materialBuffer);
+    frameBuffer = 0;
+    lightBuffer = 0;
+    materialBuffer = 0;
+    frameValid = false;
+    singleMaterialValid = false;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "Core/deps.h"
+#include "glm.hpp"
+#include "Rendering/ShaderProgram.h"
+
+namespace gllib
+{
+    struct Material;
+
+    /// <summary>
+    /// Binding points shared by every program that declares the blocks
+    /// </summary>
+    enum UniformBinding
+    {
+        UniformBinding_Frame = 0,
+        UniformBinding_Lights = 1,
+        UniformBinding_Materials = 2
+    };
+
+    // The structs below mirror the std140 blocks of the lighting shaders, members are kept in vec4 slots
+    // so the C++ layout matches the GLSL one without padding rules.
+
+    /// <summary>
+    /// "FrameData" block
+    /// </summary>
+    struct DLLExport FrameBlock
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPos; // w unused
+    };
+
+    struct DLLExport PointLightData
+    {
+        glm::vec4 position; // w = diffuse strength
+        glm::vec4 color; // w = specular strength
+        glm::vec4 attenuation; // constant, linear, quadratic
+    };
+
+    struct DLLExport SpotLightData
+    {
+        glm::vec4 position; // w = diffuse strength
+        glm::vec4 direction; // w = specular strength
+        glm::vec4 color;
+        glm::vec4 cutOff; // cosine of the inner and outer angles
+        glm::vec4 attenuation; // constant, linear, quadratic
+    };
+
+    /// <summary>
+    /// "LightData" block
+    /// </summary>
+    struct DLLExport LightBlock
+    {
+        static const int maxPointLights = 8;
+        static const int maxSpotLights = 8;
+
+        glm::vec4 ambient; // Sum of every ambient light, color * intensity
+        glm::ivec4 counts; // x = point lights, y = spot lights
+        PointLightData pointLights[maxPointLights];
+        SpotLightData spotLights[maxSpotLights];
+    };
+
+    struct DLLExport MaterialData
+    {
+        glm::vec4 diffuse;
+        glm::vec4 specular; // w = shininess
+        glm::ivec4 flags; // x = has texture
+    };
+
+    /// <summary>
+    /// Fully static class. Owns the frame, light and material uniform buffers, every upload is skipped
+    /// when the data didn't change since the previous one.
+    /// </summary>
+    class DLLExport UniformBuffers
+    {
+    private:
+        static unsigned int frameBuffer;
+        static unsigned int lightBuffer;
+        static unsigned int materialBuffer;
+
+        static FrameBlock frameData;
+        static bool frameValid;
+        static MaterialData singleMaterial;
+        static bool singleMaterialValid;
+
+        static void createBuffers();
+
+    public:
+        // Fits in the 16KB every GL 3.3 implementation guarantees for a block
+        static const unsigned int maxMaterials = 256;
+
+        /// <summary>
+        /// Points the blocks of a program to the shared binding points
+        /// </summary>
+        static void bindProgram(const ShaderProgram& program);
+
+        /// <summary>
+        /// Uploads the camera data if it changed since the last frame
+        /// </summary>
+        static void updateFrame(const glm::mat4& view, const glm::mat4& projection);
+        /// <summary>
+        /// Rebuilds the light block from Light::lights only if a light changed
+        /// </summary>
+        static void updateLights();
+        /// <summary>
+        /// Uploads a batch of materials starting at slot 0, count is clamped to maxMaterials
+        /// </summary>
+        static void uploadMaterials(const MaterialData* materials, unsigned int count);
+        /// <summary>
+        /// Puts a single material on slot 0, used by draws that don't go through the render queue
+        /// </summary>
+        static void uploadMaterial(const MaterialData& material);
+
+        /// <summary>
+        /// Converts a material to its block layout, null gives the renderer default material
+        /// </summary>
+        static MaterialData toMaterialData(const Material* material, bool hasTexture);
+
+        static void destroy();
+    };
+}
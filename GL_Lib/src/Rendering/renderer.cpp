@@ -7,6 +7,11 @@
 #include "Importer/Mesh.h"
 #include "Light/AmbientLight.h"
 #include "Light/PointLight.h"
+#include "Rendering/GLStateCache.h"
+#include "Rendering/RenderQueue.h"
+#include "Rendering/shader.h"
+#include "Rendering/UniformBuffers.h"
+#include "Rendering/RenderStats.h"
 
 using namespace gllib;
 using namespace std;
@@ -36,10 +41,23 @@ void Renderer::setUpMVP()
     // TRS
     // the mpv matrix is calculated multiplying p*v*m
     glm::mat4 mvp = projMatrix * viewMatrix * modelMatrix;
-    GLint prog = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &prog);
-    int mvpLocation = glGetUniformLocation(prog, "u_MVP");
-    glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, glm::value_ptr(mvp));
+    const unsigned int prog = GLStateCache::getProgram();
+    if (prog != mvpProgram)
+    {
+        const ShaderProgram* program = Shader::getProgram(prog);
+        mvpUniform = program ? program->getUniform("u_MVP") : UniformHandle();
+        mvpProgram = prog;
+    }
+    ShaderProgram::setMat4(mvpUniform, mvp);
+}
+
+void Renderer::forgetProgram(unsigned int program)
+{
+    if (program == mvpProgram)
+    {
+        mvpProgram = 0;
+        mvpUniform = UniformHandle();
+    }
 }
 
 unsigned int Renderer::createVertexArrayObject()
@@ -52,11 +70,11 @@ unsigned int Renderer::createVertexArrayObject()
 unsigned int Renderer::createVertexBufferObject(const float vertexData[], GLsizei bufferSize)
 {
     unsigned int VBO;
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::setDepthTest(true);
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+    RenderStats::countBufferAllocation();
     glBufferData(GL_ARRAY_BUFFER, bufferSize, vertexData, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
     return VBO;
 }
 
@@ -64,9 +82,10 @@ unsigned int Renderer::createElementBufferObject(const int index[], GLsizei buff
 {
     unsigned int EBO;
     glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    // Left bound, the element buffer is part of the VAO being built
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    RenderStats::countBufferAllocation();
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, bufferSize, index, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     return EBO;
 }
 
@@ -77,7 +96,7 @@ RenderData Renderer::createRenderData(const float vertexData[], GLsizei vertexDa
 
     // VAO will store the attribute pointers of our buffer.
     rData.VAO = createVertexArrayObject();
-    glBindVertexArray(rData.VAO); // We need to bind VAO before setting up the attributes.
+    GLStateCache::bindVertexArray(rData.VAO); // We need to bind VAO before setting up the attributes.
 
     // VBO will store the data of the vertices such as; position, color, alpha, texture coords, etc.
     rData.VBO = createVertexBufferObject(vertexData, vertexDataSize * sizeof(float));
@@ -86,165 +105,270 @@ RenderData Renderer::createRenderData(const float vertexData[], GLsizei vertexDa
 
     // Before we set the attributes we need to have the VAO binded because that's where the pointers to these attributes will be saved.
     // We also have to bind VBO because we need to tell OpenGL which buffer we'll be using.
-    glBindBuffer(GL_ARRAY_BUFFER, rData.VBO);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, rData.VBO);
     setUpVertexAttributes();
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     // We need to specify the color blending to use the alpha channel.
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLStateCache::setBlend(true);
+    GLStateCache::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Unbinding after finishing simply for the sake of better binding understanding.
-    glBindVertexArray(0);
+    // The VAO stays bound, every bind goes through the state cache so nothing else can touch it by accident.
     return rData;
 }
 
 void Renderer::destroyRenderData(RenderData rData)
 {
+    GLStateCache::forgetBuffer(rData.EBO);
+    GLStateCache::forgetBuffer(rData.VBO);
+    GLStateCache::forgetVertexArray(rData.VAO);
     glDeleteBuffers(1, &rData.EBO);
     glDeleteBuffers(1, &rData.VBO);
     glDeleteVertexArrays(1, &rData.VAO);
 }
 
+void Renderer::updateVertexBuffer(RenderData rData, const float vertexData[], GLsizei vertexDataSize)
+{
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, rData.VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertexDataSize * sizeof(float), vertexData);
+}
+
 void Renderer::drawElements(RenderData rData, GLsizei indexSize)
 {
+    if (RenderQueue::isEnabled())
+    {
+        RenderQueue::submitMVP(Shader::getCurrentShaderProgram(), rData.VAO, rData.EBO, indexSize,
+                               projMatrix * viewMatrix * modelMatrix, 0);
+        return;
+    }
+
+    GLStateCache::useProgram(Shader::getCurrentShaderProgram());
     setUpMVP();
-    glBindVertexArray(rData.VAO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rData.EBO);
+    GLStateCache::bindVertexArray(rData.VAO);
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, rData.EBO);
 
+    RenderStats::countDraw(indexSize);
     glDrawElements(GL_TRIANGLES, indexSize, GL_UNSIGNED_INT, 0);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
 void Renderer::drawTexture(RenderData rData, GLsizei indexSize, unsigned int textureID)
 {
+    if (RenderQueue::isEnabled())
+    {
+        RenderQueue::submitMVP(Shader::getCurrentShaderProgram(), rData.VAO, rData.EBO, indexSize,
+                               projMatrix * viewMatrix * modelMatrix, textureID);
+        return;
+    }
+
     bindTexture(textureID);
     drawElements(rData, indexSize);
 }
 
 void Renderer::drawEntity3D(unsigned& VAO, unsigned indexQty, Material& material, glm::mat4 trans)
 {
-    glUseProgram(shader3DProgram);
+    GeometryAllocation geometry;
+    geometry.VAO = VAO;
+    geometry.indexCount = indexQty;
+    drawEntity3D(geometry, material, trans);
+}
 
-    // Set transformation matrices
-    glUniformMatrix4fv(glGetUniformLocation(shader3DProgram, "model"), 1, GL_FALSE, glm::value_ptr(trans));
-    glUniformMatrix4fv(glGetUniformLocation(shader3DProgram, "view"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(shader3DProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projMatrix));
+void Renderer::drawEntity3D(const GeometryAllocation& geometry, Material& material, glm::mat4 trans)
+{
+    static std::vector<Texture> noTextures;
+    drawGeometry3D(geometry, trans, noTextures, &material);
+}
 
-    // Set material properties
-    glUniform3fv(glGetUniformLocation(shader3DProgram, "material.diffuse"), 1, glm::value_ptr(material.diffuse));
-    glUniform3fv(glGetUniformLocation(shader3DProgram, "material.specular"), 1, glm::value_ptr(material.specular));
-    glUniform1f(glGetUniformLocation(shader3DProgram, "material.shininess"), material.shininess);
+void Renderer::drawModel3D(unsigned& VAO, unsigned indexQty, glm::mat4 trans, std::vector<Texture>& textures, Material* material)
+{
+    drawModel3DInstanced(VAO, indexQty, trans, textures, material, 0, 0);
+}
 
-    // Explicitly set hasTexture to false for entities without textures
-    glUniform1i(glGetUniformLocation(shader3DProgram, "material.hasTexture"), 0);
+void Renderer::drawModel3DInstanced(unsigned& VAO, unsigned indexQty, glm::mat4 trans, std::vector<Texture>& textures,
+                                    Material* material, unsigned int instanceBuffer, unsigned int instanceCount)
+{
+    GeometryAllocation geometry;
+    geometry.VAO = VAO;
+    geometry.indexCount = indexQty;
+    drawGeometry3D(geometry, trans, textures, material, instanceBuffer, instanceCount);
+}
 
-    // Apply lights from your Light system
-    int lightIndex = 0;
-    for (Light* light : Light::lights)
+void Renderer::drawGeometry3D(const GeometryAllocation& geometry, glm::mat4 trans, std::vector<Texture>& textures,
+                              Material* material, unsigned int instanceBuffer, unsigned int instanceCount)
+{
+    if (RenderQueue::isEnabled())
     {
-        light->apply(shader3DProgram);
-        lightIndex++;
-        if (lightIndex >= 8) break;
+        RenderQueue::submitModel(geometry, trans, textures, material, instanceBuffer, instanceCount);
+        return;
     }
 
-    // Set view position (camera position)
-    glUniform3f(glGetUniformLocation(shader3DProgram, "viewPos"), 0.0f, 0.0f, 3.0f);
+    GLStateCache::useProgram(shader3DProgram);
+    ShaderProgram::setMat4(litUniforms.model, trans);
+    ShaderProgram::setInt(litUniforms.instanced, instanceCount > 0 ? 1 : 0);
+    applyLitFrameUniforms();
+    applyLitMaterial(material, !textures.empty());
+
+    // Bind textures to the units their samplers got at link time
+    unsigned int unitTextures[LitShaderUniforms::maxTextureUnits];
+    unsigned int boundUnits = resolveTextureUnits(textures, unitTextures);
+    for (unsigned int unit = 0; unit < LitShaderUniforms::maxTextureUnits; unit++)
+    {
+        if (!(boundUnits & (1u << unit)))
+            continue;
+        GLStateCache::bindTexture(unit, unitTextures[unit]);
+    }
 
-    // Draw the mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexQty, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    // Draw the mesh, arena meshes start somewhere inside the shared buffers
+    const void* indexOffset = (void*)(sizeof(unsigned int) * geometry.firstIndex);
+    GLStateCache::bindVertexArray(geometry.VAO);
+    if (instanceCount > 0)
+    {
+        bindInstanceAttributes(instanceBuffer);
+        RenderStats::countDraw(geometry.indexCount, instanceCount);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, indexOffset,
+                                          instanceCount, geometry.baseVertex);
+        unbindInstanceAttributes();
+        ShaderProgram::setInt(litUniforms.instanced, 0);
+    }
+    else
+    {
+        RenderStats::countDraw(geometry.indexCount);
+        glDrawElementsBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, indexOffset, geometry.baseVertex);
+    }
 
-    glUseProgram(0);
+    // Program, VAO and textures stay bound, the next draw with the same state skips rebinding them
 }
 
-void Renderer::drawModel3D(unsigned& VAO, unsigned indexQty, glm::mat4 trans, std::vector<Texture>& textures, Material* material)
+void Renderer::applyLitFrameUniforms()
+{
+    UniformBuffers::updateFrame(viewMatrix, projMatrix);
+    UniformBuffers::updateLights();
+}
+
+void Renderer::applyLitMaterial(const Material* material, bool hasTexture)
 {
-    glUseProgram(shader3DProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shader3DProgram, "model"), 1, GL_FALSE, glm::value_ptr(trans));
-    glUniformMatrix4fv(glGetUniformLocation(shader3DProgram, "view"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(shader3DProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projMatrix));
+    UniformBuffers::uploadMaterial(UniformBuffers::toMaterialData(material, hasTexture));
+    ShaderProgram::setInt(litUniforms.materialIndex, 0);
+}
 
-    // Set material properties
-    if (material)
+unsigned int Renderer::resolveTextureUnits(const std::vector<Texture>& textures,
+                                           unsigned int unitTextures[LitShaderUniforms::maxTextureUnits])
+{
+    unsigned int usedUnits = 0;
+    unsigned int typeCount[TextureType_Count] = {};
+    for (const Texture& texture : textures)
     {
-        glUniform3fv(glGetUniformLocation(shader3DProgram, "material.diffuse"), 1, glm::value_ptr(material->diffuse));
-        glUniform3fv(glGetUniformLocation(shader3DProgram, "material.specular"), 1, glm::value_ptr(material->specular));
-        glUniform1f(glGetUniformLocation(shader3DProgram, "material.shininess"), material->shininess);
+        unsigned int& number = typeCount[texture.kind];
+        if (number >= LitShaderUniforms::maxTexturesPerType)
+            continue;
+
+        const int unit = litUniforms.textureUnits[texture.kind][number++];
+        if (unit < 0 || unit >= static_cast<int>(LitShaderUniforms::maxTextureUnits))
+            continue;
+
+        unitTextures[unit] = texture.id;
+        usedUnits |= 1u << unit;
     }
-    else
+
+    // Samplers without a map of their own keep reading the first texture, like when they all defaulted to unit 0
+    if (!textures.empty())
     {
-        // Default white/gray material
-        glm::vec3 defaultDiffuse(0.8f, 0.8f, 0.8f);
-        glm::vec3 defaultSpecular(0.5f, 0.5f, 0.5f);
-        glUniform3fv(glGetUniformLocation(shader3DProgram, "material.diffuse"), 1, glm::value_ptr(defaultDiffuse));
-        glUniform3fv(glGetUniformLocation(shader3DProgram, "material.specular"), 1, glm::value_ptr(defaultSpecular));
-        glUniform1f(glGetUniformLocation(shader3DProgram, "material.shininess"), 32.0f);
+        for (unsigned int type = 0; type < TextureType_Count; type++)
+        {
+            const int unit = litUniforms.textureUnits[type][0];
+            if (typeCount[type] > 0 || unit < 0 || unit >= static_cast<int>(LitShaderUniforms::maxTextureUnits))
+                continue;
+
+            unitTextures[unit] = textures[0].id;
+            usedUnits |= 1u << unit;
+        }
     }
-    
-    // Bind textures
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    for (unsigned int i = 0; i < textures.size(); i++)
+
+    return usedUnits;
+}
+
+void Renderer::bindInstanceAttributes(unsigned int instanceBuffer)
+{
+    // A mat4 attribute takes 4 consecutive locations, one per column
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (unsigned int column = 0; column < 4; column++)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
-
-        GLint u_Material = glGetUniformLocation(shader3DProgram, ("material." + name + number).c_str());
-        glUniform1i(u_Material, i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        const unsigned int location = LitShaderUniforms::instanceMatrixLocation + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void*)(sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(location, 1);
     }
+}
 
-    glUniform1i(glGetUniformLocation(shader3DProgram, "material.hasTexture"), !textures.empty() ? 1 : 0);
-
-    // Apply lights from your Light system
-    int lightIndex = 0;
-    for (Light* light : Light::lights)
+void Renderer::unbindInstanceAttributes()
+{
+    // Mesh VAOs are shared with regular draws, leave them as they were
+    for (unsigned int column = 0; column < 4; column++)
     {
-        light->apply(shader3DProgram);
-        lightIndex++;
-        if (lightIndex >= 8) break;
+        glDisableVertexAttribArray(LitShaderUniforms::instanceMatrixLocation + column);
     }
+}
+
+const LitShaderUniforms& Renderer::getLitUniforms()
+{
+    return litUniforms;
+}
 
-    // Set view position (camera position)
-    glUniform3f(glGetUniformLocation(shader3DProgram, "viewPos"), 0.0f, 0.0f, 3.0f);
+void Renderer::setShader3DProgram(const ShaderProgram& program)
+{
+    shader3DProgram = program;
 
-    // Draw the mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexQty, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    litUniforms.model = program.getUniform("model");
+    litUniforms.materialIndex = program.getUniform("materialIndex");
+    litUniforms.instanced = program.getUniform("instanced");
+    UniformBuffers::bindProgram(program);
 
-    // Unbind textures
-    for (unsigned int i = 0; i < textures.size(); i++)
+    const char* textureNames[TextureType_Count] = {
+        "material.texture_diffuse", "material.texture_specular", "material.texture_normal", "material.texture_height"
+    };
+    for (unsigned int type = 0; type < TextureType_Count; type++)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        for (unsigned int number = 0; number < LitShaderUniforms::maxTexturesPerType; number++)
+        {
+            litUniforms.textureUnits[type][number] = program.getTextureUnit(textureNames[type] + to_string(number + 1));
+        }
     }
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glUseProgram(0);
+const ShaderProgram& Renderer::getShader3DProgram()
+{
+    return shader3DProgram;
 }
 
 void Renderer::bindTexture(unsigned int textureID)
 {
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    // 2D shaders sample from unit 0
+    GLStateCache::bindTexture(0, textureID);
 }
 
 void Renderer::getTextureSize(unsigned int textureID, int* width, int* height)
 {
+    unordered_map<unsigned int, glm::ivec2>::const_iterator it = textureSizes.find(textureID);
+    if (it != textureSizes.end())
+    {
+        *width = it->second.x;
+        *height = it->second.y;
+        return;
+    }
+
     bindTexture(textureID);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, width);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, height);
-    bindTexture(0);
+    setTextureSize(textureID, *width, *height);
+}
+
+void Renderer::setTextureSize(unsigned int textureID, int width, int height)
+{
+    textureSizes[textureID] = glm::ivec2(width, height);
+}
+
+void Renderer::forgetTextureSize(unsigned int textureID)
+{
+    textureSizes.erase(textureID);
 }
 
 void Renderer::setModelMatrix(glm::mat4 newModelMatrix)
@@ -267,6 +391,11 @@ glm::mat4 Renderer::getViewMatrix()
     return viewMatrix;
 }
 
+glm::mat4 Renderer::getProjectionMatrix()
+{
+    return projMatrix;
+}
+
 void Renderer::setViewMatrix(glm::mat4 newViewMatrix)
 {
     viewMatrix = newViewMatrix;
@@ -283,9 +412,10 @@ void Renderer::genVertexBuffer(unsigned int& VBO, unsigned int& VAO, float verti
     glGenVertexArrays(id, &VAO);
     glGenBuffers(id, &VBO);
 
-    glBindVertexArray(VAO);
+    GLStateCache::bindVertexArray(VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLStateCache::bindBuffer(GL_ARRAY_BUFFER, VBO);
+    RenderStats::countBufferAllocation();
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * qty * 8, vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), static_cast<void*>(0));
@@ -301,15 +431,16 @@ void Renderer::genVertexBuffer(unsigned int& VBO, unsigned int& VAO, float verti
 void Renderer::genIndexBuffer(unsigned int& IBO, unsigned int indices[], unsigned int id, unsigned int qty)
 {
     glGenBuffers(id, &IBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    GLStateCache::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    RenderStats::countBufferAllocation();
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * qty, indices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
 void Renderer::deleteBuffers(unsigned int& VBO, unsigned int& IBO, unsigned int& EBO, unsigned int id)
 {
+    GLStateCache::forgetVertexArray(VBO);
+    GLStateCache::forgetBuffer(IBO);
+    GLStateCache::forgetBuffer(EBO);
     glDeleteVertexArrays(id, &VBO);
     glDeleteBuffers(id, &IBO);
     glDeleteBuffers(id, &EBO);
@@ -1,8 +1,12 @@
 #pragma once
+#include <unordered_map>
+
 #include "Core/deps.h"
 #include "Rendering/Light/Material.h"
 #include "Entities/Entity2.h"
 #include "Importer/Mesh.h"
+#include "Rendering/GeometryArena.h"
+#include "Rendering/ShaderProgram.h"
 
 #ifdef _WIN32 // Directory is different in linux
 #include <glm.hpp>
@@ -33,6 +37,25 @@ namespace gllib
         unsigned int EBO; // Element Buffer Object
     };
 
+    /// <summary>
+    /// Uniforms of the lighting program, resolved once when the program is assigned to the renderer
+    /// </summary>
+    struct DLLExport LitShaderUniforms
+    {
+        static const unsigned int maxTexturesPerType = 4;
+        static const unsigned int maxTextureUnits = 16;
+        // First location of the per instance world matrix, it takes 4
+        static const unsigned int instanceMatrixLocation = 5;
+
+        // Camera, lights and materials live in uniform buffers, these are the only per draw uniforms
+        UniformHandle model;
+        UniformHandle materialIndex;
+        UniformHandle instanced;
+
+        // Texture unit of "material.texture_<type><n>", -1 if the program doesn't use it
+        int textureUnits[TextureType_Count][maxTexturesPerType];
+    };
+
     /// <summary>
     /// Fully static class
     /// </summary>
@@ -42,14 +65,33 @@ namespace gllib
         static glm::mat4 projMatrix;
         static glm::mat4 modelMatrix;
         static glm::mat4 viewMatrix;
+
+        inline static ShaderProgram shader3DProgram;
+        inline static LitShaderUniforms litUniforms = {};
+        inline static std::unordered_map<unsigned int, glm::ivec2> textureSizes;
+        // u_MVP of the last program setUpMVP ran with
+        inline static unsigned int mvpProgram = 0;
+        inline static UniformHandle mvpUniform;
         
         static void glClearError();
         static bool glLogCall(const char* function, const char* file, int line);
 
     public:
-        inline static glm::uint shader3DProgram = 0;
+        /// <summary>
+        /// Sets the program used for 3D lit draws and caches all the uniform handles it needs
+        /// </summary>
+        static void setShader3DProgram(const ShaderProgram& program);
+        static const ShaderProgram& getShader3DProgram();
+
         static void setUpVertexAttributes();
+        /// <summary>
+        /// Sets u_MVP on the bound program, the reflected handle is fetched again only when the program changes
+        /// </summary>
         static void setUpMVP();
+        /// <summary>
+        /// Drops what is cached for a deleted program, its id can be given out again
+        /// </summary>
+        static void forgetProgram(unsigned int program);
 
         static unsigned int createVertexArrayObject();
         static unsigned int createVertexBufferObject(const float vertexData[], GLsizei bufferSize);
@@ -58,20 +100,62 @@ namespace gllib
         static RenderData createRenderData(const float vertexData[], GLsizei vertexDataSize, const int index[],
                                            GLsizei indexSize);
         static void destroyRenderData(RenderData rData);
+        /// <summary>
+        /// Overwrites the vertices of existing render data, the size must match the one it was created with
+        /// </summary>
+        static void updateVertexBuffer(RenderData rData, const float vertexData[], GLsizei vertexDataSize);
 
         static void drawElements(RenderData rData, GLsizei indexSize);
         static void drawTexture(RenderData rData, GLsizei indexSize, unsigned int textureID);
         static void drawEntity3D(unsigned& VAO, unsigned indexQty, Material& material, glm::mat4 trans);
+        static void drawEntity3D(const GeometryAllocation& geometry, Material& material, glm::mat4 trans);
         static void drawModel3D(unsigned& VAO, unsigned indexQty, glm::mat4 trans, std::vector<Texture>& textures, Material* material = nullptr);
+        /// <summary>
+        /// Draws the mesh once per matrix in instanceBuffer, each one applied on top of trans
+        /// </summary>
+        static void drawModel3DInstanced(unsigned& VAO, unsigned indexQty, glm::mat4 trans, std::vector<Texture>& textures,
+                                         Material* material, unsigned int instanceBuffer, unsigned int instanceCount);
+        /// <summary>
+        /// Lit draw of a mesh wherever it lives, its own VAO or a range of the geometry arena
+        /// </summary>
+        static void drawGeometry3D(const GeometryAllocation& geometry, glm::mat4 trans, std::vector<Texture>& textures,
+                                   Material* material = nullptr, unsigned int instanceBuffer = 0,
+                                   unsigned int instanceCount = 0);
+
+        /// <summary>
+        /// Updates the frame and light uniform buffers, only what changed is uploaded
+        /// </summary>
+        static void applyLitFrameUniforms();
+        /// <summary>
+        /// Puts the material, or the default one if null, on slot 0 of the material buffer. The 3D program must be bound.
+        /// </summary>
+        static void applyLitMaterial(const Material* material, bool hasTexture);
+        /// <summary>
+        /// Fills the texture that goes on every unit of the 3D program and returns a mask of the used units
+        /// </summary>
+        static unsigned int resolveTextureUnits(const std::vector<Texture>& textures,
+                                                unsigned int unitTextures[LitShaderUniforms::maxTextureUnits]);
+        static const LitShaderUniforms& getLitUniforms();
+        /// <summary>
+        /// Points the instance matrix attributes of the bound VAO to a buffer of mat4, one per instance
+        /// </summary>
+        static void bindInstanceAttributes(unsigned int instanceBuffer);
+        static void unbindInstanceAttributes();
 
         static void bindTexture(unsigned int textureID);
+        /// <summary>
+        /// Answered from a CPU cache filled when textures are loaded, GL is only queried for textures made elsewhere
+        /// </summary>
         static void getTextureSize(unsigned int textureID, int* width, int* height);
+        static void setTextureSize(unsigned int textureID, int width, int height);
+        static void forgetTextureSize(unsigned int textureID);
 
         static void setModelMatrix(glm::mat4 newModelMatrix);
         static void setOrthoProjectionMatrix(float width, float height);
         static void setPerspectiveProjectionMatrix(float fov, float aspectRatio, float nearPlane, float farPlane);
 
         static glm::mat4 getViewMatrix();
+        static glm::mat4 getProjectionMatrix();
         static void setViewMatrix(glm::mat4 newViewMatrix);
 
         static void clear();
@@ -2,9 +2,12 @@
 
 #include "Importer/loader.h"
 #include "Light/Material.h"
+#include "Rendering/GLStateCache.h"
+#include "Rendering/renderer.h"
 #include <iostream>
 #include <vector>
-#include <gtc/type_ptr.inl>
+#include <gtc/type_ptr.hpp>
+#include "Rendering/RenderStats.h"
 
 using namespace gllib;
 using namespace std;
@@ -13,6 +16,7 @@ using namespace std;
 unsigned int Shader::shapeShaderProgram = 0;
 unsigned int Shader::textureShaderProgram = 0;
 unsigned int Shader::currentShaderProgram = 0;
+unordered_map<unsigned int, ShaderProgram> Shader::programs;
 
 string Shader::getShaderType(unsigned int type)
 {
@@ -61,9 +65,18 @@ unsigned int Shader::compileShader(unsigned int type, string source)
     return id;
 }
 
+int Shader::getUniformLocation(unsigned int shaderProgram, const char* name)
+{
+    // Prefer the locations reflected at link time over a driver round trip
+    const ShaderProgram* program = getProgram(shaderProgram);
+    if (program)
+        return program->getUniform(name).location;
+    return glGetUniformLocation(shaderProgram, name);
+}
+
 // Public
 
-unsigned int Shader::createShader(const char* vertexShader, const char* fragmentShader)
+ShaderProgram Shader::createShader(const char* vertexShader, const char* fragmentShader)
 {
     cout << "Creating Shader Program..." << endl;
     unsigned int program = glCreateProgram();
@@ -78,7 +91,7 @@ unsigned int Shader::createShader(const char* vertexShader, const char* fragment
         if (fs != 0)
             glDeleteShader(fs);
         glDeleteProgram(program);
-        return 0;
+        return ShaderProgram();
     }
 
     glAttachShader(program, vs);
@@ -102,7 +115,7 @@ unsigned int Shader::createShader(const char* vertexShader, const char* fragment
             cout << "Failed to link shader program: Unknown error" << endl;
         }
         glDeleteProgram(program);
-        return 0;
+        return ShaderProgram();
     }
 
     glValidateProgram(program);
@@ -110,12 +123,18 @@ unsigned int Shader::createShader(const char* vertexShader, const char* fragment
     glDeleteShader(vs);
     glDeleteShader(fs);
     cout << "(" << program << ") Shader program created!" << endl;
-    return program;
+
+    ShaderProgram shaderProgram(program);
+    programs[program] = shaderProgram;
+    return shaderProgram;
 }
 
 void Shader::destroyShader(unsigned int program)
 {
     cout << "(" << program << ") Unloading shader..." << endl;
+    programs.erase(program);
+    GLStateCache::forgetProgram(program);
+    Renderer::forgetProgram(program);
     glDeleteProgram(program);
     cout << "Shader unloaded!" << endl;
 }
@@ -127,32 +146,37 @@ const char* Shader::loadShader(string filePath)
 
 void Shader::setShaderProgram(unsigned int shaderProgram)
 {
-    glUseProgram(shaderProgram);
+    GLStateCache::useProgram(shaderProgram);
     currentShaderProgram = shaderProgram;
 }
 
 void Shader::setVec3(unsigned int shaderProgram, const char* name, float x, float y, float z)
 {
-    int location = glGetUniformLocation(shaderProgram, name);
+    GLStateCache::useProgram(shaderProgram);
+    int location = getUniformLocation(shaderProgram, name);
     if (location == -1)
     {
         cout << "Warning: Uniform '" << name << "' not found in shader program " << shaderProgram << endl;
     }
+    RenderStats::countUniformUpload();
     glUniform3f(location, x, y, z);
 }
 
 void Shader::setMat4(unsigned int programID, const char* name, const glm::mat4& matrix)
 {
-    int location = glGetUniformLocation(programID, name);
+    GLStateCache::useProgram(programID);
+    int location = getUniformLocation(programID, name);
+    RenderStats::countUniformUpload();
     glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
 }
 
 void Shader::setFloat(unsigned int shaderProgram, const char* name, float value)
 {
-    glUseProgram(shaderProgram);
-    GLint location = glGetUniformLocation(shaderProgram, name);
+    GLStateCache::useProgram(shaderProgram);
+    GLint location = getUniformLocation(shaderProgram, name);
     if (location != -1)
     {
+        RenderStats::countUniformUpload();
         glUniform1f(location, value);
     }
     else
@@ -172,3 +196,9 @@ unsigned int Shader::getCurrentShaderProgram()
 {
     return currentShaderProgram;
 }
+
+const ShaderProgram* Shader::getProgram(unsigned int shaderProgram)
+{
+    unordered_map<unsigned int, ShaderProgram>::const_iterator it = programs.find(shaderProgram);
+    return it != programs.end() ? &it->second : nullptr;
+}
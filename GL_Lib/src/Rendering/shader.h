@@ -5,6 +5,9 @@
 #include "glm.hpp"
 #include <gtc/matrix_transform.hpp>
 #include <iostream>
+#include <unordered_map>
+
+#include "ShaderProgram.h"
 
 namespace gllib
 {
@@ -18,13 +21,16 @@ namespace gllib
     private:
         static std::string getShaderType(unsigned int type);
         static unsigned int compileShader(unsigned int type, std::string source);
+        static int getUniformLocation(unsigned int shaderProgram, const char* name);
+
+        static std::unordered_map<unsigned int, ShaderProgram> programs;
 
     public:
         static unsigned int currentShaderProgram;
         static unsigned int shapeShaderProgram;
         static unsigned int textureShaderProgram;
 
-        static unsigned int createShader(const char* vertexShader, const char* fragmentShader);
+        static ShaderProgram createShader(const char* vertexShader, const char* fragmentShader);
         static void destroyShader(unsigned int program);
         static const char* loadShader(std::string filePath);
         static void setShaderProgram(unsigned int shaderProgram);
@@ -33,5 +39,9 @@ namespace gllib
         static void setFloat(unsigned int shaderProgram, const char* name, float value);
         static void setMaterial(unsigned int shaderProgram, const Material material);
         static unsigned int getCurrentShaderProgram();
+        /// <summary>
+        /// Returns the reflection of a program created through createShader, nullptr if unknown
+        /// </summary>
+        static const ShaderProgram* getProgram(unsigned int shaderProgram);
     };
 };
@@ -5,14 +5,27 @@
 using namespace gllib;
 using namespace std;
 
-Window::Window(int width, int height, string title) {
+Window::Window(int width, int height, string title, bool headless) : headless(headless), offscreenWidth(width),
+	offscreenHeight(height), framebuffer(0), colorBuffer(0), depthBuffer(0) {
+	if (headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		// The null platform has no native GL, its only context backend is OSMesa
+		if (glfwGetPlatform() == GLFW_PLATFORM_NULL)
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+	}
 	window = glfwCreateWindow(width, height, title.c_str(), NULL, NULL);
-	cout << "Window created!\n";
+	glfwDefaultWindowHints();
+	cout << (headless ? "Headless window created!\n" : "Window created!\n");
 	//Renderer::setOrthoProjectionMatrix(static_cast<float>(width), static_cast<float>(height));
 	Renderer::setPerspectiveProjectionMatrix(45.0f, static_cast<float>(width) / static_cast<float>(height), 0.1f, 100.0f);
 }
 
 Window::~Window() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
 	// We just close it, we will be using glfwTerminate to clean up the resources.
 	glfwSetWindowShouldClose(window, true);
 	cout << "Window closed.\n";
@@ -25,7 +38,50 @@ void Window::makeContextCurrent() {
 }
 
 void Window::swapBuffers() {
-	glfwSwapBuffers(window);
+	if (headless)
+		glFlush();
+	else
+		glfwSwapBuffers(window);
+}
+
+bool Window::createOffscreenTarget() {
+	if (!headless || framebuffer != 0)
+		return framebuffer != 0;
+
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, offscreenWidth, offscreenHeight);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, offscreenWidth, offscreenHeight);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		cout << "Failed to create the offscreen framebuffer!\n";
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return false;
+	}
+
+	// Nothing else binds framebuffers, it stays the render target for the whole run
+	glViewport(0, 0, offscreenWidth, offscreenHeight);
+	return true;
+}
+
+bool Window::getIsHeadless() {
+	return headless;
+}
+
+void Window::readPixels(vector<unsigned char>& pixels) {
+	const int width = getWidth();
+	const int height = getHeight();
+	pixels.resize(static_cast<size_t>(width) * height * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 }
 
 GLFWwindow* Window::getReference() {
@@ -33,12 +89,16 @@ GLFWwindow* Window::getReference() {
 }
 
 int Window::getWidth() {
+	if (headless)
+		return offscreenWidth;
 	int width, height;
 	glfwGetWindowSize(window, &width, &height);
 	return width;
 }
 
 int Window::getHeight() {
+	if (headless)
+		return offscreenHeight;
 	int width, height;
 	glfwGetWindowSize(window, &width, &height);
 	return height;
@@ -52,6 +112,10 @@ bool Window::getShouldClose() {
 	return glfwWindowShouldClose(window);
 }
 
+void Window::setShouldClose(bool shouldClose) {
+	glfwSetWindowShouldClose(window, shouldClose);
+}
+
 void Window::setTitle(string title) {
 	glfwSetWindowTitle(window, title.c_str());
 }
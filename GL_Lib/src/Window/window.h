@@ -2,17 +2,25 @@
 #include "Core/deps.h"
 
 #include <iostream>
+#include <vector>
 
 namespace gllib {
 
 	class DLLExport Window {
 	private:
 		GLFWwindow* window;
+		bool headless;
+		int offscreenWidth;
+		int offscreenHeight;
+		unsigned int framebuffer;
+		unsigned int colorBuffer;
+		unsigned int depthBuffer;
 	public:
 		/// <summary>
-		/// The constructor creates a window and opens it
+		/// The constructor creates a window and opens it.
+		/// A headless window is never shown, it renders into a framebuffer of the given size once createOffscreenTarget is called.
 		/// </summary>
-		Window(int width, int height, std::string title);
+		Window(int width, int height, std::string title, bool headless = false);
 		/// <summary>
 		/// Destructor simply closes the window the function glfwTerminate should take care of uninitializing it later
 		/// </summary>
@@ -23,9 +31,18 @@ namespace gllib {
 		/// </summary>
 		void makeContextCurrent();
 		/// <summary>
-		/// Swaps render buffers
+		/// Swaps render buffers, headless windows only flush since nothing is presented
 		/// </summary>
 		void swapBuffers();
+		/// <summary>
+		/// Creates the offscreen framebuffer of a headless window and leaves it bound, needs GLAD loaded
+		/// </summary>
+		bool createOffscreenTarget();
+		bool getIsHeadless();
+		/// <summary>
+		/// Reads the current frame as RGBA rows from the bottom
+		/// </summary>
+		void readPixels(std::vector<unsigned char>& pixels);
 
 		/// <summary>
 		/// Returns the variable window
@@ -48,6 +65,7 @@ namespace gllib {
 		/// Returns if the user has tried to close the window manually
 		/// </summary>
 		bool getShouldClose();
+		void setShouldClose(bool shouldClose);
 		/// <summary>
 		/// Changes the title of the window to a specific string
 		/// </summary>
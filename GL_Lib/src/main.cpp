@@ -29,16 +29,10 @@ Game::Game() {
     cout << "Game created!\n";
 
    
-    gllib::Transform trs;
-    trs.position = { 100.0f, 100.0f, 0.0f };
-    trs.rotationQuat = { 0.0f, 0.0f, 0.0f, 0.0f };
-    trs.scale = { 57.74f, 50.0f, 0.0f };
+    gllib::Transform trs({ 100.0f, 100.0f, 0.0f }, { 57.74f, 50.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f });
     triangle = new gllib::Triangle(trs, { 0.85f, 0.2f, 0.4f, 1.0f });
 
-    gllib::Transform trs2;
-    trs2.position = { 200.0f, 200.0f, 0.0f };
-    trs2.rotationQuat = { 0.0f, 0.0f, 0.0f, 0.0f };
-    trs2.scale = { 100.0f, 100.0f, 0.0f };
+    gllib::Transform trs2({ 200.0f, 200.0f, 0.0f }, { 100.0f, 100.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f });
     rectangle = new gllib::Rectangle(trs2, { 1.0f, 1.0f, 1.0f, 1.0f });
 
     movingRight = false;
@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Importer/ModelLoader.h"
+#include "Math/transform.h"
+#include "Math/TransformHierarchy.h"
+#include "Rendering/BSP/BSPSystem.h"
+#include "Rendering/Frustum.h"
+#include "Rendering/FrustumCulling.h"
+
+#include <gtc/matrix_transform.hpp>
+
+using namespace std;
+using namespace gllib;
+
+// Hot path fixtures that run without a GL context. Each fixture is timed at every size from 10 to 1M elements,
+// results are written as JSON (ns per element, median of the repetitions) so variants can be compared run to run.
+
+namespace
+{
+    struct Settings
+    {
+        size_t minSize = 10;
+        size_t maxSize = 1000000;
+        int repetitions = 7;
+        double minSeconds = 0.05; // Per repetition, small sizes loop until they reach it
+        string filter;
+        string output;
+    };
+
+    struct Result
+    {
+        string fixture;
+        size_t size;
+        long long iterations;
+        double medianNsPerElement;
+        double minNsPerElement;
+    };
+
+    // Keeps results alive so the optimizer can't drop the measured work
+    volatile unsigned long long sink = 0;
+
+    /// <summary>
+    /// A fixture builds its data for a size once, then returns the work to time
+    /// </summary>
+    struct Fixture
+    {
+        string name;
+        function<function<void()>(size_t size, mt19937& random)> setUp;
+    };
+
+    glm::vec3 randomVec3(mt19937& random, float range)
+    {
+        uniform_real_distribution<float> distribution(-range, range);
+        return glm::vec3(distribution(random), distribution(random), distribution(random));
+    }
+
+    glm::mat4 benchViewProjection()
+    {
+        const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+        const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        return projection * view;
+    }
+
+    Transform makeTransform(mt19937& random)
+    {
+        Transform transform;
+        transform.setPosition(randomVec3(random, 10.0f));
+        transform.setRotation(randomVec3(random, 180.0f));
+        transform.localAABBMin = glm::vec3(-1.0f);
+        transform.localAABBMax = glm::vec3(1.0f);
+        return transform;
+    }
+
+    /// <summary>
+    /// Tree with 4 children per node, laid out breadth first like an imported FBX hierarchy
+    /// </summary>
+    void buildHierarchy(vector<Transform>& nodes, size_t size, mt19937& random)
+    {
+        nodes.clear();
+        nodes.reserve(size);
+        for (size_t i = 0; i < size; i++)
+            nodes.push_back(makeTransform(random));
+        for (size_t i = 1; i < size; i++)
+            nodes[(i - 1) / 4].addChild(&nodes[i]);
+    }
+
+    vector<Fixture> makeFixtures()
+    {
+        vector<Fixture> fixtures;
+
+        fixtures.push_back({"Frustum::isAABBInside", [](size_t size, mt19937& random)
+        {
+            auto frustum = make_shared<Frustum>(benchViewProjection());
+            auto mins = make_shared<vector<glm::vec3>>();
+            auto maxs = make_shared<vector<glm::vec3>>();
+            for (size_t i = 0; i < size; i++)
+            {
+                const glm::vec3 center = randomVec3(random, 200.0f);
+                const glm::vec3 extents = glm::abs(randomVec3(random, 5.0f)) + 0.1f;
+                mins->push_back(center - extents);
+                maxs->push_back(center + extents);
+            }
+            return function<void()>([frustum, mins, maxs]()
+            {
+                unsigned long long visible = 0;
+                for (size_t i = 0; i < mins->size(); i++)
+                    visible += frustum->isAABBInside((*mins)[i], (*maxs)[i]) ? 1 : 0;
+                sink += visible;
+            });
+        }});
+
+        // Same boxes as above through the batched kernel, once per path so they can be compared
+        for (FrustumCulling::Path path : {FrustumCulling::Path::Scalar, FrustumCulling::Path::SSE,
+                                          FrustumCulling::Path::AVX2})
+        {
+            if (path > FrustumCulling::getPath())
+                continue;
+
+            fixtures.push_back({string("FrustumCulling::cullAABBs/") + FrustumCulling::getPathName(path),
+                [path](size_t size, mt19937& random)
+            {
+                auto frustum = make_shared<Frustum>(benchViewProjection());
+                auto boxes = make_shared<CullingBoxes>();
+                auto mask = make_shared<vector<uint64_t>>();
+                for (size_t i = 0; i < size; i++)
+                    boxes->add(randomVec3(random, 200.0f), glm::abs(randomVec3(random, 5.0f)) + 0.1f);
+                return function<void()>([frustum, boxes, mask, path]()
+                {
+                    FrustumCulling::setMaxPath(path);
+                    sink += FrustumCulling::cullAABBs(*frustum, *boxes, *mask);
+                    FrustumCulling::setMaxPath(FrustumCulling::Path::AVX2);
+                });
+            }});
+        }
+
+        fixtures.push_back({"Frustum::extractFromMatrix", [](size_t size, mt19937& random)
+        {
+            auto matrices = make_shared<vector<glm::mat4>>();
+            const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+            for (size_t i = 0; i < size; i++)
+                matrices->push_back(projection * glm::lookAt(randomVec3(random, 100.0f), glm::vec3(0.0f),
+                                                             glm::vec3(0.0f, 1.0f, 0.0f)));
+            return function<void()>([matrices]()
+            {
+                Frustum frustum;
+                for (const glm::mat4& matrix : *matrices)
+                {
+                    frustum.extractFromMatrix(matrix);
+                    sink += frustum.isAABBInside(glm::vec3(-1.0f), glm::vec3(1.0f)) ? 1 : 0;
+                }
+            });
+        }});
+
+        fixtures.push_back({"Transform::updateTRSAndAABB", [](size_t size, mt19937& random)
+        {
+            auto nodes = make_shared<vector<Transform>>();
+            buildHierarchy(*nodes, size, random);
+            return function<void()>([nodes]()
+            {
+                // Every frame of a moving root: the whole tree is dirty
+                Transform& root = nodes->front();
+                root.setPosition(root.getPosition() + glm::vec3(0.001f));
+                root.updateTRSAndAABB();
+                sink += static_cast<unsigned long long>(root.getWorldAABBMax().x);
+            });
+        }});
+
+        fixtures.push_back({"TransformHierarchy::update", [](size_t size, mt19937& random)
+        {
+            auto nodes = make_shared<vector<Transform>>();
+            buildHierarchy(*nodes, size, random);
+            auto hierarchy = make_shared<TransformHierarchy>();
+            hierarchy->build(&nodes->front());
+            return function<void()>([nodes, hierarchy]()
+            {
+                // Same work as Transform::updateTRSAndAABB above, flattened
+                Transform& root = nodes->front();
+                root.setPosition(root.getPosition() + glm::vec3(0.001f));
+                hierarchy->update();
+                sink += static_cast<unsigned long long>(root.getWorldAABBMax().x);
+            });
+        }});
+
+        fixtures.push_back({"TransformHierarchy::update/oneLeaf", [](size_t size, mt19937& random)
+        {
+            auto nodes = make_shared<vector<Transform>>();
+            buildHierarchy(*nodes, size, random);
+            auto hierarchy = make_shared<TransformHierarchy>();
+            hierarchy->build(&nodes->front());
+            hierarchy->update();
+            return function<void()>([nodes, hierarchy]()
+            {
+                // A single animated node: only its path to the root is recomputed
+                Transform& leaf = nodes->back();
+                leaf.setPosition(leaf.getPosition() + glm::vec3(0.001f));
+                hierarchy->update();
+                sink += static_cast<unsigned long long>(nodes->front().getWorldAABBMax().x);
+            });
+        }});
+
+        fixtures.push_back({"TransformHierarchy::update/static", [](size_t size, mt19937& random)
+        {
+            auto nodes = make_shared<vector<Transform>>();
+            buildHierarchy(*nodes, size, random);
+            auto hierarchy = make_shared<TransformHierarchy>();
+            hierarchy->build(&nodes->front());
+            hierarchy->update();
+            return function<void()>([nodes, hierarchy]()
+            {
+                hierarchy->update();
+                sink += static_cast<unsigned long long>(nodes->front().getWorldAABBMax().x);
+            });
+        }});
+
+        fixtures.push_back({"Transform::getTransformMatrix", [](size_t size, mt19937& random)
+        {
+            auto nodes = make_shared<vector<Transform>>();
+            buildHierarchy(*nodes, size, random);
+            return function<void()>([nodes]()
+            {
+                // Dirty root, then every node pulls its world matrix through its parents
+                Transform& root = nodes->front();
+                root.setPosition(root.getPosition() + glm::vec3(0.001f));
+                float total = 0.0f;
+                for (const Transform& node : *nodes)
+                    total += node.getTransformMatrix()[3].x;
+                sink += static_cast<unsigned long long>(total != 0.0f);
+            });
+        }});
+
+        fixtures.push_back({"BSPSystem::aabbFullyOpposite", [](size_t size, mt19937& random)
+        {
+            auto mins = make_shared<vector<glm::vec3>>();
+            auto maxs = make_shared<vector<glm::vec3>>();
+            for (size_t i = 0; i < size; i++)
+            {
+                const glm::vec3 center = randomVec3(random, 100.0f);
+                const glm::vec3 extents = glm::abs(randomVec3(random, 5.0f)) + 0.1f;
+                mins->push_back(center - extents);
+                maxs->push_back(center + extents);
+            }
+            return function<void()>([mins, maxs]()
+            {
+                BSPPlane plane;
+                plane.normal = glm::vec3(1.0f, 0.0f, 0.0f);
+                unsigned long long culled = 0;
+                for (size_t i = 0; i < mins->size(); i++)
+                    culled += BSPSystem::aabbFullyOpposite((*mins)[i], (*maxs)[i], plane, true) ? 1 : 0;
+                sink += culled;
+            });
+        }});
+
+        fixtures.push_back({"ModelLoader::convertMesh", [](size_t size, mt19937& random)
+        {
+            // Synthetic triangle soup with every attribute the importer reads, size is the vertex count
+            auto mesh = make_shared<aiMesh>();
+            const unsigned int vertexCount = static_cast<unsigned int>(max<size_t>(size / 3 * 3, 3));
+            mesh->mNumVertices = vertexCount;
+            mesh->mVertices = new aiVector3D[vertexCount];
+            mesh->mNormals = new aiVector3D[vertexCount];
+            mesh->mTangents = new aiVector3D[vertexCount];
+            mesh->mBitangents = new aiVector3D[vertexCount];
+            mesh->mTextureCoords[0] = new aiVector3D[vertexCount];
+            mesh->mNumUVComponents[0] = 2;
+            for (unsigned int i = 0; i < vertexCount; i++)
+            {
+                const glm::vec3 position = randomVec3(random, 50.0f);
+                mesh->mVertices[i] = aiVector3D(position.x, position.y, position.z);
+                mesh->mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+                mesh->mTangents[i] = aiVector3D(1.0f, 0.0f, 0.0f);
+                mesh->mBitangents[i] = aiVector3D(0.0f, 0.0f, 1.0f);
+                mesh->mTextureCoords[0][i] = aiVector3D(position.x, position.z, 0.0f);
+            }
+
+            mesh->mNumFaces = vertexCount / 3;
+            mesh->mFaces = new aiFace[mesh->mNumFaces];
+            for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            {
+                mesh->mFaces[i].mNumIndices = 3;
+                mesh->mFaces[i].mIndices = new unsigned int[3]{i * 3, i * 3 + 1, i * 3 + 2};
+            }
+
+            return function<void()>([mesh]()
+            {
+                const MeshData data = ModelLoader::convertMesh(mesh.get());
+                sink += data.indices.size();
+            });
+        }});
+
+        return fixtures;
+    }
+
+    Result run(const Fixture& fixture, size_t size, const Settings& settings)
+    {
+        mt19937 random(1234u + static_cast<unsigned int>(size));
+        const function<void()> work = fixture.setUp(size, random);
+
+        // Calibrate the iterations per repetition on a warm run
+        long long iterations = 1;
+        while (true)
+        {
+            const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (long long i = 0; i < iterations; i++)
+                work();
+            const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (seconds >= settings.minSeconds || iterations >= (1ll << 30))
+                break;
+            iterations *= seconds > 0.0 ? max(2ll, static_cast<long long>(settings.minSeconds / seconds)) : 10;
+        }
+
+        vector<double> nsPerElement;
+        for (int repetition = 0; repetition < settings.repetitions; repetition++)
+        {
+            const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (long long i = 0; i < iterations; i++)
+                work();
+            const double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+            nsPerElement.push_back(ns / (static_cast<double>(iterations) * size));
+        }
+        sort(nsPerElement.begin(), nsPerElement.end());
+
+        Result result;
+        result.fixture = fixture.name;
+        result.size = size;
+        result.iterations = iterations;
+        result.medianNsPerElement = nsPerElement[nsPerElement.size() / 2];
+        result.minNsPerElement = nsPerElement.front();
+        return result;
+    }
+
+    string toJson(const vector<Result>& results)
+    {
+        ostringstream json;
+        json << "{\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& result = results[i];
+            json << "    {\"fixture\": \"" << result.fixture << "\", \"size\": " << result.size
+                << ", \"iterations\": " << result.iterations
+                << ", \"medianNsPerElement\": " << result.medianNsPerElement
+                << ", \"minNsPerElement\": " << result.minNsPerElement << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+        return json.str();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--min-size") == 0 && hasValue)
+            settings.minSize = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--max-size") == 0 && hasValue)
+            settings.maxSize = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--repetitions") == 0 && hasValue)
+            settings.repetitions = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--min-time") == 0 && hasValue)
+            settings.minSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && hasValue)
+            settings.filter = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+            settings.output = argv[++i];
+        else
+        {
+            cout << "Usage: glLib_microbench [--min-size N] [--max-size N] [--repetitions N] [--min-time seconds]"
+                " [--filter text] [--out file.json]\n";
+            return 1;
+        }
+    }
+
+    vector<Result> results;
+    for (const Fixture& fixture : makeFixtures())
+    {
+        if (!settings.filter.empty() && fixture.name.find(settings.filter) == string::npos)
+            continue;
+
+        for (size_t size = 10; size <= settings.maxSize; size *= 10)
+        {
+            if (size < settings.minSize)
+                continue;
+            results.push_back(run(fixture, size, settings));
+            // Progress goes to stderr so stdout stays valid JSON
+            cerr << fixture.name << " " << size << ": " << results.back().medianNsPerElement << " ns/element\n";
+        }
+    }
+
+    const string json = toJson(results);
+    if (settings.output.empty())
+    {
+        cout << json;
+        return 0;
+    }
+
+    ofstream file(settings.output);
+    if (!file.is_open())
+    {
+        cout << "Failed to write benchmark results: " << settings.output << endl;
+        return 1;
+    }
+    file << json;
+    return 0;
+}
@@ -5,71 +5,76 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-    
-    sampler2D texture_diffuse1;
-    sampler2D texture_specular1;
-    bool hasTexture;
+#define MAX_POINT_LIGHTS 8
+#define MAX_SPOT_LIGHTS 8
+#define MAX_MATERIALS 256
+
+struct MaterialInfo {
+    vec4 diffuse;
+    vec4 specular; // w = shininess
+    ivec4 flags; // x = hasTexture
 };
 
-struct Light {
-    float constant;
-    float linear;
-    float quadratic;
+struct PointLight {
+    vec4 position; // w = diffuseStrength
+    vec4 color; // w = specularStrength
+    vec4 attenuation; // constant, linear, quadratic
 };
 
 struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    
-    float innerCutOff;
-    float outerCutOff;
-    
-    float constant;
-    float linear;
-    float quadratic;
-    
-    float diffuseStrength;
-    float specularStrength;
+    vec4 position; // w = diffuseStrength
+    vec4 direction; // w = specularStrength
+    vec4 color;
+    vec4 cutOff; // x = inner, y = outer
+    vec4 attenuation; // constant, linear, quadratic
+};
+
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
+layout (std140) uniform LightData
+{
+    vec4 ambient;
+    ivec4 lightCounts; // x = point lights, y = spot lights
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    SpotLight spotLights[MAX_SPOT_LIGHTS];
+};
+
+layout (std140) uniform MaterialData
+{
+    MaterialInfo materials[MAX_MATERIALS];
+};
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
 };
 
 uniform Material material;
-uniform Light light;
-uniform SpotLight spotLight;
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 ambientStrength;
-uniform float diffuseStrength = 1.0; 
-uniform float specularStrength = 1.0;
+uniform int materialIndex;
 
-vec3 calcPointLight(vec3 lightPos, vec3 lightColor, Light light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
 {
-    vec3 lightDir = normalize(lightPos - fragPos);
+    vec3 lightDir = normalize(light.position.xyz - fragPos);
     
     // Diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
     
     // Specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     
     // Attenuation
-    float distance = length(lightPos - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    
-    // Get material colors
-    vec3 diffuseColor = material.hasTexture ? texture(material.texture_diffuse1, TexCoords).rgb : material.diffuse;
-    vec3 specularColor = material.hasTexture ? texture(material.texture_specular1, TexCoords).rgb : material.specular;
+    float distance = length(light.position.xyz - fragPos);
+    float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * (distance * distance));
     
     // Combine results
-    vec3 diffuse = diffuseStrength * diff * lightColor * diffuseColor;
-    vec3 specular = specularStrength * spec * lightColor * specularColor;
+    vec3 diffuse = light.position.w * diff * light.color.rgb * diffuseColor;
+    vec3 specular = light.color.w * spec * light.color.rgb * specularColor;
     
     diffuse *= attenuation;
     specular *= attenuation;
@@ -77,33 +82,29 @@ vec3 calcPointLight(vec3 lightPos, vec3 lightColor, Light light, vec3 normal, ve
     return (diffuse + specular);
 }
 
-vec3 calcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 calcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 lightDir = normalize(light.position.xyz - fragPos);
     
     // Check if lighting is inside the spotlight cone
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.innerCutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    float theta = dot(lightDir, normalize(-light.direction.xyz));
+    float epsilon = light.cutOff.x - light.cutOff.y;
+    float intensity = clamp((theta - light.cutOff.y) / epsilon, 0.0, 1.0);
     
     // Diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
     
     // Specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     
     // Attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    
-    // Get material colors
-    vec3 diffuseColor = material.hasTexture ? texture(material.texture_diffuse1, TexCoords).rgb : material.diffuse;
-    vec3 specularColor = material.hasTexture ? texture(material.texture_specular1, TexCoords).rgb : material.specular;
+    float distance = length(light.position.xyz - fragPos);
+    float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * (distance * distance));
     
     // Combine results
-    vec3 diffuse = light.diffuseStrength * diff * light.color * diffuseColor;
-    vec3 specular = light.specularStrength * spec * light.color * specularColor;
+    vec3 diffuse = light.position.w * diff * light.color.rgb * diffuseColor;
+    vec3 specular = light.direction.w * spec * light.color.rgb * specularColor;
     
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
@@ -114,20 +115,25 @@ vec3 calcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 void main()
 {
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     
     // Get material colors
-    vec3 diffuseColor = material.hasTexture ? texture(material.texture_diffuse1, TexCoords).rgb : material.diffuse;
+    MaterialInfo info = materials[materialIndex];
+    bool hasTexture = info.flags.x != 0;
+    vec3 diffuseColor = hasTexture ? texture(material.texture_diffuse1, TexCoords).rgb : info.diffuse.rgb;
+    vec3 specularColor = hasTexture ? texture(material.texture_specular1, TexCoords).rgb : info.specular.rgb;
+    float shininess = info.specular.w;
     
     // Ambient lighting
-    vec3 ambient = ambientStrength * diffuseColor;
+    vec3 result = ambient.rgb * diffuseColor;
     
-    // Point light contribution
-    vec3 pointLightContrib = calcPointLight(lightPos, lightColor, light, norm, FragPos, viewDir);
+    // Point lights contribution
+    for (int i = 0; i < lightCounts.x; i++)
+        result += calcPointLight(pointLights[i], norm, FragPos, viewDir, diffuseColor, specularColor, shininess);
     
-    // Spotlight contribution
-    vec3 spotLightContrib = calcSpotLight(spotLight, norm, FragPos, viewDir);
+    // Spotlights contribution
+    for (int i = 0; i < lightCounts.y; i++)
+        result += calcSpotLight(spotLights[i], norm, FragPos, viewDir, diffuseColor, specularColor, shininess);
     
-    vec3 result = ambient + pointLightContrib + spotLightContrib;
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
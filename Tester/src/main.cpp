@@ -54,33 +54,25 @@ Game::Game()
     cout << "Game created!\n";
 
 
-    Transform trs2;
-    trs2.position = {0, 0, 0.0f};
-    trs2.rotationQuat = {0.0f, 0.0f, 0.0f, 0.0f};
-    trs2.scale = {5.0f, 5.0f, 5.0f};
+    Transform trs2({0, 0, 0.0f}, {5.0f, 5.0f, 5.0f}, {0.0f, 0.0f, 0.0f, 0.0f});
     player = new Cube(trs2, new Material(Material::gold()));
 
-    glm::vec3 playerPos = trs2.position;
+    glm::vec3 playerPos = trs2.getPosition();
     playerPos.z -= 2.0f;
     glm::vec3 spotDirection = {0.0f, 0.0f, -1.0f};
     playerLight = new SpotLight(playerPos, spotDirection, {1.0f, 1.0f, 0.8f, 1.0f},
                                 5.0f, 55.0f, 1.0f, 0.0045f, 0.00075f);
 
-    Transform trs4;
-    trs4.position = {window->getWidth() * .5f, window->getHeight() * .95f, 3};
-    trs4.rotationQuat = {0.0f, 0.0f, 0.0f, 0.0f};
-    trs4.scale = {static_cast<float>(window->getWidth()), 80, 0};
+    Transform trs4({window->getWidth() * .5f, window->getHeight() * .95f, 3},
+                   {static_cast<float>(window->getWidth()), 80, 0}, {0.0f, 0.0f, 0.0f, 0.0f});
     floorCollision = new Rectangle(trs4, {0.8f, 0.0f, 1.0f, 0.5f});
 
-    Transform cubeTrs;
-    cubeTrs.position = {0.0f, 0.0f, -10.0f};
-    cubeTrs.rotationQuat = {10.0f, 10.0f, 10.0f, 10.0f};
-    cubeTrs.scale = {10.0f, 10.0f, 10.0f};
+    Transform cubeTrs({0.0f, 0.0f, -10.0f}, {10.0f, 10.0f, 10.0f}, {10.0f, 10.0f, 10.0f, 10.0f});
     cube = new Cube(cubeTrs, new Material(Material::bronze()));
 
-    trs2.position = {-5, 0, 0.0f};
+    trs2.setPosition({-5, 0, 0.0f});
 
-    pointLight = new PointLight(trs2.position, {1.0f, 1.0f, 1.0f, 1.0f}, 1.0f, 0.0f, 0.0f);
+    pointLight = new PointLight(trs2.getPosition(), {1.0f, 1.0f, 1.0f, 1.0f}, 1.0f, 0.0f, 0.0f);
     ambientLight = new AmbientLight({1.0f, 1.0f, 1.0f}, 0.2f);
     collisionManager = new gllib::collisionManager({static_cast<Entity*>(floorCollision)});
 
@@ -122,8 +114,8 @@ void Game::init()
     }
 
     model1 = new Model("models/wall.fbx", false);
-    model1->transform.scale *= .1;
-    model1->transform.position = {0.0f, 0.0f, 0.0f};
+    model1->transform.setScale(model1->transform.getScale() * .1f);
+    model1->transform.setPosition({0.0f, 0.0f, 0.0f});
     glm::vec3 rotationEuler = {0.0f, 0.0f, 90.0f};
     model1->transform.setRotation(rotationEuler);
 
@@ -132,10 +124,12 @@ void Game::init()
 
     // PLANOS NO HARDCODEADOS
     bspSystem.buildBSP();
+    // The scene is about what the wall hides
+    bspSystem.setCullOppositeSides(true);
     
     
-    model2->transform.scale *= .5;
-    model2->transform.position = {-20.0f, 0.0f, 0.0f};
+    model2->transform.setScale(model2->transform.getScale() * .5f);
+    model2->transform.setPosition({-20.0f, 0.0f, 0.0f});
     
     rotationEuler = {270.0f, 0.0f, 0.0f};
     
@@ -160,20 +154,20 @@ void Game::init()
     bspSystem.addModel(model1); 
     bspSystem.addModel(model2); 
     
-    model->transform.scale *= 10;
-    model->transform.position = {10.0f, 0.0f, 10.0f};
-    model->transform.rotationQuat = {0.0f, 0.0f, 0.30f, 0.0f};
+    model->transform.setScale(model->transform.getScale() * 10.0f);
+    model->transform.setPosition({10.0f, 0.0f, 10.0f});
+    model->transform.setRotation(Quaternion{0.0f, 0.0f, 0.30f, 0.0f});
     
-    model3->transform.scale *= 10;
-    model3->transform.position = {10.0f, 0.0f, 10.0f};
-    model3->transform.rotationQuat = {0.0f, 0.0f, 0.30f, 0.0f};
+    model3->transform.setScale(model3->transform.getScale() * 10.0f);
+    model3->transform.setPosition({10.0f, 0.0f, 10.0f});
+    model3->transform.setRotation(Quaternion{0.0f, 0.0f, 0.30f, 0.0f});
 
     srand(time(nullptr));
     window->setTitle("Engine - BSP Test (IJKL to move chicken)");
     
     std::cout << "=== BSP SETUP ===" << '\n';
     std::cout << "Wall (partition) at X=0" << '\n';
-    std::cout << "Tank starts at X=" << model2->transform.position.x << '\n';
+    std::cout << "Tank starts at X=" << model2->transform.getPosition().x << '\n';
     std::cout << "Use IJKL keys to move chicken across the wall" << '\n';
 }
 
@@ -221,10 +215,6 @@ void Game::drawObjects()
     Renderer::clear();
     Shader::setShaderProgram(shaderProgramLighting);
 
-    ambientLight->apply(shaderProgramLighting);
-    pointLight->apply(shaderProgramLighting);
-    playerLight->apply(shaderProgramLighting);
-
     bspSystem.render(*camera);
     
     Shader::setShaderProgram(shaderProgramSolidColor);
@@ -288,27 +278,27 @@ void Game::handleTestInputs()
     }
 
     const float speed = 25;
-    static float lastReportedX = model2->transform.position.x;
+    static float lastReportedX = model2->transform.getPosition().x;
     
     if (Input::getKeyPressed(Key_I))
     {
         glm::vec3 forward = {speed * LibTime::getDeltaTime(), 0, 0.0f};
-        model2->transform.setPosition(model2->transform.position + forward);
+        model2->transform.setPosition(model2->transform.getPosition() + forward);
     }
     if (Input::getKeyPressed(Key_K))
     {
         glm::vec3 forward = {speed * LibTime::getDeltaTime(), 0, 0.0f};
-        model2->transform.setPosition(model2->transform.position - forward);
+        model2->transform.setPosition(model2->transform.getPosition() - forward);
     }
     if (Input::getKeyPressed(Key_J))
     {
         glm::vec3 right = {0.0f, 0, speed * LibTime::getDeltaTime()};
-        model2->transform.setPosition(model2->transform.position + right);
+        model2->transform.setPosition(model2->transform.getPosition() + right);
     }
     if (Input::getKeyPressed(Key_L))
     {
         glm::vec3 right = {0.0f, 0, speed * LibTime::getDeltaTime()};
-        model2->transform.setPosition(model2->transform.position - right);
+        model2->transform.setPosition(model2->transform.getPosition() - right);
     }
     const float rotationSpeed = 90.0f;
     if (Input::getKeyPressed(Key_U))
@@ -337,7 +327,7 @@ void Game::handleTestInputs()
         up.x -= rotationSpeed * LibTime::getDeltaTime();
         model2->transform.children[2]->setRotation(up);
     }
-    float currentX = model2->transform.position.x;
+    float currentX = model2->transform.getPosition().x;
     if ((lastReportedX < 0.0f && currentX >= 0.0f) || (lastReportedX >= 0.0f && currentX < 0.0f))
     {
         std::cout << "Chicken crossed wall! Now at X=" << currentX 
@@ -350,12 +340,12 @@ void Game::handleTestInputs()
 void Game::movement(Entity* player)
 {
     Transform transform2 = player->getTransform();
-    transform2.position.y += 1.f;
+    transform2.setPosition(transform2.getPosition() + glm::vec3(0.0f, 1.f, 0.0f));
     float speed = 80 * LibTime::getDeltaTime();
 
     if (!Input::isAnyKeyPressed())
     {
-        glm::vec3 pos = player->getTransform().position;
+        glm::vec3 pos = player->getTransform().getPosition();
         pos.z -= 2.0f;
         playerLight->setPosition(pos);
         return;
@@ -378,7 +368,7 @@ void Game::movement(Entity* player)
     if (Input::getKeyPressed(Key_W))
     {
         moveVector = cameraFront * speed;
-        transform.position += moveVector;
+        transform.setPosition(transform.getPosition() + moveVector);
         if (!collisionManager->checkCollision(transform))
         {
             player->move(moveVector);
@@ -390,7 +380,7 @@ void Game::movement(Entity* player)
     if (Input::getKeyPressed(Key_S))
     {
         moveVector = -cameraFront * speed;
-        transform.position += moveVector;
+        transform.setPosition(transform.getPosition() + moveVector);
         if (!collisionManager->checkCollision(transform))
         {
             player->move(moveVector);
@@ -402,7 +392,7 @@ void Game::movement(Entity* player)
     if (Input::getKeyPressed(Key_A))
     {
         moveVector = -cameraRight * speed;
-        transform.position += moveVector;
+        transform.setPosition(transform.getPosition() + moveVector);
         if (!collisionManager->checkCollision(transform))
         {
             player->move(moveVector);
@@ -414,7 +404,7 @@ void Game::movement(Entity* player)
     if (Input::getKeyPressed(Key_D))
     {
         moveVector = cameraRight * speed;
-        transform.position += moveVector;
+        transform.setPosition(transform.getPosition() + moveVector);
         if (!collisionManager->checkCollision(transform))
         {
             player->move(moveVector);
@@ -423,7 +413,7 @@ void Game::movement(Entity* player)
         }
     }
 
-    glm::vec3 pos = player->getTransform().position;
+    glm::vec3 pos = player->getTransform().getPosition();
     if (playerMoved)
     {
         pos += glm::normalize(movementDirection) * 2.0f;